@@ -0,0 +1,89 @@
+#include "alert.h"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+enum {
+    zoneBelow,
+    zoneInside,
+    zoneAbove,
+
+    tickTop = 121 //CK/16384 counted to 122, 1.0 s at 2 MHz
+};
+
+static uint16_t low_;
+static uint16_t high_;
+static uint16_t value_;
+static uint8_t zone_;
+static bool raised_;
+static volatile bool due_;
+
+static void releaseLine_( void )
+{
+    DDRB &= ~(1<<DDB4); //Input without pull up, the master pulls the line high
+    PORTB &= ~(1<<PB4);
+    raised_ = false;
+}
+
+void alertConfigure(uint16_t const low, uint16_t const high)
+{
+    low_ = low;
+    high_ = high;
+    zone_ = zoneInside; //A node set up outside of the thresholds alerts with its first sample
+    releaseLine_();
+
+    if(low == ALERT_OFF_LOW && high == ALERT_OFF_HIGH) {
+        TIMSK &= ~(1<<OCIE1A);
+        TCCR1 = 0;
+        PRR |= (1<<PRTIM1); //Disable Clocking of timer1, nothing to sample
+        due_ = false;
+        return;
+    }
+
+    PRR &= ~(1<<PRTIM1);
+    OCR1A = tickTop;
+    OCR1C = tickTop;
+    TCCR1 = (1<<CTC1) |                                   //Clear on OCR1C
+            (1<<CS13) | (1<<CS12) | (1<<CS11) | (1<<CS10); //CK/16384
+    TIMSK |= (1<<OCIE1A);
+}
+
+bool alertDue( void )
+{
+    bool const due = due_;
+
+    due_ = false;
+    return due;
+}
+
+void alertSample(uint16_t const value)
+{
+    /* The zone of the previous sample reaches ALERT_HYSTERESIS further, saturated at the ends of the range */
+    uint16_t const below = zone_ == zoneBelow ? (low_ > 0xffff - ALERT_HYSTERESIS ? 0xffff : low_ + ALERT_HYSTERESIS) : low_;
+    uint16_t const above = zone_ == zoneAbove ? (high_ < ALERT_HYSTERESIS ? 0 : high_ - ALERT_HYSTERESIS) : high_;
+    uint8_t const zone = value < below ? zoneBelow : value > above ? zoneAbove : zoneInside;
+
+    if(zone != zone_ && !raised_) {
+        raised_ = true;
+        DDRB |= (1<<DDB4); //PORTB4 is 0, the line goes low
+    }
+
+    value_ = value;
+    zone_ = zone;
+}
+
+bool alertRaised( void )
+{
+    return raised_;
+}
+
+uint16_t alertRead( void )
+{
+    releaseLine_();
+    return value_;
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+    due_ = true;
+}
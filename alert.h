@@ -0,0 +1,46 @@
+#ifndef ALERT_H
+#define ALERT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Threshold alert on PB4, an open drain line shared by all nodes (SMBus Alert style). While thresholds are set,
+ * Timer1 wakes the node about once a second to sample the moisture in the background. A sample that leaves the zone
+ * of the previous one, below low, between the thresholds or above high, pulls the line low. Leaving the zone below
+ * or above takes ALERT_HYSTERESIS more, so a reading sitting on a threshold doesn't keep alerting. The master finds
+ * the node with telemetryAlertQuery and reads it with telemetryAlertRead, which releases the line again. Zone changes
+ * while the line is low are not counted again, the read returns the latest sample.
+ */
+enum {
+    ALERT_OFF_LOW    = 0,      //Thresholds of a node that never alerts
+    ALERT_OFF_HIGH   = 0xffff,
+    ALERT_HYSTERESIS = 50      //0.5 %
+};
+
+/**
+ * @brief alertConfigure sets the thresholds in 0.01 %, the off values stop the sampling and release the line
+ */
+void alertConfigure(uint16_t low, uint16_t high);
+
+/**
+ * @brief alertDue returns true once per tick of the sampling timer
+ */
+bool alertDue( void );
+
+/**
+ * @brief alertSample checks a background reading against the thresholds and raises the alert if needed
+ */
+void alertSample(uint16_t value);
+
+/**
+ * @brief alertRaised tells if the node pulls the line
+ */
+bool alertRaised( void );
+
+/**
+ * @brief alertRead returns the latest background reading and releases the line
+ */
+uint16_t alertRead( void );
+
+#endif
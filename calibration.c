@@ -0,0 +1,80 @@
+#include "calibration.h"
+
+enum {
+    maxRawSum = 16 * 1023, //16 samples of the 10 bit ADC
+
+    humidityFirst  = 0,
+    humidityShift  = 11,   //A point every 2048 units
+    humidityPoints = 9,
+
+    temperatureFirst  = 3584, //224 LSB, below the -40C point of the datasheet
+    temperatureShift  = 9,    //A point every 512 units (32 LSB, about 32 degree)
+    temperaturePoints = 6
+};
+
+/* Moisture over the normalised sum. The probe voltage drops as the soil gets wetter, and the
+ * dielectric response flattens out towards dry soil. */
+static const __flash int16_t humidityTable[humidityPoints] = {
+    10000, 8200, 6500, 4900, 3500, 2300, 1300, 500, 0
+};
+
+/* Internal sensor, fitted to the datasheet points 230/300/370 LSB at -40/25/85C (1.1V reference) */
+static const __flash int16_t temperatureTable[temperaturePoints] = {
+    -4557, -1586, 1386, 4214, 6957, 9700
+};
+
+/* raw - offset is at most maxRawSum + 32768 < 2^16 with raw limited to its ADC range, so the product with the 16 bit
+ * gain fits 32 bit unsigned for every offset */
+static uint16_t correct_(uint16_t raw, struct Calibration const * const calibration)
+{
+    if(raw > maxRawSum) {
+        raw = maxRawSum;
+    }
+
+    int32_t const difference = (int32_t)raw - calibration->offset;
+
+    if(difference <= 0) {
+        return 0;
+    }
+
+    uint32_t const value = ((uint32_t)difference * calibration->gain) >> 12;
+
+    return value > maxRawSum ? maxRawSum : value;
+}
+
+/* Linear interpolation between equally spaced points, no division needed */
+static int16_t interpolate_(int16_t const __flash * const table, uint8_t const points,
+                            uint16_t const first, uint8_t const shift, uint16_t const value)
+{
+    if(value <= first) {
+        return table[0];
+    }
+
+    uint16_t const position = value - first;
+    uint8_t const index = position >> shift;
+
+    if(index >= points - 1) {
+        return table[points - 1];
+    }
+
+    uint16_t const fraction = position & ((1 << shift) - 1);
+    int32_t const delta = (int32_t)(table[index + 1] - table[index]) * fraction;
+
+    return table[index] + (int16_t)(delta >> shift);
+}
+
+void calibrationReset(struct Calibration * const calibration)
+{
+    calibration->offset = 0;
+    calibration->gain = CALIBRATION_UNITY_GAIN;
+}
+
+uint16_t calibrateHumidity(uint16_t const raw, struct Calibration const * const calibration)
+{
+    return interpolate_(humidityTable, humidityPoints, humidityFirst, humidityShift, correct_(raw, calibration));
+}
+
+int16_t calibrateTemperature(uint16_t const raw, struct Calibration const * const calibration)
+{
+    return interpolate_(temperatureTable, temperaturePoints, temperatureFirst, temperatureShift, correct_(raw, calibration));
+}
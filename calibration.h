@@ -0,0 +1,35 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdint.h>
+
+enum {
+    CALIBRATION_UNITY_GAIN = 1 << 12 //Gains are unsigned Q4.12 fixed point numbers
+};
+
+/**
+ * Per device correction applied to a raw 16-sample ADC sum before it is linearised: (raw - offset) * gain
+ */
+struct Calibration {
+    int16_t offset;
+    uint16_t gain;
+};
+
+/**
+ * @brief calibrationReset sets the coefficients to offset 0 and unity gain
+ */
+void calibrationReset(struct Calibration *);
+
+/**
+ * @brief calibrateHumidity converts a raw humidity sum into soil moisture
+ * @return Moisture in 0.01% steps (0 - 10000)
+ */
+uint16_t calibrateHumidity(uint16_t raw, struct Calibration const *);
+
+/**
+ * @brief calibrateTemperature converts a raw temperature sensor sum into a temperature
+ * @return Temperature in 0.01 degree Celsius steps
+ */
+int16_t calibrateTemperature(uint16_t raw, struct Calibration const *);
+
+#endif
@@ -15,6 +15,7 @@ SET(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
 SET(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
 
 SET(CSTANDARD "-std=gnu99")
+SET(CXXSTANDARD "-std=gnu++14 -fno-exceptions -fno-rtti -fno-threadsafe-statics")
 SET(CDEBUG "-gstabs")
 SET(CWARN "-Wall -Wstrict-prototypes")
 SET(CTUNING "-funsigned-char -funsigned-bitfields -fpack-struct -fshort-enums")
@@ -22,13 +23,13 @@ SET(COPT "-O2")
 SET(CMCU "-mmcu=attiny45")
 SET(CDEFS "-DF_CPU=8000000 -D__AVR_ATtiny45__")
 SET(CMCU2 "-mmcu=atmega16")
-SET(CDEFS2 "-DF_CPU=3800000 -D__AVR_ATmega16__")
+SET(CDEFS2 "-DF_CPU=8000000 -D__AVR_ATmega16__")
 
 SET(CFLAGS "${CMCU} ${CDEBUG} ${CDEFS} ${CINCS} ${COPT} ${CWARN} ${CSTANDARD} ${CEXTRA}")
-SET(CXXFLAGS "${CMCU} ${CDEFS} ${CINCS} ${COPT}")
+SET(CXXFLAGS "${CMCU} ${CDEFS} ${CINCS} ${COPT} -Wall ${CXXSTANDARD}")
 
 SET(CFLAGS2 "${CMCU2} ${CDEBUG} ${CDEFS2} ${CINCS} ${COPT} ${CWARN} ${CSTANDARD} ${CEXTRA}")
-SET(CXXFLAGS2 "${CMCU2} ${CDEFS2} ${CINCS} ${COPT}")
+SET(CXXFLAGS2 "${CMCU2} ${CDEFS2} ${CINCS} ${COPT} -Wall ${CXXSTANDARD}")
 
 SET(CMAKE_C_FLAGS  ${CFLAGS})
 SET(CMAKE_CXX_FLAGS ${CXXFLAGS}) 
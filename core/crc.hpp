@@ -0,0 +1,101 @@
+#ifndef CORE_CRC_HPP
+#define CORE_CRC_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __AVR__
+    #include <avr/pgmspace.h>
+#endif
+
+namespace core {
+
+/**
+ * Reflected CRC-16 over a polynomial known at compile time. The compiler builds the table, on the AVR it is placed
+ * in flash, the sensor has no RAM to spare for 512 byte.
+ */
+template<uint16_t Polynomial, uint16_t Initial, uint16_t FinalXor>
+class Crc16 {
+public:
+    enum : uint16_t { initial = Initial, finalXor = FinalXor };
+
+    struct Table {
+        uint16_t values[256];
+
+        constexpr Table() : values() {
+            for(unsigned i = 0; i<256; ++i) {
+                values[i] = entry(i);
+            }
+        }
+    };
+
+    /**
+     * @brief entry computes one table entry bit by bit, usable in constant expressions
+     */
+    static constexpr uint16_t entry(uint8_t const index) {
+        uint16_t crc = index;
+
+        for(unsigned bit = 0; bit<8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ Polynomial : crc >> 1;
+        }
+
+        return crc;
+    }
+
+    /**
+     * @brief check computes the CRC of a string at compile time, for the static_asserts on the check value
+     */
+    static constexpr uint16_t check(char const * const text, size_t const size) {
+        uint16_t crc = Initial;
+
+        for(size_t i = 0; i<size; ++i) {
+            crc = entry((crc ^ (uint8_t)text[i]) & 0xff) ^ (crc >> 8);
+        }
+
+        return crc ^ FinalXor;
+    }
+
+    static uint16_t update(uint16_t const crc, uint8_t const data) {
+        return lookup_((crc ^ data) & 0xff) ^ (crc >> 8);
+    }
+
+    static uint16_t compute(void const * const buffer, size_t const size) {
+        uint8_t const * const bytes = static_cast<uint8_t const *>(buffer);
+        uint16_t crc = Initial;
+
+        for(size_t i = 0; i<size; ++i) {
+            crc = update(crc, bytes[i]);
+        }
+
+        return crc ^ FinalXor;
+    }
+
+private:
+    static Table const table_;
+
+    static uint16_t lookup_(uint8_t const index) {
+#ifdef __AVR__
+        return pgm_read_word(&table_.values[index]);
+#else
+        return table_.values[index];
+#endif
+    }
+};
+
+#ifdef __AVR__
+template<uint16_t Polynomial, uint16_t Initial, uint16_t FinalXor>
+typename Crc16<Polynomial, Initial, FinalXor>::Table const Crc16<Polynomial, Initial, FinalXor>::table_ PROGMEM;
+#else
+template<uint16_t Polynomial, uint16_t Initial, uint16_t FinalXor>
+typename Crc16<Polynomial, Initial, FinalXor>::Table const Crc16<Polynomial, Initial, FinalXor>::table_;
+#endif
+
+/* The CRC of the frames, computeCrc() of crc16.h */
+typedef Crc16<0x8408, 0xffff, 0xffff> FrameCrc;
+
+static_assert(FrameCrc::entry(1) == 0x1189 && FrameCrc::entry(255) == 0x0f78, "Table of CRC-16/X-25");
+static_assert(FrameCrc::check("123456789", 9) == 0x906e, "Check value of CRC-16/X-25");
+
+}
+
+#endif
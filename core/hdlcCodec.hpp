@@ -0,0 +1,180 @@
+#ifndef CORE_HDLC_CODEC_HPP
+#define CORE_HDLC_CODEC_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crc.hpp"
+
+extern "C" {
+#include "../hdlc.h"
+}
+
+namespace core {
+
+/**
+ * Byte wise decoder for the frames of hdlc.h, 0x7e <data> <crc high> <crc low> 0x7e, 0x7f escapes the next byte.
+ * The state is the struct HdlcDecoder of hdlc.h, so the C functions of hdlc.cpp run this code as well.
+ */
+template<class Crc = FrameCrc>
+class HdlcDecoder {
+public:
+    HdlcDecoder(void * const buffer, size_t const bufferSize) { init(state_, buffer, bufferSize); }
+
+    HdlcResult decode(uint8_t const data) { return decode(state_, data); }
+
+    /* Payload length of the last complete frame */
+    size_t length() const { return state_.length; }
+
+    static void init(::HdlcDecoder & state, void * const buffer, size_t const bufferSize) {
+        state.buffer = static_cast<uint8_t *>(buffer);
+        state.bufferSize = bufferSize;
+        state.received = 0;
+        state.length = 0;
+        state.crc = 0;
+        state.inFrame = false;
+        state.escaped = false;
+    }
+
+    static HdlcResult decode(::HdlcDecoder & state, uint8_t data) {
+        HdlcResult result = hdlcPending;
+
+        if(0x7e == data) {
+            if(state.inFrame && state.received > 2) {
+                size_t const length = state.received - 2;
+
+                if(length <= state.bufferSize && Crc::compute(state.buffer, length) == state.crc) {
+                    state.length = length;
+                    result = hdlcFrameOk;
+                } else {
+                    result = hdlcFrameBad;
+                }
+            } //else frame was to short, so the flag just opens the next one
+
+            state.inFrame = true; //A closing flag may open the next frame as well
+            state.escaped = false;
+            state.received = 0;
+        } else if(state.inFrame) {
+            if(0x7f == data) {
+                state.escaped = true;
+            } else {
+                if(state.escaped) {
+                    data ^= 0x20;
+                    state.escaped = false;
+                }
+
+                /* The last two bytes are the CRC, so a byte is payload once two more followed it */
+                if(state.received >= 2 && state.received - 2 < state.bufferSize) {
+                    state.buffer[state.received - 2] = state.crc >> 8;
+                }
+
+                state.crc = (state.crc << 8) | data;
+                ++state.received;
+            }
+        }
+
+        return result;
+    }
+
+private:
+    ::HdlcDecoder state_;
+};
+
+/**
+ * The framing of hdlc.h over a byte source and sink chosen at compile time. Io provides
+ *   static bool put(uint8_t)   queues a byte, false if there is no room
+ *   static bool available()    a byte was received
+ *   static uint8_t get()       takes the received byte
+ *   static void idle()         called while waiting for input
+ * The calls are resolved by the compiler and inlined into the loops.
+ */
+template<class Io, class Crc = FrameCrc>
+class HdlcCodec {
+public:
+    enum : uint8_t { flag = 0x7e, escape = 0x7f, escapeXor = 0x20 };
+
+    static constexpr size_t maxFrame(size_t const bufferSize) {
+        return 2 * (bufferSize + 2) + 2; //Flags plus worst case, every byte escaped
+    }
+
+    static bool send(void const * const buffer, size_t const bufferSize) {
+        uint8_t const * const bytes = static_cast<uint8_t const *>(buffer);
+        uint16_t const crc = Crc::compute(buffer, bufferSize);
+
+        bool result = Io::put(flag);
+        for(size_t i = 0; i<bufferSize && result; ++i) {
+            result = put_(bytes[i]);
+        }
+
+        result = result && put_(crc >> 8);
+        result = result && put_(crc & 0xff);
+
+        return result && Io::put(flag);
+    }
+
+    /**
+     * @brief receive waits for the next complete frame
+     * @return True if its CRC was correct and it filled exactly the buffer
+     */
+    static bool receive(void * const buffer, size_t const bufferSize) {
+        HdlcDecoder<Crc> decoder(buffer, bufferSize);
+        HdlcResult result;
+
+        do {
+            while(!Io::available()) { Io::idle(); }
+
+            result = decoder.decode(Io::get());
+        } while(result == hdlcPending);
+
+        return result == hdlcFrameOk && decoder.length() == bufferSize;
+    }
+
+    /**
+     * @brief encode writes the complete frame for the buffer into memory
+     * @return Length of the frame, 0 if it does not fit into frameSize
+     */
+    static size_t encode(void const * const buffer, size_t const bufferSize, uint8_t * const frame, size_t const frameSize) {
+        uint8_t const * const bytes = static_cast<uint8_t const *>(buffer);
+        uint16_t const crc = Crc::compute(buffer, bufferSize);
+        size_t length = 0;
+
+        if(frameSize < maxFrame(bufferSize)) {
+            return 0;
+        }
+
+        frame[length++] = flag;
+        for(size_t i = 0; i<bufferSize; ++i) {
+            length = encode_(bytes[i], frame, length);
+        }
+
+        length = encode_(crc >> 8, frame, length);
+        length = encode_(crc & 0xff, frame, length);
+        frame[length++] = flag;
+
+        return length;
+    }
+
+private:
+    static bool put_(uint8_t const data) {
+        if(data == flag || data == escape) {
+            return Io::put(escape) && Io::put(data ^ escapeXor);
+        }
+
+        return Io::put(data);
+    }
+
+    static size_t encode_(uint8_t const data, uint8_t * const frame, size_t length) {
+        if(data == flag || data == escape) {
+            frame[length++] = escape;
+            frame[length++] = data ^ escapeXor;
+        } else {
+            frame[length++] = data;
+        }
+
+        return length;
+    }
+};
+
+}
+
+#endif
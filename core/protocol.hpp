@@ -0,0 +1,42 @@
+#ifndef CORE_PROTOCOL_HPP
+#define CORE_PROTOCOL_HPP
+
+#include <stddef.h>
+
+#include "../protocol.h"
+#include "../uartBridge/bridgeProtocol.h"
+
+/*
+ * protocol.h and bridgeProtocol.h stay the one definition of the messages, the C firmware includes them as well.
+ * Both ends copy the structures to and from the wire as they are, so their layout is checked here with every
+ * compiler the core is built with.
+ */
+namespace core {
+
+static_assert(sizeof(TelemetryCommand) == 4, "TelemetryCommand is 4 bytes on the wire");
+static_assert(offsetof(TelemetryCommand, cmdTag) == 1 && offsetof(TelemetryCommand, parameter) == 2,
+              "TelemetryCommand layout");
+static_assert(TELEMETRY_MAX_REPLY_FRAME == 14, "Reply frame buffers are sized for 14 bytes");
+
+static_assert(sizeof(BridgeHeader) == 2, "BridgeHeader layout");
+static_assert(sizeof(BridgeHello) == 4, "BridgeHello layout");
+static_assert(sizeof(BridgeTransaction) == 8 && offsetof(BridgeTransaction, command) == 4, "BridgeTransaction layout");
+static_assert(sizeof(BridgeTransactionResult) == 8 && offsetof(BridgeTransactionResult, reply) == 4,
+              "BridgeTransactionResult layout");
+static_assert(sizeof(BridgeEnumerate) == 6 && offsetof(BridgeEnumerate, slots) == 4, "BridgeEnumerate layout");
+static_assert(sizeof(BridgeAssigned) == 8 && offsetof(BridgeAssigned, id) == 4, "BridgeAssigned layout");
+static_assert(sizeof(BridgeEnumerateResult) == 8, "BridgeEnumerateResult layout");
+static_assert(sizeof(BridgeStatistics) == 8, "BridgeStatistics layout");
+static_assert(sizeof(BridgeSchedule) == 6 && offsetof(BridgeSchedule, interval) == 4, "BridgeSchedule layout");
+static_assert(sizeof(BridgeRun) == 4, "BridgeRun layout");
+static_assert(sizeof(BridgeSpeed) == 8 && offsetof(BridgeSpeed, sclHz) == 4, "BridgeSpeed layout");
+static_assert(sizeof(BridgeSample) == 12 && offsetof(BridgeSample, timestamp) == 8, "BridgeSample layout");
+static_assert(sizeof(BridgeReport) == 8 && offsetof(BridgeReport, deadband) == 4, "BridgeReport layout");
+static_assert(sizeof(BridgeReportSummary) == 8 && offsetof(BridgeReportSummary, forwarded) == 2,
+              "BridgeReportSummary layout");
+static_assert(sizeof(BridgeTraceData) == 12 && offsetof(BridgeTraceData, data) == 4, "BridgeTraceData layout");
+static_assert(sizeof(BridgeSample) <= BRIDGE_MAX_MESSAGE, "BRIDGE_MAX_MESSAGE has to cover every message");
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef CORE_RING_BUFFER_HPP
+#define CORE_RING_BUFFER_HPP
+
+#include <stdint.h>
+
+namespace core {
+
+/**
+ * Byte queue between one writer and one reader, the buffers of twiInterface.cpp and rs232.cpp. One side may run in
+ * an interrupt: each index is only written by its own side and is a single byte, so no access has to be locked.
+ * Size is a power of two so the indices wrap with a mask, one entry stays free to tell full from empty.
+ */
+template<unsigned Size>
+class RingBuffer {
+    static_assert(Size >= 2 && Size <= 256 && (Size & (Size - 1)) == 0, "Size has to be a power of two up to 256");
+
+public:
+    enum : uint8_t { capacity = Size - 1 };
+
+    constexpr RingBuffer() : data_(), read_(0), write_(0) {} //Statics need no constructor call at startup
+
+    bool push(uint8_t const data) {
+        uint8_t const write = write_;
+        uint8_t const next = (write + 1) & mask_;
+
+        if(next == read_) {
+            return false;
+        }
+
+        data_[write] = data;
+        write_ = next;
+        return true;
+    }
+
+    /**
+     * @brief pop takes the oldest byte
+     * @return False if the buffer was empty, data is left alone then
+     */
+    bool pop(uint8_t & data) {
+        uint8_t const read = read_;
+
+        if(read == write_) {
+            return false;
+        }
+
+        data = data_[read];
+        read_ = (read + 1) & mask_;
+        return true;
+    }
+
+    bool empty() const { return read_ == write_; }
+    bool full() const { return ((write_ + 1) & mask_) == read_; }
+    uint8_t size() const { return (write_ - read_) & mask_; }
+    uint8_t space() const { return capacity - size(); }
+
+    /* Reader side, drops everything not read yet */
+    void clear() { read_ = write_; }
+
+private:
+    enum : uint8_t { mask_ = Size - 1 };
+
+    uint8_t volatile data_[Size];
+    uint8_t volatile read_;
+    uint8_t volatile write_;
+};
+
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef CORE_TWI_IO_HPP
+#define CORE_TWI_IO_HPP
+
+#include <stdint.h>
+
+extern "C" {
+#include "../twiInterface.h"
+}
+
+namespace core {
+
+/* Io of HdlcCodec on the buffers of twiInterface.cpp */
+struct TwiIo {
+    static bool put(uint8_t const data) { return twiSendChar(data); }
+    static bool available() { return twiCharAvailable(); }
+    static uint8_t get() { return twiReceiveChar(); }
+    static void idle() { twiSleep(); }
+};
+
+}
+
+#endif
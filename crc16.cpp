@@ -0,0 +1,11 @@
+#include "core/crc.hpp"
+
+extern "C" {
+#include "crc16.h"
+}
+
+/* The table is built by the compiler and kept in flash, see core/crc.hpp */
+uint16_t computeCrc(uint8_t const* const buffer, size_t const bufferSize)
+{
+    return core::FrameCrc::compute(buffer, bufferSize);
+}
@@ -0,0 +1,80 @@
+#include "enumeration.h"
+
+static uint16_t nextRandom_(struct Enumeration * const state)
+{
+    /* Galois LFSR, x^32 + x^31 + x^29 + x + 1. Clocked 16 times so that two nodes that collided
+     * don't end up sharing most of their bits in the next round as well. */
+    for(uint8_t i = 0; i<16; ++i) {
+        uint8_t const lsb = state->random & 1;
+
+        state->random >>= 1;
+        if(lsb) {
+            state->random ^= 0xD0000001;
+        }
+    }
+
+    return state->random;
+}
+
+void enumerationInit(struct Enumeration * const state, uint32_t const id)
+{
+    state->id = id & 0xffffff;
+    state->random = state->id | 0x1000000; //Seeded with the whole id, the LFSR must never be 0
+    state->slot = 0;
+    state->participating = false;
+    state->armed = false;
+}
+
+enum EnumerationAction enumerationHandleCommand(struct Enumeration * const state, struct TelemetryCommand * const command,
+                                                bool const configured)
+{
+    enum EnumerationAction action = enumerationIdle;
+
+    switch(command->cmdId) {
+    case telemetryEnumerationStart:
+    {
+        uint16_t const slots = command->parameter & TELEMETRY_ENUMERATION_SLOTS;
+
+        if(command->parameter & TELEMETRY_ENUMERATION_NEW) {
+            state->participating = !configured || (command->parameter & TELEMETRY_ENUMERATION_ALL);
+        }
+
+        if(state->participating && slots > 0) {
+            state->slot = nextRandom_(state) % slots;
+        }
+
+        state->armed = false;
+        action = enumerationDisarm;
+        break;
+    }
+
+    case telemetryEnumerationSlot:
+    {
+        state->armed = state->participating && state->slot == command->parameter;
+
+        if(state->armed) {
+            command->cmdTag = state->id >> 16;
+            command->parameter = state->id & 0xffff;
+            action = enumerationArm;
+        } else {
+            action = enumerationDisarm;
+        }
+        break;
+    }
+
+    case telemetryEnumerationAssign:
+    {
+        if(state->armed && command->parameter == (state->id & 0xffff)) {
+            state->participating = false;
+            state->armed = false;
+            action = enumerationAssigned;
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    return action;
+}
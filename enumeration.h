@@ -0,0 +1,41 @@
+#ifndef ENUMERATION_H
+#define ENUMERATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+/**
+ * Node side of the address enumeration. The master runs rounds of slotted arbitration on the general call address:
+ * each taking part node picks a random slot, answers the probe when its slot is called and gets an address assigned
+ * when its reply came through without a collision. Nodes that collided try again in the next round.
+ */
+struct Enumeration {
+    uint32_t id;        //24 bit random id of the node
+    uint32_t random;    //LFSR state for the slot selection
+    uint16_t slot;
+    bool participating;
+    bool armed;         //Reply is loaded and the node answers on the probe address
+};
+
+enum EnumerationAction {
+    enumerationIdle,     //Nothing to do
+    enumerationDisarm,   //Stop answering on the probe address and drop any pending reply
+    enumerationArm,      //Send the command as reply on the probe address
+    enumerationAssigned  //The cmdTag of the command is the new address of the node
+};
+
+/**
+ * @brief enumerationInit prepares the state for a node with the given id
+ */
+void enumerationInit(struct Enumeration *, uint32_t id);
+
+/**
+ * @brief enumerationHandleCommand processes one of the telemetryEnumeration commands
+ * @param command is turned into the probe reply if enumerationArm is returned
+ * @param configured True if the node already had an address assigned
+ */
+enum EnumerationAction enumerationHandleCommand(struct Enumeration *, struct TelemetryCommand * command, bool configured);
+
+#endif
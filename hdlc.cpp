@@ -0,0 +1,35 @@
+#include "core/hdlcCodec.hpp"
+#include "core/twiIo.hpp"
+
+extern "C" {
+#include "hdlc.h"
+}
+
+/* The C sources of both firmwares and the host tools use the codec of the core through these */
+typedef core::HdlcCodec<core::TwiIo> Codec;
+typedef core::HdlcDecoder<> Decoder;
+
+size_t hdlcEncodeBuffer(void const * const buffer, size_t const bufferSize, uint8_t * const frame, size_t const frameSize)
+{
+    return Codec::encode(buffer, bufferSize, frame, frameSize);
+}
+
+bool hdlcSendBuffer(void const * const buffer, size_t const bufferSize)
+{
+    return Codec::send(buffer, bufferSize);
+}
+
+void hdlcDecoderInit(struct HdlcDecoder * const decoder, void * const buffer, size_t const bufferSize)
+{
+    Decoder::init(*decoder, buffer, bufferSize);
+}
+
+enum HdlcResult hdlcDecodeChar(struct HdlcDecoder * const decoder, uint8_t const data)
+{
+    return Decoder::decode(*decoder, data);
+}
+
+bool hdlcReceiveBuffer(void *const buffer, size_t const bufferSize)
+{
+    return Codec::receive(buffer, bufferSize);
+}
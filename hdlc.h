@@ -2,8 +2,37 @@
 #define HDLC_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+/**
+ * Byte wise decoder for frames of the form 0x7e <data> <crc high> <crc low> 0x7e, 0x7f escapes the next byte.
+ */
+struct HdlcDecoder {
+    uint8_t * buffer;
+    size_t bufferSize;
+    size_t received;   //Bytes received in the current frame, including the two CRC bytes
+    size_t length;     //Payload length of the last complete frame
+    uint16_t crc;      //The last two bytes received, the CRC once the frame is complete
+    bool inFrame;
+    bool escaped;
+};
+
+enum HdlcResult {
+    hdlcPending,  //Frame not complete yet
+    hdlcFrameOk,  //Frame complete and CRC correct, payload is in the buffer
+    hdlcFrameBad  //Frame complete but CRC wrong or too long for the buffer
+};
+
+void hdlcDecoderInit(struct HdlcDecoder * decoder, void * buffer, size_t bufferSize);
+enum HdlcResult hdlcDecodeChar(struct HdlcDecoder * decoder, uint8_t data);
+
+/**
+ * @brief hdlcEncodeBuffer writes the complete frame for the buffer into memory
+ * @return Length of the frame, 0 if it does not fit into frameSize
+ */
+size_t hdlcEncodeBuffer(void const * buffer, size_t bufferSize, uint8_t * frame, size_t frameSize);
+
 bool hdlcSendBuffer(void const * const buffer, size_t const bufferSize);
 bool hdlcReceiveBuffer(void *const buffer, size_t const bufferSize);
 
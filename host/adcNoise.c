@@ -0,0 +1,118 @@
+/*
+ * Noise of the humidity readings of probe.c under the excitation ripple:
+ *   adcNoise [-a ripple LSB] [-l level] [-n readings] [-r seed]
+ * The probe module runs on the simulated ADC of sim/, which puts the excitation on top of the level with the sign
+ * of the phase the sample and hold closes on. The synchronous readings are started by Timer0, the asynchronous ones
+ * are the former method, started in software at any phase. Readings are on the scale of the calibration, the sum
+ * of 16 conversions. Times are simulated conversion times of one reading.
+ * The simulated trigger samples on the phase of the compare match by construction, so this shows what the phase lock
+ * buys under that model, not that the hardware keeps it. That takes the readings of a board.
+ */
+#include <avr/eeprom.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "simDevice.h"
+#include "probe.h"
+
+/* The same module built with PROBE_ASYNCHRONOUS and renamed, see CMakeLists.txt */
+void probeInitAsynchronous( void );
+uint16_t probeHumidityAsynchronous(uint8_t conversions);
+
+/* The probe module keeps nothing in the EEPROM, simDevice.c still wants the section */
+static uint8_t eepromUnused_ EEMEM __attribute__((used));
+
+static int64_t now_;
+
+static void wait_(struct SimDevice * const device, int64_t const until)
+{
+    (void)device;
+    now_ = until;
+}
+
+static void idle_(struct SimDevice * const device)
+{
+    (void)device;
+}
+
+struct Statistics {
+    double mean;
+    double deviation;
+    double microseconds;
+};
+
+static struct Statistics measure_(uint16_t (*read)(uint8_t), uint8_t const conversions, unsigned const readings)
+{
+    struct Statistics result = {0, 0, 0};
+    double sum = 0;
+    double squares = 0;
+    int64_t const start = now_;
+
+    for(unsigned i = 0; i<readings; ++i) {
+        double const value = read(conversions);
+
+        sum += value;
+        squares += value * value;
+    }
+
+    result.mean = sum / readings;
+    result.deviation = sqrt(squares / readings - result.mean * result.mean);
+    result.microseconds = (now_ - start) / 1e3 / readings;
+
+    return result;
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned ripple = 8;
+    unsigned level = 500;
+    unsigned readings = 100000;
+    unsigned seed = 1;
+    int option;
+
+    while((option = getopt(argc, argv, "a:l:n:r:")) != -1) {
+        switch(option) {
+        case 'a': ripple = strtoul(optarg, NULL, 0); break;
+        case 'l': level = strtoul(optarg, NULL, 0); break;
+        case 'n': readings = strtoul(optarg, NULL, 0); break;
+        case 'r': seed = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-a ripple LSB] [-l level] [-n readings] [-r seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if(level > 1023 || !readings) {
+        fprintf(stderr, "%s: the level is a 10 bit conversion, the readings must not be 0\n", argv[0]);
+        return 1;
+    }
+
+    simDeviceInit();
+    simDevice.clock = &now_;
+    simDevice.cpuHz = 2000000;
+    simDevice.humidity = level;
+    simDevice.ripple = ripple;
+    simDevice.noise = seed | 1;
+    simDevice.wait = wait_;
+    simDevice.idle = idle_;
+
+    printf("level %u (reading %u), ripple +-%u LSB, %u readings\n", level, level * PROBE_READING_CONVERSIONS, ripple,
+           readings);
+    printf("conversions  asynchronous: mean   stddev     us  synchronous: mean   stddev     us\n");
+
+    for(uint8_t conversions = 2; conversions<=32; conversions *= 2) {
+        probeInitAsynchronous();
+        struct Statistics const asynchronous = measure_(probeHumidityAsynchronous, conversions, readings);
+
+        probeInit();
+        struct Statistics const synchronous = measure_(probeHumidity, conversions, readings);
+
+        printf("%11u  %20.1f %8.2f %6.0f  %19.1f %8.2f %6.0f\n", conversions,
+               asynchronous.mean, asynchronous.deviation, asynchronous.microseconds,
+               synchronous.mean, synchronous.deviation, synchronous.microseconds);
+    }
+
+    return 0;
+}
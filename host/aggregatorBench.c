@@ -0,0 +1,217 @@
+/*
+ * Polls many bridges at once through bridgeAggregator.c:
+ *   aggregatorBench [-n bridges] [-t seconds] [-a sensors] [-b baud] [-i interval ms] [-w window ms] [-v] [device...]
+ * Without devices it runs against 1, 2, 4 ... up to -n emulated bridges (bridgeEmulator.c on pseudo terminals) and
+ * prints the samples per second of all bridges together for every count. Each bridge reads humidity and temperature
+ * of its sensors 1..-a on its own schedule. With devices the real bridges are polled the same way for -t seconds,
+ * -v prints the merged stream.
+ * The stream is checked to come in the order of time, late counts the samples the window was too short for.
+ */
+#include <getopt.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bridgeAggregator.h"
+#include "bridgeClient.h"
+#include "bridgeEmulator.h"
+
+struct Stream {
+    bool verbose;
+    int64_t start;
+    int64_t lastTime;
+    unsigned long samples;
+    unsigned long failed;
+    unsigned long disorder;  //Handed out before a sample with a later time
+};
+
+static double seconds_(clockid_t const clock)
+{
+    struct timespec now;
+
+    clock_gettime(clock, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void received_(void * const context, struct AggregatorSample const * const sample)
+{
+    struct Stream * const stream = context;
+
+    if(!stream->samples) {
+        stream->start = sample->time;
+    }
+
+    ++stream->samples;
+    stream->failed += sample->status != bridgeStatusOk;
+    stream->disorder += sample->time < stream->lastTime;
+    stream->lastTime = sample->time;
+
+    if(stream->verbose) {
+        printf("%10.3f bridge %2u address %3u command %2u status %2u parameter %5u\n",
+               (sample->time - stream->start) / 1e6, sample->bridge, sample->address, sample->reply.cmdId,
+               sample->status, sample->reply.parameter);
+    }
+}
+
+/* Adds up the counts of all bridges */
+static void total_(struct Aggregator const * const aggregator, unsigned const bridges,
+                   struct AggregatorStatistics * const total)
+{
+    memset(total, 0, sizeof(*total));
+
+    for(unsigned i = 0; i<bridges; ++i) {
+        struct AggregatorStatistics statistics;
+
+        aggregatorStatistics(aggregator, i, &statistics);
+        total->requests += statistics.requests;
+        total->samples += statistics.samples;
+        total->timeouts += statistics.timeouts;
+        total->late += statistics.late;
+        total->bytesWritten += statistics.bytesWritten;
+        total->bytesRead += statistics.bytesRead;
+        total->hungUp += statistics.hungUp;
+    }
+}
+
+/* The first round of every bridge is left out, it only fills the pipelines */
+static int run_(struct Aggregator * const aggregator, struct Stream * const stream, unsigned const bridges,
+                unsigned const seconds)
+{
+    struct AggregatorStatistics total;
+
+    if(aggregatorRun(aggregator, 500) < 0) {
+        perror("epoll");
+        return 1;
+    }
+
+    unsigned long const samples = stream->samples;
+    double const start = seconds_(CLOCK_MONOTONIC);
+    double const cpuStart = seconds_(CLOCK_PROCESS_CPUTIME_ID);
+    int const up = aggregatorRun(aggregator, seconds * 1000);
+    double const elapsed = seconds_(CLOCK_MONOTONIC) - start;
+    double const cpu = seconds_(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+
+    total_(aggregator, bridges, &total);
+    aggregatorDestroy(aggregator);
+
+    printf("%3u bridges %9.1f samples/s %7.1f per bridge %5.1f%% host CPU %lu failed %lu timeouts %lu late "
+           "%lu out of order%s\n", bridges, (stream->samples - samples) / elapsed,
+           (stream->samples - samples) / elapsed / bridges, 100 * cpu / elapsed, stream->failed, total.timeouts,
+           total.late, stream->disorder, total.hungUp ? ", bridges hung up" : "");
+
+    return up < 0 || stream->disorder ? 1 : 0;
+}
+
+int main(int argc, char ** argv)
+{
+    struct BridgeEmulatorTiming timing = { BRIDGE_DEFAULT_BAUD, 100000, 200 };
+    struct AggregatorSchedule schedule = { 1, 8, (1<<telemetryHumidity) | (1<<telemetryTemperature), 0 };
+    unsigned maxBridges = 16;
+    unsigned seconds = 5;
+    unsigned window = 100;
+    struct Stream stream = { false };
+    int option;
+
+    while((option = getopt(argc, argv, "n:t:a:b:i:w:v")) != -1) {
+        switch(option) {
+        case 'n': maxBridges = strtoul(optarg, NULL, 0); break;
+        case 't': seconds = strtoul(optarg, NULL, 0); break;
+        case 'a': schedule.lastAddress = strtoul(optarg, NULL, 0); break;
+        case 'b': timing.baud = strtoul(optarg, NULL, 0); break;
+        case 'i': schedule.intervalMs = strtoul(optarg, NULL, 0); break;
+        case 'w': window = strtoul(optarg, NULL, 0); break;
+        case 'v': stream.verbose = true; break;
+        default:
+            fprintf(stderr, "usage: %s [-n bridges] [-t seconds] [-a sensors] [-b baud] [-i interval ms] "
+                    "[-w window ms] [-v] [device...]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if(!maxBridges || maxBridges > AGGREGATOR_MAX_BRIDGES || !schedule.lastAddress ||
+       schedule.lastAddress >= TELEMETRY_PROBE_ADDRESS || argc - optind > AGGREGATOR_MAX_BRIDGES) {
+        fprintf(stderr, "%s: bridges 1..%u, sensors 1..%u\n", argv[0], AGGREGATOR_MAX_BRIDGES,
+                TELEMETRY_PROBE_ADDRESS - 1);
+        return 2;
+    }
+
+    /* Real bridges, checked one by one before they are handed to the aggregator */
+    if(optind < argc) {
+        struct Aggregator * const aggregator = aggregatorCreate(window, received_, &stream);
+        unsigned const bridges = argc - optind;
+
+        if(!aggregator) {
+            perror("aggregator");
+            return 1;
+        }
+
+        for(int i = optind; i<argc; ++i) {
+            struct BridgeClient client;
+
+            if(bridgeOpen(&client, argv[i], timing.baud) != 0) {
+                perror(argv[i]);
+                return 1;
+            }
+
+            if(bridgeHello(&client) != BRIDGE_PROTOCOL_VERSION) {
+                fprintf(stderr, "No binary protocol bridge on %s\n", argv[i]);
+                return 1;
+            }
+
+            if(aggregatorAdd(aggregator, client.fd, &schedule) < 0) {
+                perror(argv[i]);
+                return 1;
+            }
+        }
+
+        return run_(aggregator, &stream, bridges, seconds);
+    }
+
+    printf("Emulated bridges, %u baud, SCL %lu Hz, sensors 1..%u, %u ms interval, %u ms window\n", timing.baud,
+           timing.sclHz, schedule.lastAddress, schedule.intervalMs, window);
+
+    int result = 0;
+
+    for(unsigned bridges = 1; ; bridges *= 2) {
+        bridges = bridges < maxBridges ? bridges : maxBridges;
+
+        struct Aggregator * const aggregator = aggregatorCreate(window, received_, &stream);
+        pid_t emulators[AGGREGATOR_MAX_BRIDGES];
+
+        if(!aggregator) {
+            perror("aggregator");
+            return 1;
+        }
+
+        for(unsigned i = 0; i<bridges; ++i) {
+            int const fd = bridgeEmulatorSpawn(bridgeEmulatorBinary, &timing, &emulators[i]);
+
+            if(fd < 0 || aggregatorAdd(aggregator, fd, &schedule) < 0) {
+                perror("pty");
+                return 1;
+            }
+        }
+
+        bool const verbose = stream.verbose;
+
+        memset(&stream, 0, sizeof(stream));
+        stream.verbose = verbose;
+        result |= run_(aggregator, &stream, bridges, seconds);
+
+        for(unsigned i = 0; i<bridges; ++i) {
+            kill(emulators[i], SIGTERM);
+            waitpid(emulators[i], NULL, 0);
+        }
+
+        if(bridges == maxBridges) {
+            break;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,513 @@
+#include "bridgeAggregator.h"
+#include "bridgeClient.h"
+#include "hdlc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+enum {
+    outputFrames = 2 * BRIDGE_PIPELINE_DEPTH, //Frames queued for the line, a timeout may leave some unwritten
+    epollEvents = 16
+};
+
+/* A transaction on its way to the bridge or on its bus */
+struct Pending {
+    uint8_t sequence;
+    uint8_t address;
+    uint8_t command;
+    int64_t sentAt;
+};
+
+struct Bridge {
+    int fd;
+    bool up;
+    bool writing;              //EPOLLOUT is armed
+    struct AggregatorSchedule schedule;
+    struct AggregatorStatistics statistics;
+    struct HdlcDecoder decoder;
+    uint8_t message[BRIDGE_MAX_MESSAGE];
+    uint8_t output[outputFrames * BRIDGE_MAX_FRAME];
+    size_t outputLength;
+    struct Pending pending[BRIDGE_PIPELINE_DEPTH];
+    unsigned pendingCount;
+    uint8_t sequence;
+    uint8_t address;           //Position of the schedule in the current round
+    uint8_t command;
+    bool inRound;
+    int64_t nextRound;
+};
+
+struct Aggregator {
+    int epoll;
+    int64_t window;
+    AggregatorCallback callback;
+    void * context;
+    struct Bridge bridges[AGGREGATOR_MAX_BRIDGES];
+    unsigned bridgeCount;
+    struct AggregatorSample * heap; //Samples held back, min heap on the time
+    size_t heapLength;
+    size_t heapSize;
+    int64_t lastTime;          //Of the last sample handed out
+};
+
+static int64_t microseconds_( void )
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static bool before_(struct AggregatorSample const * const a, struct AggregatorSample const * const b)
+{
+    return a->time < b->time || (a->time == b->time && a->bridge < b->bridge);
+}
+
+static void swap_(struct AggregatorSample * const a, struct AggregatorSample * const b)
+{
+    struct AggregatorSample const temporary = *a;
+
+    *a = *b;
+    *b = temporary;
+}
+
+static void heapPop_(struct Aggregator * const aggregator, struct AggregatorSample * const sample)
+{
+    struct AggregatorSample * const heap = aggregator->heap;
+    size_t index = 0;
+
+    *sample = heap[0];
+    heap[0] = heap[--aggregator->heapLength];
+
+    for(;;) {
+        size_t const left = 2 * index + 1;
+        size_t smallest = index;
+
+        if(left < aggregator->heapLength && before_(&heap[left], &heap[smallest])) {
+            smallest = left;
+        }
+        if(left + 1 < aggregator->heapLength && before_(&heap[left + 1], &heap[smallest])) {
+            smallest = left + 1;
+        }
+        if(smallest == index) {
+            break;
+        }
+
+        swap_(&heap[index], &heap[smallest]);
+        index = smallest;
+    }
+}
+
+static void handOut_(struct Aggregator * const aggregator, struct AggregatorSample const * const sample)
+{
+    ++aggregator->bridges[sample->bridge].statistics.samples;
+    if(sample->time > aggregator->lastTime) {
+        aggregator->lastTime = sample->time;
+    }
+
+    aggregator->callback(aggregator->context, sample);
+}
+
+/* Samples older than the last one handed out can't be put in order any more, they go out at once */
+static void add_(struct Aggregator * const aggregator, struct AggregatorSample const * const sample)
+{
+    if(sample->time < aggregator->lastTime) {
+        ++aggregator->bridges[sample->bridge].statistics.late;
+        handOut_(aggregator, sample);
+        return;
+    }
+
+    if(aggregator->heapLength == aggregator->heapSize) {
+        size_t const size = aggregator->heapSize ? 2 * aggregator->heapSize : 256;
+        struct AggregatorSample * const heap = realloc(aggregator->heap, size * sizeof(*heap));
+
+        if(!heap) {
+            handOut_(aggregator, sample); //Unordered rather than lost
+            return;
+        }
+
+        aggregator->heap = heap;
+        aggregator->heapSize = size;
+    }
+
+    size_t index = aggregator->heapLength++;
+
+    aggregator->heap[index] = *sample;
+    while(index && before_(&aggregator->heap[index], &aggregator->heap[(index - 1) / 2])) {
+        swap_(&aggregator->heap[index], &aggregator->heap[(index - 1) / 2]);
+        index = (index - 1) / 2;
+    }
+}
+
+static void emitDue_(struct Aggregator * const aggregator, int64_t const now)
+{
+    while(aggregator->heapLength && aggregator->heap[0].time <= now - aggregator->window) {
+        struct AggregatorSample sample;
+
+        heapPop_(aggregator, &sample);
+        handOut_(aggregator, &sample);
+    }
+}
+
+static void result_(struct Aggregator * const aggregator, struct Bridge * const bridge, struct Pending const * const pending,
+                    uint8_t const status, struct TelemetryCommand const * const reply)
+{
+    struct AggregatorSample sample = { pending->sentAt, bridge - aggregator->bridges, pending->address, status };
+
+    if(reply) {
+        sample.reply = *reply;
+    } else {
+        sample.reply.cmdId = pending->command;
+        sample.reply.cmdTag = pending->sequence;
+    }
+
+    add_(aggregator, &sample);
+}
+
+/* The first count transactions in the pipeline are done */
+static void retire_(struct Bridge * const bridge, unsigned const count)
+{
+    bridge->pendingCount -= count;
+    memmove(bridge->pending, bridge->pending + count, bridge->pendingCount * sizeof(bridge->pending[0]));
+}
+
+static void timeout_(struct Aggregator * const aggregator, struct Bridge * const bridge, unsigned const count)
+{
+    for(unsigned i = 0; i<count; ++i) {
+        ++bridge->statistics.timeouts;
+        result_(aggregator, bridge, &bridge->pending[i], AGGREGATOR_STATUS_TIMEOUT, NULL);
+    }
+
+    retire_(bridge, count);
+}
+
+static void arm_(struct Aggregator * const aggregator, struct Bridge * const bridge, bool const writing)
+{
+    struct epoll_event event = { EPOLLIN | (writing ? EPOLLOUT : 0), { .u32 = bridge - aggregator->bridges } };
+
+    if(bridge->writing != writing && epoll_ctl(aggregator->epoll, EPOLL_CTL_MOD, bridge->fd, &event) == 0) {
+        bridge->writing = writing;
+    }
+}
+
+static void hangUp_(struct Aggregator * const aggregator, struct Bridge * const bridge)
+{
+    epoll_ctl(aggregator->epoll, EPOLL_CTL_DEL, bridge->fd, NULL);
+    timeout_(aggregator, bridge, bridge->pendingCount);
+    bridge->up = false;
+    bridge->statistics.hungUp = 1;
+}
+
+static void flush_(struct Aggregator * const aggregator, struct Bridge * const bridge)
+{
+    while(bridge->outputLength) {
+        ssize_t const written = write(bridge->fd, bridge->output, bridge->outputLength);
+
+        /* EPOLLOUT is level triggered, an interrupted write waits for it like a full buffer */
+        if(written < 0) {
+            if(errno != EAGAIN && errno != EINTR) {
+                hangUp_(aggregator, bridge);
+                return;
+            }
+            break;
+        }
+
+        bridge->statistics.bytesWritten += written;
+        bridge->outputLength -= written;
+        memmove(bridge->output, bridge->output + written, bridge->outputLength);
+    }
+
+    arm_(aggregator, bridge, bridge->outputLength != 0);
+}
+
+/* Moves the schedule to the next command, the round is over once it passed lastAddress */
+static void advance_(struct Bridge * const bridge)
+{
+    while(++bridge->command < 8) {
+        if(bridge->schedule.commands & (1<<bridge->command)) {
+            return;
+        }
+    }
+
+    bridge->command = __builtin_ctz(bridge->schedule.commands);
+    if(bridge->address++ == bridge->schedule.lastAddress) {
+        bridge->address = bridge->schedule.firstAddress;
+        bridge->inRound = false;
+    }
+}
+
+static void submit_(struct Bridge * const bridge, int64_t const now)
+{
+    while(bridge->schedule.commands && bridge->pendingCount < BRIDGE_PIPELINE_DEPTH &&
+          sizeof(bridge->output) - bridge->outputLength >= BRIDGE_MAX_FRAME) {
+        if(!bridge->inRound) {
+            if(now < bridge->nextRound) {
+                return;
+            }
+
+            bridge->inRound = true;
+            bridge->nextRound += (int64_t)bridge->schedule.intervalMs * 1000;
+            if(bridge->nextRound < now) {
+                bridge->nextRound = now;
+            }
+        }
+
+        struct BridgeTransaction const transaction = {
+            { bridgeOpTransaction, ++bridge->sequence }, bridge->address, 0,
+            { bridge->command, bridge->sequence, 0 }
+        };
+        struct Pending * const pending = &bridge->pending[bridge->pendingCount++];
+
+        bridge->outputLength += hdlcEncodeBuffer(&transaction, sizeof(transaction), bridge->output + bridge->outputLength,
+                                                 sizeof(bridge->output) - bridge->outputLength);
+        pending->sequence = transaction.header.sequence;
+        pending->address = transaction.address;
+        pending->command = transaction.command.cmdId;
+        pending->sentAt = now;
+        ++bridge->statistics.requests;
+        advance_(bridge);
+    }
+}
+
+/* Answers come in the order of the requests, the ones ahead of an answer were lost on the line */
+static void receive_(struct Aggregator * const aggregator, struct Bridge * const bridge, size_t const length,
+                     int64_t const now)
+{
+    struct BridgeHeader const * const header = (struct BridgeHeader const *)bridge->message;
+
+    if(length == sizeof(struct BridgeSample) && header->opcode == bridgeOpSample) {
+        struct BridgeSample const * const streamed = (struct BridgeSample const *)bridge->message;
+        struct AggregatorSample const sample = {
+            now, bridge - aggregator->bridges, streamed->address, streamed->status, streamed->reply
+        };
+
+        add_(aggregator, &sample);
+        return;
+    }
+
+    if(length < sizeof(*header)) {
+        return;
+    }
+
+    for(unsigned i = 0; i<bridge->pendingCount; ++i) {
+        if(bridge->pending[i].sequence != header->sequence) {
+            continue;
+        }
+
+        timeout_(aggregator, bridge, i);
+
+        if(length == sizeof(struct BridgeTransactionResult) && header->opcode == bridgeOpTransaction) {
+            struct BridgeTransactionResult const * const result = (struct BridgeTransactionResult const *)bridge->message;
+
+            result_(aggregator, bridge, &bridge->pending[0], result->status, &result->reply);
+        } else {
+            uint8_t const status = length == sizeof(struct BridgeHello) && header->opcode == bridgeOpError ?
+                                   ((struct BridgeHello const *)bridge->message)->version : bridgeStatusMalformed;
+
+            result_(aggregator, bridge, &bridge->pending[0], status, NULL);
+        }
+
+        retire_(bridge, 1);
+        return;
+    }
+}
+
+static void read_(struct Aggregator * const aggregator, struct Bridge * const bridge, int64_t const now)
+{
+    uint8_t input[256];
+
+    for(;;) {
+        ssize_t const length = read(bridge->fd, input, sizeof(input));
+
+        /* Likewise EPOLLIN reports the rest of an interrupted read on the next wait */
+        if(length <= 0) {
+            if(length == 0 || (errno != EAGAIN && errno != EINTR)) {
+                hangUp_(aggregator, bridge);
+            }
+            return;
+        }
+
+        bridge->statistics.bytesRead += length;
+        for(ssize_t i = 0; i<length; ++i) {
+            if(hdlcDecodeChar(&bridge->decoder, input[i]) == hdlcFrameOk) {
+                receive_(aggregator, bridge, bridge->decoder.length, now);
+            }
+        }
+    }
+}
+
+struct Aggregator * aggregatorCreate(unsigned const windowMs, AggregatorCallback const callback, void * const context)
+{
+    struct Aggregator * const aggregator = calloc(1, sizeof(*aggregator));
+
+    if(!aggregator) {
+        return NULL;
+    }
+
+    aggregator->epoll = epoll_create1(EPOLL_CLOEXEC);
+    if(aggregator->epoll < 0) {
+        free(aggregator);
+        return NULL;
+    }
+
+    aggregator->window = (int64_t)windowMs * 1000;
+    aggregator->callback = callback;
+    aggregator->context = context;
+    aggregator->lastTime = INT64_MIN;
+
+    return aggregator;
+}
+
+int aggregatorAdd(struct Aggregator * const aggregator, int const fd, struct AggregatorSchedule const * const schedule)
+{
+    if(aggregator->bridgeCount == AGGREGATOR_MAX_BRIDGES || schedule->firstAddress > schedule->lastAddress) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    unsigned const index = aggregator->bridgeCount;
+    struct Bridge * const bridge = &aggregator->bridges[index];
+    struct epoll_event event = { EPOLLIN, { .u32 = index } };
+    int const flags = fcntl(fd, F_GETFL);
+
+    if(flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0 ||
+       epoll_ctl(aggregator->epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+        return -1;
+    }
+
+    memset(bridge, 0, sizeof(*bridge));
+    bridge->fd = fd;
+    bridge->up = true;
+    bridge->schedule = *schedule;
+    bridge->address = schedule->firstAddress;
+    bridge->command = schedule->commands ? __builtin_ctz(schedule->commands) : 0;
+    bridge->nextRound = microseconds_();
+    hdlcDecoderInit(&bridge->decoder, bridge->message, sizeof(bridge->message));
+
+    ++aggregator->bridgeCount;
+    return index;
+}
+
+/* Earliest of the next round, the deadline of a transaction and the release of a held sample, in us from now */
+static int64_t nextEvent_(struct Aggregator const * const aggregator, int64_t const now)
+{
+    int64_t next = INT64_MAX;
+
+    for(unsigned i = 0; i<aggregator->bridgeCount; ++i) {
+        struct Bridge const * const bridge = &aggregator->bridges[i];
+
+        if(!bridge->up) {
+            continue;
+        }
+
+        if(bridge->pendingCount) {
+            int64_t const deadline = bridge->pending[0].sentAt + (int64_t)BRIDGE_TIMEOUT_MS * 1000;
+
+            next = deadline < next ? deadline : next;
+        }
+        if(bridge->schedule.commands && !bridge->inRound && bridge->pendingCount < BRIDGE_PIPELINE_DEPTH &&
+           bridge->nextRound < next) {
+            next = bridge->nextRound;
+        }
+    }
+
+    if(aggregator->heapLength && aggregator->heap[0].time + aggregator->window < next) {
+        next = aggregator->heap[0].time + aggregator->window;
+    }
+
+    return next - now;
+}
+
+int aggregatorRun(struct Aggregator * const aggregator, int const timeoutMs)
+{
+    int64_t const end = microseconds_() + (int64_t)timeoutMs * 1000;
+    struct epoll_event events[epollEvents];
+
+    for(;;) {
+        int64_t const now = microseconds_();
+        unsigned up = 0;
+
+        for(unsigned i = 0; i<aggregator->bridgeCount; ++i) {
+            struct Bridge * const bridge = &aggregator->bridges[i];
+
+            if(bridge->up && bridge->pendingCount &&
+               now - bridge->pending[0].sentAt > (int64_t)BRIDGE_TIMEOUT_MS * 1000) {
+                timeout_(aggregator, bridge, bridge->pendingCount);
+                hdlcDecoderInit(&bridge->decoder, bridge->message, sizeof(bridge->message));
+            }
+
+            if(bridge->up) {
+                submit_(bridge, now);
+                flush_(aggregator, bridge);
+            }
+
+            up += bridge->up;
+        }
+
+        emitDue_(aggregator, now);
+
+        if(now >= end || !up) {
+            return up;
+        }
+
+        int64_t wait = nextEvent_(aggregator, now);
+
+        wait = wait < end - now ? wait : end - now;
+        wait = wait < 0 ? 0 : (wait + 999) / 1000;
+
+        int const count = epoll_wait(aggregator->epoll, events, epollEvents, (int)wait);
+
+        if(count < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        int64_t const woken = microseconds_();
+
+        for(int i = 0; i<count; ++i) {
+            struct Bridge * const bridge = &aggregator->bridges[events[i].data.u32];
+
+            if(!bridge->up) {
+                continue;
+            }
+            if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                read_(aggregator, bridge, woken); //Sees the hang up once the input is drained
+            }
+            if(bridge->up && (events[i].events & EPOLLOUT)) {
+                flush_(aggregator, bridge);
+            }
+        }
+    }
+}
+
+void aggregatorStatistics(struct Aggregator const * const aggregator, unsigned const bridge,
+                          struct AggregatorStatistics * const statistics)
+{
+    *statistics = aggregator->bridges[bridge].statistics;
+}
+
+void aggregatorDestroy(struct Aggregator * const aggregator)
+{
+    while(aggregator->heapLength) {
+        struct AggregatorSample sample;
+
+        heapPop_(aggregator, &sample);
+        handOut_(aggregator, &sample);
+    }
+
+    for(unsigned i = 0; i<aggregator->bridgeCount; ++i) {
+        close(aggregator->bridges[i].fd);
+    }
+
+    close(aggregator->epoll);
+    free(aggregator->heap);
+    free(aggregator);
+}
@@ -0,0 +1,79 @@
+#ifndef BRIDGE_AGGREGATOR_H
+#define BRIDGE_AGGREGATOR_H
+
+#include <stdint.h>
+
+#include "protocol.h"
+#include "uartBridge/bridgeProtocol.h"
+
+/**
+ * Drives many bridges from one thread. The serial ports are non-blocking and served from one epoll set, every
+ * bridge polls its own address range on its own interval with up to BRIDGE_PIPELINE_DEPTH transactions on its bus.
+ * The results of all bridges and the samples their schedulers stream are merged into one stream in the order of
+ * their time: a sample is held for windowMs, the bridges answer within that in the normal case, and handed out
+ * once no earlier one can come any more.
+ */
+enum {
+    AGGREGATOR_MAX_BRIDGES = 64,
+    AGGREGATOR_STATUS_TIMEOUT = 0x20 //status of a transaction the bridge did not answer within BRIDGE_TIMEOUT_MS
+};
+
+struct AggregatorSchedule {
+    uint8_t firstAddress;
+    uint8_t lastAddress;
+    uint8_t commands;     //Bit mask of enum TelemetryCommandId sent to every address, 0 only listens
+    unsigned intervalMs;  //From the start of one round over the range to the next, 0 goes round back to back
+};
+
+struct AggregatorSample {
+    int64_t time;         //Host monotonic microseconds the request went out or the streamed sample arrived
+    unsigned bridge;      //Index returned by aggregatorAdd
+    uint8_t address;
+    uint8_t status;       //enum BridgeStatus or AGGREGATOR_STATUS_TIMEOUT
+    struct TelemetryCommand reply;
+};
+
+struct AggregatorStatistics {
+    unsigned long requests;
+    unsigned long samples;   //Answers and streamed samples handed out
+    unsigned long timeouts;
+    unsigned long late;      //Came after later ones were handed out already, handed out out of order
+    unsigned long bytesWritten;
+    unsigned long bytesRead;
+    int hungUp;
+};
+
+typedef void (*AggregatorCallback)(void * context, struct AggregatorSample const * sample);
+
+struct Aggregator;
+
+/**
+ * @brief aggregatorCreate sets up an aggregator without any bridge
+ * @return NULL with errno set on error
+ */
+struct Aggregator * aggregatorCreate(unsigned windowMs, AggregatorCallback callback, void * context);
+
+/**
+ * @brief aggregatorAdd takes over the descriptor of a bridge, see bridgeOpen() or bridgeEmulatorSpawn()
+ * It is switched to non-blocking and closed by aggregatorDestroy.
+ * @return Index of the bridge, -1 with errno set on error
+ */
+int aggregatorAdd(struct Aggregator * aggregator, int fd, struct AggregatorSchedule const * schedule);
+
+/**
+ * @brief aggregatorRun serves the bridges for timeoutMs, the callback gets the samples that are due meanwhile
+ * @return Number of bridges still up, -1 on error
+ */
+int aggregatorRun(struct Aggregator * aggregator, int timeoutMs);
+
+/**
+ * @brief aggregatorStatistics reads the counts of one bridge
+ */
+void aggregatorStatistics(struct Aggregator const * aggregator, unsigned bridge, struct AggregatorStatistics * statistics);
+
+/**
+ * @brief aggregatorDestroy hands out the samples still held back and closes the bridges
+ */
+void aggregatorDestroy(struct Aggregator * aggregator);
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ * Measures sensor transactions per second through the bridge, binary protocol against the debug shell:
+ *   bridgeBench <device> <binary|text|stream|pipelined> [count] [baud]
+ *   bridgeBench --emulate [count] [baud] [scl Hz]
+ * stream lets the scheduler of the bridge poll the sensors instead of the host, pipelined keeps
+ * BRIDGE_PIPELINE_DEPTH transactions outstanding. With --emulate all modes run
+ * against bridgeEmulator.c on a pseudo terminal.
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bridgeClient.h"
+#include "bridgeEmulator.h"
+
+static double seconds_( void )
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/* Reads the humidity of the sensors 1..8 in turn */
+static int run_(struct BridgeClient * const client, int const text, unsigned const count)
+{
+    unsigned failures = 0;
+    double const start = seconds_();
+
+    for(unsigned i = 0; i<count; ++i) {
+        struct TelemetryCommand const command = { telemetryHumidity, i & 0xff, 0 };
+        struct TelemetryCommand reply;
+        uint8_t const address = 1 + i % 8;
+        int const status = text ? bridgeTextTransact(client, address, &command, &reply)
+                                : bridgeTransact(client, address, &command, &reply);
+
+        if(status != bridgeStatusOk || reply.cmdId != command.cmdId || reply.cmdTag != command.cmdTag) {
+            ++failures;
+        }
+    }
+
+    double const elapsed = seconds_() - start;
+
+    printf("%-6s %6u transactions %8.1f tx/s %6.1f bytes/tx %6.2f ms/tx %u failed\n",
+           text ? "text" : "binary", count, count / elapsed,
+           (double)(client->bytesWritten + client->bytesRead) / count, elapsed * 1000 / count, failures);
+
+    return failures ? 1 : 0;
+}
+
+/* Keeps the bridge's pipeline full, the next request is on the line while the bus still works on the last one */
+static int pipelined_(struct BridgeClient * const client, unsigned const count, unsigned const depth)
+{
+    unsigned failures = 0;
+    unsigned submitted = 0;
+    unsigned long const bytes = client->bytesWritten + client->bytesRead;
+    double const start = seconds_();
+
+    for(unsigned i = 0; i<count; ++i) {
+        struct BridgeTransactionResult result;
+
+        while(submitted < count && submitted < i + depth) {
+            struct TelemetryCommand const command = { telemetryHumidity, submitted & 0xff, 0 };
+
+            bridgeSubmit(client, 1 + submitted % 8, &command);
+            ++submitted;
+        }
+
+        if(bridgeCollect(client, &result) != 0) {
+            fprintf(stderr, "Pipeline stalled\n");
+            return 1;
+        }
+
+        if(result.status != bridgeStatusOk || result.reply.cmdTag != (i & 0xff)) {
+            ++failures;
+        }
+    }
+
+    double const elapsed = seconds_() - start;
+
+    printf("pipe%-2u %6u transactions %8.1f tx/s %6.1f bytes/tx %6.2f ms/tx %u failed\n", depth, count,
+           count / elapsed, (double)(client->bytesWritten + client->bytesRead - bytes) / count, elapsed * 1000 / count,
+           failures);
+
+    return failures ? 1 : 0;
+}
+
+/* The bridge polls humidity and temperature of the sensors 1..8 on its own, the host only listens */
+static int stream_(struct BridgeClient * const client, unsigned const count)
+{
+    struct BridgeSample sample;
+    unsigned failures = 0;
+    unsigned lost = 0;
+
+    for(uint8_t address = 1; address <= 8; ++address) {
+        if(bridgeSchedule(client, address, (1<<telemetryHumidity) | (1<<telemetryTemperature), 0) != 0) {
+            fprintf(stderr, "Schedule refused\n");
+            return 1;
+        }
+    }
+
+    if(bridgeRun(client, 1) != 0 || bridgeReceiveSample(client, &sample, BRIDGE_TIMEOUT_MS) != 0) {
+        fprintf(stderr, "Scheduler did not start\n");
+        return 1;
+    }
+
+    unsigned long const bytesRead = client->bytesRead;
+    uint8_t sequence = sample.header.sequence;
+    double const start = seconds_();
+
+    for(unsigned i = 0; i<count; ++i) {
+        if(bridgeReceiveSample(client, &sample, BRIDGE_TIMEOUT_MS) != 0) {
+            fprintf(stderr, "Stream stopped\n");
+            return 1;
+        }
+
+        lost += (uint8_t)(sample.header.sequence - sequence - 1);
+        sequence = sample.header.sequence;
+
+        if(sample.status != bridgeStatusOk) {
+            ++failures;
+        }
+    }
+
+    double const elapsed = seconds_() - start;
+
+    printf("%-6s %6u transactions %8.1f tx/s %6.1f bytes/tx %6.2f ms/tx %u failed %u lost\n", "stream", count,
+           count / elapsed, (double)(client->bytesRead - bytesRead) / count, elapsed * 1000 / count, failures, lost);
+
+    bridgeRun(client, 0);
+    for(uint8_t address = 1; address <= 8; ++address) {
+        bridgeSchedule(client, address, 0, 0);
+    }
+
+    return failures || lost ? 1 : 0;
+}
+
+static int emulate_(int const mode, unsigned const count, struct BridgeEmulatorTiming const * const timing)
+{
+    struct BridgeClient client;
+    pid_t emulator;
+    int const fd = bridgeEmulatorSpawn(mode == 1 ? bridgeEmulatorText : bridgeEmulatorBinary, timing, &emulator);
+
+    if(fd < 0) {
+        perror("pty");
+        return 1;
+    }
+
+    bridgeAttach(&client, fd);
+
+    int const result = mode == 2 ? stream_(&client, count) :
+                       mode >= 3 ? pipelined_(&client, count, BRIDGE_PIPELINE_DEPTH) : run_(&client, mode == 1, count);
+
+    bridgeClose(&client);
+    kill(emulator, SIGTERM);
+    waitpid(emulator, NULL, 0);
+
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc > 1 && strcmp(argv[1], "--emulate") == 0) {
+        struct BridgeEmulatorTiming timing = { BRIDGE_DEFAULT_BAUD, 100000, 200 };
+        unsigned const count = argc > 2 ? atoi(argv[2]) : 200;
+
+        if(argc > 3) timing.baud = atoi(argv[3]);
+        if(argc > 4) timing.sclHz = atol(argv[4]);
+
+        printf("Emulated bridge, %u baud, SCL %lu Hz\n", timing.baud, timing.sclHz);
+        return emulate_(0, count, &timing) | emulate_(1, count, &timing) | emulate_(2, count, &timing) |
+               emulate_(3, count, &timing);
+    }
+
+    if(argc < 3) {
+        fprintf(stderr, "usage: %s <device> <binary|text|stream|pipelined> [count] [baud]\n       %s --emulate [count] [baud] [scl Hz]\n",
+                argv[0], argv[0]);
+        return 2;
+    }
+
+    struct BridgeClient client;
+    int const text = strcmp(argv[2], "text") == 0;
+    int const stream = strcmp(argv[2], "stream") == 0;
+    int const pipelined = strcmp(argv[2], "pipelined") == 0;
+    unsigned const count = argc > 3 ? atoi(argv[3]) : 200;
+    unsigned const baud = argc > 4 ? atoi(argv[4]) : BRIDGE_DEFAULT_BAUD;
+
+    if(bridgeOpen(&client, argv[1], baud) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    if(!text && bridgeHello(&client) != BRIDGE_PROTOCOL_VERSION) {
+        fprintf(stderr, "No binary protocol bridge on %s\n", argv[1]);
+        return 1;
+    }
+
+    int const result = stream ? stream_(&client, count) :
+                       pipelined ? pipelined_(&client, count, BRIDGE_PIPELINE_DEPTH) : run_(&client, text, count);
+    struct BridgeStatistics statistics;
+
+    if(!text && bridgeStatistics(&client, &statistics) == 0) {
+        printf("Bridge receive errors: %u hardware overruns, %u buffer overruns, %u framing\n",
+               statistics.hardwareOverruns, statistics.bufferOverruns, statistics.framingErrors);
+    }
+
+    bridgeClose(&client);
+    return result;
+}
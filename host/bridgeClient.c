@@ -0,0 +1,516 @@
+#include "bridgeClient.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static speed_t baudConstant_(unsigned const baud)
+{
+    switch(baud) {
+    case 9600:   return B9600;
+    case 19200:  return B19200;
+    case 38400:  return B38400;
+    case 57600:  return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 500000: return B500000;
+    case 1000000: return B1000000;
+    default:     return B0;
+    }
+}
+
+static long long milliseconds_( void )
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/* Returns the next byte from the line, -1 once the deadline passed */
+static int readByte_(struct BridgeClient * const client, long long const deadline)
+{
+    while(client->inputIndex == client->inputLength) {
+        long long const remaining = deadline - milliseconds_();
+        struct pollfd pollFd = { client->fd, POLLIN, 0 };
+
+        if(remaining <= 0 || poll(&pollFd, 1, (int)remaining) <= 0) {
+            return -1;
+        }
+
+        ssize_t const length = read(client->fd, client->input, sizeof(client->input));
+        if(length <= 0) {
+            if(length < 0 && (errno == EAGAIN || errno == EINTR)) {
+                continue;
+            }
+            return -1;
+        }
+
+        client->inputLength = length;
+        client->inputIndex = 0;
+        client->bytesRead += length;
+    }
+
+    return client->input[client->inputIndex++];
+}
+
+static int writeAll_(struct BridgeClient * const client, void const * const data, size_t const length)
+{
+    uint8_t const * bytes = data;
+    size_t written = 0;
+
+    while(written < length) {
+        ssize_t const result = write(client->fd, bytes + written, length - written);
+
+        if(result < 0) {
+            if(errno == EAGAIN || errno == EINTR) {
+                struct pollfd pollFd = { client->fd, POLLOUT, 0 };
+                poll(&pollFd, 1, BRIDGE_TIMEOUT_MS);
+                continue;
+            }
+            return -1;
+        }
+        written += result;
+    }
+
+    client->bytesWritten += length;
+    return 0;
+}
+
+int bridgeOpen(struct BridgeClient * const client, char const * const device, unsigned const baud)
+{
+    struct termios tty;
+    speed_t const speed = baudConstant_(baud);
+    int const fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if(fd < 0) {
+        return -1;
+    }
+
+    if(speed == B0 || tcgetattr(fd, &tty) != 0) {
+        close(fd);
+        errno = speed == B0 ? EINVAL : errno;
+        return -1;
+    }
+
+    cfmakeraw(&tty);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cflag &= ~(CSTOPB | CRTSCTS);
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+
+    if(tcsetattr(fd, TCSANOW, &tty) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    tcflush(fd, TCIOFLUSH);
+    bridgeAttach(client, fd);
+    return 0;
+}
+
+void bridgeAttach(struct BridgeClient * const client, int const fd)
+{
+    memset(client, 0, sizeof(*client));
+    client->fd = fd;
+    hdlcDecoderInit(&client->decoder, client->message, sizeof(client->message));
+}
+
+void bridgeClose(struct BridgeClient * const client)
+{
+    if(client->fd >= 0) {
+        close(client->fd);
+        client->fd = -1;
+    }
+}
+
+int bridgeSend(struct BridgeClient * const client, void const * const message, size_t const length)
+{
+    uint8_t frame[BRIDGE_MAX_FRAME];
+    size_t const frameLength = hdlcEncodeBuffer(message, length, frame, sizeof(frame));
+
+    return frameLength ? writeAll_(client, frame, frameLength) : -1;
+}
+
+int bridgeReceive(struct BridgeClient * const client, void * const message, size_t const size, int const timeoutMs)
+{
+    long long const deadline = milliseconds_() + timeoutMs;
+
+    for(;;) {
+        int const byte = readByte_(client, deadline);
+
+        if(byte < 0) {
+            return -1;
+        }
+
+        if(hdlcDecodeChar(&client->decoder, byte) == hdlcFrameOk) {
+            size_t const length = client->decoder.length < size ? client->decoder.length : size;
+
+            memcpy(message, client->message, length);
+            return length;
+        }
+    }
+}
+
+/* Waits for the message of the given request, stale answers of timed out requests are dropped */
+static int receiveAnswerWithin_(struct BridgeClient * const client, uint8_t const sequence, void * const answer,
+                                size_t const size, int const timeoutMs)
+{
+    long long const deadline = milliseconds_() + timeoutMs;
+
+    for(;;) {
+        uint8_t message[BRIDGE_MAX_MESSAGE];
+        int const length = bridgeReceive(client, message, sizeof(message), (int)(deadline - milliseconds_()));
+        struct BridgeHeader const * const header = (struct BridgeHeader const *)message;
+
+        if(length < 0) {
+            return -1;
+        }
+
+        /* Samples have their own sequence numbers, they are handed on while waiting */
+        if(length == sizeof(struct BridgeSample) && header->opcode == bridgeOpSample) {
+            if(client->sampleReceived) {
+                client->sampleReceived(client, (struct BridgeSample const *)message);
+            }
+        } else if(length >= (int)sizeof(*header) && header->sequence == sequence) {
+            memcpy(answer, message, (size_t)length < size ? (size_t)length : size);
+            return length;
+        }
+    }
+}
+
+static int receiveAnswer_(struct BridgeClient * const client, uint8_t const sequence, void * const answer,
+                          size_t const size)
+{
+    return receiveAnswerWithin_(client, sequence, answer, size, BRIDGE_TIMEOUT_MS);
+}
+
+int bridgeHello(struct BridgeClient * const client)
+{
+    struct BridgeHello hello = { { bridgeOpHello, ++client->sequence }, BRIDGE_PROTOCOL_VERSION, 0 };
+
+    if(bridgeSend(client, &hello, sizeof(hello)) != 0 ||
+       receiveAnswer_(client, hello.header.sequence, &hello, sizeof(hello)) != sizeof(hello) ||
+       hello.header.opcode != bridgeOpHello) {
+        return -1;
+    }
+
+    return hello.version;
+}
+
+int bridgeStatistics(struct BridgeClient * const client, struct BridgeStatistics * const statistics)
+{
+    struct BridgeHeader const request = { bridgeOpStatistics, ++client->sequence };
+
+    if(bridgeSend(client, &request, sizeof(request)) != 0 ||
+       receiveAnswer_(client, request.sequence, statistics, sizeof(*statistics)) != sizeof(*statistics) ||
+       statistics->header.opcode != bridgeOpStatistics) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int bridgeTransact(struct BridgeClient * const client, uint8_t const address, struct TelemetryCommand const * const command,
+                   struct TelemetryCommand * const reply)
+{
+    struct BridgeTransaction const transaction = { { bridgeOpTransaction, ++client->sequence }, address, 0, *command };
+    struct BridgeTransactionResult result;
+
+    if(bridgeSend(client, &transaction, sizeof(transaction)) != 0) {
+        return -1;
+    }
+
+    int const length = receiveAnswer_(client, transaction.header.sequence, &result, sizeof(result));
+
+    if(length == sizeof(struct BridgeHello) && result.header.opcode == bridgeOpError) {
+        return result.address; //The status byte of the error message
+    }
+
+    if(length != sizeof(result) || result.header.opcode != bridgeOpTransaction) {
+        return -1;
+    }
+
+    if(reply) {
+        *reply = result.reply;
+    }
+
+    return result.status;
+}
+
+int bridgeSubmit(struct BridgeClient * const client, uint8_t const address, struct TelemetryCommand const * const command)
+{
+    struct BridgeTransaction const transaction = { { bridgeOpTransaction, ++client->sequence }, address, 0, *command };
+
+    return bridgeSend(client, &transaction, sizeof(transaction)) == 0 ? transaction.header.sequence : -1;
+}
+
+int bridgeCollect(struct BridgeClient * const client, struct BridgeTransactionResult * const result)
+{
+    long long const deadline = milliseconds_() + BRIDGE_TIMEOUT_MS;
+
+    for(;;) {
+        uint8_t message[BRIDGE_MAX_MESSAGE];
+        int const length = bridgeReceive(client, message, sizeof(message), (int)(deadline - milliseconds_()));
+        struct BridgeHeader const * const header = (struct BridgeHeader const *)message;
+
+        if(length < 0) {
+            return -1;
+        }
+
+        if(length == sizeof(struct BridgeSample) && header->opcode == bridgeOpSample) {
+            if(client->sampleReceived) {
+                client->sampleReceived(client, (struct BridgeSample const *)message);
+            }
+        } else if(length == sizeof(*result) && header->opcode == bridgeOpTransaction) {
+            memcpy(result, message, sizeof(*result));
+            return 0;
+        }
+    }
+}
+
+int bridgeEnumerate(struct BridgeClient * const client, uint8_t const firstAddress, uint16_t const slots, int const all,
+                    BridgeAssignedCallback const assigned, struct BridgeEnumerateResult * const result)
+{
+    struct BridgeEnumerate const enumerate = { { bridgeOpEnumerate, ++client->sequence }, firstAddress, all != 0, slots };
+    union {
+        struct BridgeHeader header;
+        struct BridgeAssigned assigned;
+        struct BridgeEnumerateResult result;
+    } answer;
+
+    if(bridgeSend(client, &enumerate, sizeof(enumerate)) != 0) {
+        return -1;
+    }
+
+    /* Every assigned address resets the timeout, a large bus takes a while */
+    for(;;) {
+        int const length = receiveAnswer_(client, enumerate.header.sequence, &answer, sizeof(answer));
+
+        if(length == sizeof(answer.assigned) && answer.header.opcode == bridgeOpAssigned) {
+            if(assigned) {
+                assigned(answer.assigned.address, answer.assigned.id);
+            }
+        } else if(length == sizeof(answer.result) && answer.header.opcode == bridgeOpEnumerate) {
+            if(result) {
+                *result = answer.result;
+            }
+            return 0;
+        } else {
+            return -1;
+        }
+    }
+}
+
+int bridgeSchedule(struct BridgeClient * const client, uint8_t const address, uint8_t const commands,
+                   uint16_t const interval)
+{
+    struct BridgeSchedule schedule = { { bridgeOpSchedule, ++client->sequence }, address, commands, interval };
+
+    if(bridgeSend(client, &schedule, sizeof(schedule)) != 0) {
+        return -1;
+    }
+
+    int const length = receiveAnswer_(client, schedule.header.sequence, &schedule, sizeof(schedule));
+
+    if(length == sizeof(struct BridgeHello) && schedule.header.opcode == bridgeOpError) {
+        return schedule.address; //The status byte of the error message
+    }
+
+    return length == sizeof(schedule) && schedule.header.opcode == bridgeOpSchedule ? 0 : -1;
+}
+
+int bridgeReport(struct BridgeClient * const client, uint8_t const address, uint8_t const command,
+                 uint16_t const deadband, uint8_t const heartbeat)
+{
+    struct BridgeReport report = { { bridgeOpReport, ++client->sequence }, address, command, deadband, heartbeat, 0 };
+
+    if(bridgeSend(client, &report, sizeof(report)) != 0) {
+        return -1;
+    }
+
+    int const length = receiveAnswer_(client, report.header.sequence, &report, sizeof(report));
+
+    if(length == sizeof(struct BridgeHello) && report.header.opcode == bridgeOpError) {
+        return report.address; //The status byte of the error message
+    }
+
+    return length == sizeof(report) && report.header.opcode == bridgeOpReport ? 0 : -1;
+}
+
+int bridgeReportSummary(struct BridgeClient * const client, struct BridgeReportSummary * const summary)
+{
+    struct BridgeHeader const request = { bridgeOpReportSummary, ++client->sequence };
+
+    if(bridgeSend(client, &request, sizeof(request)) != 0 ||
+       receiveAnswer_(client, request.sequence, summary, sizeof(*summary)) != sizeof(*summary) ||
+       summary->header.opcode != bridgeOpReportSummary) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int bridgeTrace(struct BridgeClient * const client, struct BridgeTraceData * const data)
+{
+    struct BridgeHeader const request = { bridgeOpTrace, ++client->sequence };
+
+    if(bridgeSend(client, &request, sizeof(request)) != 0) {
+        return -1;
+    }
+
+    int const length = receiveAnswer_(client, request.sequence, data, sizeof(*data));
+
+    if(length == sizeof(struct BridgeHello) && data->header.opcode == bridgeOpError) {
+        return data->length; //The status byte of the error message
+    }
+
+    return length == sizeof(*data) && data->header.opcode == bridgeOpTrace && data->length <= sizeof(data->data) ?
+           0 : -1;
+}
+
+int bridgeRun(struct BridgeClient * const client, int const run)
+{
+    struct BridgeRun message = { { bridgeOpRun, ++client->sequence }, run != 0, 0 };
+
+    if(bridgeSend(client, &message, sizeof(message)) != 0 ||
+       receiveAnswer_(client, message.header.sequence, &message, sizeof(message)) != sizeof(message) ||
+       message.header.opcode != bridgeOpRun) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* The calibration pings at every speed, up to a few seconds for a sensor on a long cable */
+static int speedRequest_(struct BridgeClient * const client, uint8_t const opcode, uint8_t const address,
+                         uint8_t const speed, struct BridgeSpeed * const result)
+{
+    struct BridgeSpeed message = { { opcode, ++client->sequence }, address, speed, 0 };
+
+    if(bridgeSend(client, &message, sizeof(message)) != 0) {
+        return -1;
+    }
+
+    int const length = receiveAnswerWithin_(client, message.header.sequence, &message, sizeof(message),
+                                            opcode == bridgeOpCalibrateSpeed ? 10 * BRIDGE_TIMEOUT_MS : BRIDGE_TIMEOUT_MS);
+
+    if(length == sizeof(struct BridgeHello) && message.header.opcode == bridgeOpError) {
+        return message.address; //The status byte of the error message
+    }
+
+    if(length != sizeof(message) || message.header.opcode != opcode) {
+        return -1;
+    }
+
+    if(result) {
+        *result = message;
+    }
+
+    return 0;
+}
+
+int bridgeCalibrateSpeed(struct BridgeClient * const client, uint8_t const address, struct BridgeSpeed * const result)
+{
+    return speedRequest_(client, bridgeOpCalibrateSpeed, address, 0, result);
+}
+
+int bridgeSetSpeed(struct BridgeClient * const client, uint8_t const address, uint8_t const speed)
+{
+    return speedRequest_(client, bridgeOpSpeed, address, speed, NULL);
+}
+
+int bridgeReceiveSample(struct BridgeClient * const client, struct BridgeSample * const sample, int const timeoutMs)
+{
+    for(;;) {
+        int const length = bridgeReceive(client, sample, sizeof(*sample), timeoutMs);
+
+        if(length < 0) {
+            return -1;
+        }
+
+        if(length == sizeof(*sample) && sample->header.opcode == bridgeOpSample) {
+            return 0;
+        }
+    }
+}
+
+/* Reads one line of shell output, the prompt counts as a line of its own */
+static int readLine_(struct BridgeClient * const client, char * const line, size_t const size, long long const deadline)
+{
+    size_t length = 0;
+
+    for(;;) {
+        int const byte = readByte_(client, deadline);
+
+        if(byte < 0) {
+            return -1;
+        }
+
+        if(byte == '\n') {
+            break;
+        }
+
+        if(length + 1 < size) {
+            line[length++] = byte;
+        }
+
+        if(length == 3 && memcmp(line, ">> ", 3) == 0) {
+            break;
+        }
+    }
+
+    line[length] = 0;
+    return length;
+}
+
+int bridgeTextTransact(struct BridgeClient * const client, uint8_t const address, struct TelemetryCommand const * const command,
+                       struct TelemetryCommand * const reply)
+{
+    char line[64];
+    int const length = snprintf(line, sizeof(line), "t %x %u %u %u\r", address, command->cmdId, command->cmdTag,
+                                command->parameter);
+    long long const deadline = milliseconds_() + BRIDGE_TIMEOUT_MS;
+    int status = -1;
+
+    if(writeAll_(client, line, length) != 0) {
+        return -1;
+    }
+
+    char echo[64];
+    bool echoed = false;
+
+    memcpy(echo, line, length - 1); //Without the '\r'
+    echo[length - 1] = 0;
+
+    /* The shell echoes the command line, prints the reply if there is one and the result, then prompts again. What
+     * came before the echo, like the banner of a bridge that just started, is skipped. */
+    while(readLine_(client, line, sizeof(line), deadline) >= 0) {
+        unsigned id, tag, parameter, busStatus;
+        int result;
+
+        if(!echoed) {
+            echoed = strncmp(line, echo, strlen(echo)) == 0;
+            continue;
+        }
+
+        if(strcmp(line, ">> ") == 0) {
+            return status;
+        }
+
+        if(reply && sscanf(line, "Reply: %u %u %u", &id, &tag, &parameter) == 3) {
+            reply->cmdId = id;
+            reply->cmdTag = tag;
+            reply->parameter = parameter;
+        } else if(sscanf(line, "Result: %d %u", &result, &busStatus) == 2) {
+            status = result;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,159 @@
+#ifndef BRIDGE_CLIENT_H
+#define BRIDGE_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hdlc.h"
+#include "protocol.h"
+#include "uartBridge/bridgeProtocol.h"
+
+/**
+ * Host side of the serial link to the bridge. The binary functions speak the HDLC framed protocol of
+ * bridgeProtocol.h, bridgeTextTransact() drives the debug shell of a bridge built with BRIDGE_DEBUG_SHELL.
+ */
+struct BridgeClient;
+
+typedef void (*BridgeAssignedCallback)(uint8_t address, uint32_t id);
+typedef void (*BridgeSampleCallback)(struct BridgeClient * client, struct BridgeSample const * sample);
+
+struct BridgeClient {
+    int fd;
+    BridgeSampleCallback sampleReceived; //Gets the samples that arrive while waiting for an answer, may be NULL
+    uint8_t sequence;
+    struct HdlcDecoder decoder;
+    uint8_t message[BRIDGE_MAX_MESSAGE];
+    uint8_t input[64];          //Read from the line but not decoded yet
+    size_t inputLength;
+    size_t inputIndex;
+    unsigned long bytesWritten; //Line statistics for the benchmarks
+    unsigned long bytesRead;
+};
+
+enum {
+    BRIDGE_DEFAULT_BAUD = 38400,
+    BRIDGE_TIMEOUT_MS = 1000
+};
+
+/**
+ * @brief bridgeOpen opens the serial device raw at baud, 8N1
+ * @return 0 on success, -1 with errno set otherwise
+ */
+int bridgeOpen(struct BridgeClient * client, char const * device, unsigned baud);
+
+/**
+ * @brief bridgeAttach uses an already open descriptor, e.g. a pty, without changing its line settings
+ */
+void bridgeAttach(struct BridgeClient * client, int fd);
+
+void bridgeClose(struct BridgeClient * client);
+
+/**
+ * @brief bridgeSend frames and writes one message
+ * @return 0 on success, -1 otherwise
+ */
+int bridgeSend(struct BridgeClient * client, void const * message, size_t length);
+
+/**
+ * @brief bridgeReceive waits for the next frame with a correct CRC, broken frames are skipped
+ * @return Length of the message, -1 on timeout or error
+ */
+int bridgeReceive(struct BridgeClient * client, void * message, size_t size, int timeoutMs);
+
+/**
+ * @brief bridgeHello checks that the bridge speaks the binary protocol
+ * @return Protocol version of the bridge, -1 if it did not answer
+ */
+int bridgeHello(struct BridgeClient * client);
+
+/**
+ * @brief bridgeStatistics reads the receive error counters of the bridge's UART
+ * @return 0 on success, -1 if the bridge did not answer
+ */
+int bridgeStatistics(struct BridgeClient * client, struct BridgeStatistics * statistics);
+
+/**
+ * @brief bridgeTransact sends a command to the sensor at address and returns its reply
+ * @return enum BridgeStatus, -1 if the bridge did not answer
+ */
+int bridgeTransact(struct BridgeClient * client, uint8_t address, struct TelemetryCommand const * command,
+                   struct TelemetryCommand * reply);
+
+/**
+ * @brief bridgeSubmit sends a transaction without waiting for its result, the bridge works on up to
+ * BRIDGE_PIPELINE_DEPTH of them at once. Collect the results with bridgeCollect in the same order.
+ * @return Sequence number of the request, -1 on error
+ */
+int bridgeSubmit(struct BridgeClient * client, uint8_t address, struct TelemetryCommand const * command);
+
+/**
+ * @brief bridgeCollect waits for the result of the oldest submitted transaction
+ * @return 0 on success, -1 on timeout
+ */
+int bridgeCollect(struct BridgeClient * client, struct BridgeTransactionResult * result);
+
+/**
+ * @brief bridgeEnumerate runs an address enumeration on the bus, assigned is called for every new address
+ * @return 0 on success, -1 if the bridge did not answer
+ */
+int bridgeEnumerate(struct BridgeClient * client, uint8_t firstAddress, uint16_t slots, int all,
+                    BridgeAssignedCallback assigned, struct BridgeEnumerateResult * result);
+
+/**
+ * @brief bridgeSchedule sets the commands the bridge polls the sensor at address with, see scheduler.h
+ * @param interval In 100 ms
+ * @return 0 on success, enum BridgeStatus if the bridge refused the entry, -1 if it did not answer
+ */
+int bridgeSchedule(struct BridgeClient * client, uint8_t address, uint8_t commands, uint16_t interval);
+
+/**
+ * @brief bridgeReport sets the report filter of a scheduled command, see struct BridgeReport
+ * @return 0 on success, enum BridgeStatus if the bridge refused the filter, -1 if it did not answer
+ */
+int bridgeReport(struct BridgeClient * client, uint8_t address, uint8_t command, uint16_t deadband, uint8_t heartbeat);
+
+/**
+ * @brief bridgeReportSummary reads the counts of the samples the report filters passed and held back
+ * @return 0 on success, -1 if the bridge did not answer
+ */
+int bridgeReportSummary(struct BridgeClient * client, struct BridgeReportSummary * summary);
+
+/**
+ * @brief bridgeTrace takes the next chunk of the bus trace from a bridge built with BRIDGE_TRACE, see trace.h
+ * @return 0 on success, the chunk is empty once the trace is read up, enum BridgeStatus if the bridge has no trace,
+ * -1 if it did not answer
+ */
+int bridgeTrace(struct BridgeClient * client, struct BridgeTraceData * data);
+
+/**
+ * @brief bridgeRun starts or stops the scheduler of the bridge
+ * @return 0 on success, -1 if the bridge did not answer
+ */
+int bridgeRun(struct BridgeClient * client, int run);
+
+/**
+ * @brief bridgeCalibrateSpeed lets the bridge find and store the fastest SCL rate the sensor at address works at
+ * @return 0 on success with the speed in result, enum BridgeStatus on failure, -1 if the bridge did not answer
+ */
+int bridgeCalibrateSpeed(struct BridgeClient * client, uint8_t address, struct BridgeSpeed * result);
+
+/**
+ * @brief bridgeSetSpeed stores the SCL rate, enum TwiSpeed, for the sensor at address without calibrating it
+ * @return 0 on success, enum BridgeStatus if the bridge refused it, -1 if the bridge did not answer
+ */
+int bridgeSetSpeed(struct BridgeClient * client, uint8_t address, uint8_t speed);
+
+/**
+ * @brief bridgeReceiveSample waits for the next sample streamed by the scheduler, other messages are dropped
+ * @return 0 on success, -1 on timeout
+ */
+int bridgeReceiveSample(struct BridgeClient * client, struct BridgeSample * sample, int timeoutMs);
+
+/**
+ * @brief bridgeTextTransact does the same as bridgeTransact through the 't' command of the debug shell
+ * @return Request status printed by the shell, -1 if the output could not be parsed
+ */
+int bridgeTextTransact(struct BridgeClient * client, uint8_t address, struct TelemetryCommand const * command,
+                       struct TelemetryCommand * reply);
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * Serves an emulated bridge on a pseudo terminal, so host software can be tried without hardware:
+ *   bridgeEmu [binary|text] [baud] [scl Hz]
+ * The name of the terminal to open is printed on startup.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bridgeEmulator.h"
+
+int main(int argc, char **argv)
+{
+    struct BridgeEmulatorTiming timing = { 38400, 100000, 200 };
+    enum BridgeEmulatorMode const mode = argc > 1 && strcmp(argv[1], "text") == 0 ? bridgeEmulatorText : bridgeEmulatorBinary;
+    char slaveName[64];
+
+    if(argc > 2) timing.baud = atoi(argv[2]);
+    if(argc > 3) timing.sclHz = atol(argv[3]);
+
+    int const fd = bridgeEmulatorOpen(slaveName, sizeof(slaveName));
+    if(fd < 0) {
+        perror("pty");
+        return 1;
+    }
+
+    /* Keep the slave open, otherwise the emulator sees a hang up between two clients */
+    int const keepOpen = open(slaveName, O_RDWR | O_NOCTTY);
+
+    printf("%s\n", slaveName);
+    fflush(stdout);
+
+    bridgeEmulatorRun(fd, mode, &timing);
+
+    close(keepOpen);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,504 @@
+#define _GNU_SOURCE
+#include "bridgeEmulator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hdlc.h"
+#include "protocol.h"
+#include "sim/simDevice.h"
+#include "sim/util/delay.h"
+#include "uartBridge/alertLine.h"
+#include "uartBridge/busSpeed.h"
+#include "uartBridge/clock.h"
+#include "uartBridge/hostLink.h"
+#include "uartBridge/rs232.h"
+#include "uartBridge/shell.h"
+#include "uartBridge/trace.h"
+#include "uartBridge/twiMaster.h"
+
+enum {
+    txBufferSize = 128,         //Transmit ring of rs232.cpp, one byte of it stays free
+    maxInput = 64,
+    idleMicroseconds = 1000     //Resolution of clockMillis(), the retries and the schedule wait in whole ms
+};
+
+/* Nominal SCL of enum TwiSpeed, the bridge's dividers come within a few percent */
+static unsigned long const speedHz_[twiSpeeds] = { 245, 245, 1000, 4000, 10000, 25000, 50000, 100000, 200000 };
+
+struct Emulator {
+    int fd;
+    struct BridgeEmulatorTiming timing;
+    long long start;            //Microsecond clockMillis() counts from
+    bool progress;              //The firmware read, wrote or queued something since the last look
+    /* UART */
+    uint8_t input[maxInput];    //From the host, not through the UART yet
+    long long inputAt[maxInput]; //Microsecond each byte is completely received
+    size_t inputIndex;
+    size_t inputLength;
+    long long lineFreeAt;       //Microsecond the last received byte is completely on the line
+    uint8_t output[txBufferSize]; //Transmit buffer of the bridge
+    size_t outputLength;
+    long long outputStart;      //Microsecond the UART started to send output[0]
+    /* TWI */
+    struct TwiJob * queueHead;  //On the bus, the queue follows through next
+    struct TwiJob * queueTail;
+    long long jobDoneAt;        //Microsecond the head job is through
+    bool completing;            //In the completion callbacks, a job they queue follows the finished one right away
+    uint8_t replies[TELEMETRY_PROBE_ADDRESS][TELEMETRY_MAX_REPLY_FRAME]; //Queued by each sensor
+};
+
+static struct Emulator emulator_;
+
+static long long microseconds_( void )
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static long long byteTime_( void )
+{
+    return 10 * 1000000LL / emulator_.timing.baud;
+}
+
+/* Hands the bytes the UART has completely sent by now to the host */
+static void flush_( void )
+{
+    if(emulator_.outputLength == 0) {
+        return;
+    }
+
+    long long const sent = (microseconds_() - emulator_.outputStart) / byteTime_();
+    size_t const length = sent < (long long)emulator_.outputLength ? (size_t)sent : emulator_.outputLength;
+
+    if(length == 0) {
+        return;
+    }
+
+    if(write(emulator_.fd, emulator_.output, length) < 0) {
+        perror("emulator write");
+    }
+
+    emulator_.outputLength -= length;
+    emulator_.outputStart += length * byteTime_();
+    memmove(emulator_.output, emulator_.output + length, emulator_.outputLength);
+}
+
+/* The sensors keep up with the speed of the job, a general call is taken by all of them. Every node is configured,
+ * none answers on the probe address. */
+static bool acknowledges_(struct TwiJob const * const job)
+{
+    return job->address < TELEMETRY_PROBE_ADDRESS &&
+           twiMasterSpeedHz(job->bus, job->speed) <= emulator_.timing.sclHz;
+}
+
+/* START, address and data with their ACK bits, repeated START, address and the read buffer, STOP */
+static long long busMicroseconds_(struct TwiJob const * const job)
+{
+    unsigned long bits = 2;
+    long long processing = 0;
+
+    if(!acknowledges_(job)) {
+        bits += 9;
+    } else {
+        if(job->txLength || !job->rxLength) {
+            bits += 9 * (1 + job->txLength);
+            processing = job->txLength ? emulator_.timing.processingMicroseconds : 0;
+        }
+
+        if(job->rxLength) {
+            bits += 1 + 9 * (1 + job->rxLength);
+        }
+    }
+
+    return bits * 1000000LL / twiMasterSpeedHz(job->bus, job->speed) + processing;
+}
+
+/* Runs the job on the emulated sensor, which keeps its reply until the next command */
+static uint8_t transfer_(struct TwiJob const * const job)
+{
+    if(!acknowledges_(job)) {
+        return twiJobAddressNack;
+    }
+
+    if(job->address == TELEMETRY_GENERAL_CALL_ADDRESS) {
+        return twiJobOk;
+    }
+
+    uint8_t * const reply = emulator_.replies[job->address];
+
+    if(job->txLength) {
+        struct TelemetryCommand command;
+        struct HdlcDecoder decoder;
+        enum HdlcResult result = hdlcPending;
+
+        hdlcDecoderInit(&decoder, &command, sizeof(command));
+        for(uint8_t i = 0; i<job->txLength && result != hdlcFrameOk; ++i) {
+            result = hdlcDecodeChar(&decoder, job->txBuffer[i]);
+        }
+
+        if(result == hdlcFrameOk && decoder.length == sizeof(command)) {
+            switch(command.cmdId) {
+            case telemetryId:          command.parameter = (2<<8)|(1<<2)|(1<<1)|(1<<0); break;
+            case telemetryHumidity:    command.parameter = 4500 + job->address; break;
+            case telemetryTemperature: command.parameter = 2150 + job->address; break;
+            default: break; //Echoed, the pings of the calibration come back intact
+            }
+
+            memset(reply, 0, TELEMETRY_MAX_REPLY_FRAME);
+            hdlcEncodeBuffer(&command, sizeof(command), reply, TELEMETRY_MAX_REPLY_FRAME);
+        }
+    }
+
+    if(job->rxLength) {
+        memset(job->rxBuffer, 0, job->rxLength);
+        memcpy(job->rxBuffer, reply, job->rxLength < TELEMETRY_MAX_REPLY_FRAME ? job->rxLength : TELEMETRY_MAX_REPLY_FRAME);
+    }
+
+    return twiJobOk;
+}
+
+/* Completes the jobs the bus is through with, as the TWI interrupt of the bridge does */
+static void serviceBus_( void )
+{
+    long long const now = microseconds_();
+
+    emulator_.completing = true;
+
+    while(emulator_.queueHead && emulator_.jobDoneAt <= now) {
+        struct TwiJob * const job = emulator_.queueHead;
+
+        emulator_.queueHead = job->next;
+        if(emulator_.queueHead) {
+            emulator_.jobDoneAt += busMicroseconds_(emulator_.queueHead);
+        }
+
+        job->status = transfer_(job);
+        traceJob(job, clockMillis());
+        emulator_.progress = true;
+
+        if(job->completed) {
+            job->completed(job);
+        }
+    }
+
+    emulator_.completing = false;
+}
+
+/* Sleeps while the UART and the bus keep working in the background, as the interrupt driven ones of the bridge do */
+static void sleepUntil_(long long const when)
+{
+    for(;;) {
+        serviceBus_();
+        flush_();
+
+        long long const now = microseconds_();
+        long long wake = when;
+
+        if(now >= when) {
+            return;
+        }
+
+        if(emulator_.queueHead && emulator_.jobDoneAt < wake) {
+            wake = emulator_.jobDoneAt;
+        }
+
+        if(emulator_.outputLength && emulator_.outputStart + byteTime_() < wake) {
+            wake = emulator_.outputStart + byteTime_();
+        }
+
+        if(wake > now) {
+            struct timespec const delay = { (wake - now) / 1000000, ((wake - now) % 1000000) * 1000 };
+            nanosleep(&delay, NULL);
+        }
+    }
+}
+
+/* What the firmware needs from its drivers */
+
+void twiMasterSubmit(struct TwiJob * const job)
+{
+    job->status = twiJobPending;
+    job->next = NULL;
+
+    if(emulator_.queueHead) {
+        emulator_.queueTail->next = job;
+    } else {
+        long long const now = microseconds_();
+
+        emulator_.queueHead = job;
+        emulator_.jobDoneAt = (emulator_.completing ? emulator_.jobDoneAt : now) + busMicroseconds_(job);
+    }
+
+    emulator_.queueTail = job;
+    emulator_.progress = true;
+}
+
+uint8_t twiMasterTransfer(struct TwiJob * const job)
+{
+    twiMasterSubmit(job);
+
+    while(job->status == twiJobPending) {
+        sleepUntil_(emulator_.jobDoneAt);
+    }
+
+    return job->status;
+}
+
+uint32_t twiMasterSpeedHz(uint8_t const bus, uint8_t const speed)
+{
+    return speed < twiSpeeds ? speedHz_[speed] : speedHz_[twiSpeedDefault];
+}
+
+bool twiMasterIdle( void )
+{
+    return emulator_.queueHead == NULL;
+}
+
+bool rs232ByteAvailable( void )
+{
+    return emulator_.inputIndex < emulator_.inputLength &&
+           emulator_.inputAt[emulator_.inputIndex] <= microseconds_();
+}
+
+uint8_t rs232ReadByte( void )
+{
+    if(!rs232ByteAvailable()) {
+        return 0;
+    }
+
+    emulator_.progress = true;
+    return emulator_.input[emulator_.inputIndex++];
+}
+
+uint8_t rs232TxSpace( void )
+{
+    flush_();
+    return txBufferSize - 1 - emulator_.outputLength;
+}
+
+bool rs232WriteByte(uint8_t const data)
+{
+    if(rs232TxSpace() == 0) {
+        sleepUntil_(emulator_.outputStart + byteTime_()); //The UDRE interrupt drains it meanwhile
+        return false;
+    }
+
+    if(emulator_.outputLength == 0) {
+        emulator_.outputStart = microseconds_();
+    }
+
+    emulator_.output[emulator_.outputLength++] = data;
+    emulator_.progress = true;
+    return true;
+}
+
+static void putByte_(uint8_t const data)
+{
+    while(!rs232WriteByte(data)) {}
+}
+
+void rs232SendString(char const * string)
+{
+    for(; *string; ++string) {
+        if(*string == '\n') {
+            putByte_('\r');
+        }
+
+        putByte_(*string);
+    }
+}
+
+void rs232SendHexByte(uint8_t const byte)
+{
+    static char const hex[] = "0123456789ABCDEF";
+
+    putByte_(hex[byte >> 4]);
+    putByte_(hex[byte & 0x0f]);
+}
+
+void rs232GetStatistics(struct Rs232Statistics * const statistics)
+{
+    memset(statistics, 0, sizeof(*statistics)); //The pty doesn't lose bytes
+}
+
+uint32_t clockMillis( void )
+{
+    return (microseconds_() - emulator_.start) / 1000;
+}
+
+void _delay_ms(double const ms)
+{
+    sleepUntil_(microseconds_() + (long long)(ms * 1000));
+}
+
+/* The emulated sensors have no thresholds set, the line stays released */
+void alertLineInit( void )
+{
+}
+
+bool alertLineAsserted( void )
+{
+    return false;
+}
+
+/* When the firmware did nothing, it waits for the next byte or job or the next millisecond */
+static long long nextEvent_( void )
+{
+    long long const now = microseconds_();
+    long long next = now + idleMicroseconds;
+
+    if(emulator_.queueHead && emulator_.jobDoneAt < next) {
+        next = emulator_.jobDoneAt;
+    }
+
+    if(emulator_.outputLength && emulator_.outputStart + byteTime_() < next) {
+        next = emulator_.outputStart + byteTime_();
+    }
+
+    if(emulator_.inputIndex < emulator_.inputLength && emulator_.inputAt[emulator_.inputIndex] > now &&
+       emulator_.inputAt[emulator_.inputIndex] < next) {
+        next = emulator_.inputAt[emulator_.inputIndex];
+    }
+
+    return next > now ? next - now : 0;
+}
+
+/* Takes what the host sent once the last bytes went through the UART, false once the host hung up */
+static bool receive_(long long const timeout)
+{
+    struct pollfd pollFd = { emulator_.fd, POLLIN, 0 };
+    struct timespec const wait = { timeout / 1000000, (timeout % 1000000) * 1000 };
+
+    if(emulator_.inputIndex < emulator_.inputLength) {
+        nanosleep(&wait, NULL);
+        return true;
+    }
+
+    if(ppoll(&pollFd, 1, &wait, NULL) <= 0) {
+        return true;
+    }
+
+    ssize_t const length = read(emulator_.fd, emulator_.input, sizeof(emulator_.input));
+
+    if(length <= 0) {
+        return length < 0 && errno == EINTR; //EIO once the slave side is closed
+    }
+
+    /* The request was on the line for 10 bit times per byte, the bridge sees each byte after it arrived */
+    long long const now = microseconds_();
+
+    if(emulator_.lineFreeAt < now) {
+        emulator_.lineFreeAt = now;
+    }
+
+    for(ssize_t i = 0; i<length; ++i) {
+        emulator_.lineFreeAt += byteTime_();
+        emulator_.inputAt[i] = emulator_.lineFreeAt;
+    }
+
+    emulator_.inputIndex = 0;
+    emulator_.inputLength = length;
+    return true;
+}
+
+int bridgeEmulatorOpen(char * const slaveName, size_t const size)
+{
+    int const fd = posix_openpt(O_RDWR | O_NOCTTY);
+    struct termios tty;
+
+    if(fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0 || ptsname_r(fd, slaveName, size) != 0) {
+        if(fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    /* Raw on both ends, the line discipline would turn the '\r' of the shell into '\n' */
+    if(tcgetattr(fd, &tty) == 0) {
+        cfmakeraw(&tty);
+        tcsetattr(fd, TCSANOW, &tty);
+    }
+
+    return fd;
+}
+
+int bridgeEmulatorSpawn(enum BridgeEmulatorMode const mode, struct BridgeEmulatorTiming const * const timing,
+                        pid_t * const pid)
+{
+    char slaveName[64];
+    int const master = bridgeEmulatorOpen(slaveName, sizeof(slaveName));
+    int const slave = master < 0 ? -1 : open(slaveName, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if(slave < 0) {
+        if(master >= 0) {
+            close(master);
+        }
+        return -1;
+    }
+
+    *pid = fork();
+    if(*pid == 0) {
+        close(slave);
+        bridgeEmulatorRun(master, mode, timing);
+        _exit(0);
+    }
+
+    close(master);
+    if(*pid < 0) {
+        close(slave);
+        return -1;
+    }
+
+    return slave;
+}
+
+void bridgeEmulatorRun(int const fd, enum BridgeEmulatorMode const mode, struct BridgeEmulatorTiming const * const timing)
+{
+    uint8_t speed = twiSpeed245Hz;
+
+    memset(&emulator_, 0, sizeof(emulator_));
+    emulator_.fd = fd;
+    emulator_.timing = *timing;
+    emulator_.start = microseconds_();
+
+    /* A fresh bridge, whose addresses were calibrated to the fastest speed the sensors keep up with */
+    simDeviceInit();
+    while(speed + 1 < twiSpeeds && speedHz_[speed + 1] <= timing->sclHz) {
+        ++speed;
+    }
+
+    for(uint8_t address = 1; address<TELEMETRY_PROBE_ADDRESS; ++address) {
+        busSpeedSet(address, speed);
+    }
+
+    traceInit();
+    if(mode == bridgeEmulatorBinary) {
+        hostLinkInit();
+    } else {
+        shellInit();
+    }
+
+    /* The main loop of the bridge, it only sleeps once the firmware has nothing left to do */
+    do {
+        emulator_.progress = false;
+        serviceBus_();
+        flush_();
+
+        if(mode == bridgeEmulatorBinary) {
+            hostLinkPoll();
+        } else {
+            shellPoll();
+        }
+    } while(receive_(emulator_.progress ? 0 : nextEvent_()));
+}
@@ -0,0 +1,44 @@
+#ifndef BRIDGE_EMULATOR_H
+#define BRIDGE_EMULATOR_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * Bridge with sensors on every address from 1 to 126, served on a pseudo terminal. It runs the firmware's own
+ * hostLink.c or shell.c with the scheduler, the pipeline and the sensor requests, built against host/sim, only the
+ * UART, the TWI and the clock underneath are emulated. Those work in real time as the hardware would: bytes cost
+ * 10 bit times on the line and go through a transmit buffer of the size of rs232.cpp, every bus transaction is accounted
+ * per bit at the speed of its job and each sensor needs processingMicroseconds for a command. The transactions go
+ * into the bus trace of uartBridge/trace.h, as on a bridge built with BRIDGE_TRACE.
+ */
+enum BridgeEmulatorMode {
+    bridgeEmulatorBinary, //Protocol of bridgeProtocol.h
+    bridgeEmulatorText    //Debug shell
+};
+
+struct BridgeEmulatorTiming {
+    unsigned baud;
+    unsigned long sclHz;     //Fastest SCL the sensors keep up with, the addresses start out calibrated to it
+    unsigned processingMicroseconds;
+};
+
+/**
+ * @brief bridgeEmulatorOpen creates a raw pseudo terminal
+ * @return Master side descriptor, -1 on error. The name of the slave side is written to slaveName.
+ */
+int bridgeEmulatorOpen(char * slaveName, size_t size);
+
+/**
+ * @brief bridgeEmulatorRun answers the requests arriving on fd until the other side hangs up. The firmware keeps
+ * its state in statics, so there is one bridge per process.
+ */
+void bridgeEmulatorRun(int fd, enum BridgeEmulatorMode mode, struct BridgeEmulatorTiming const * timing);
+
+/**
+ * @brief bridgeEmulatorSpawn serves an emulated bridge from a child process
+ * @return Raw descriptor of the terminal the bridge is on, -1 on error. Kill *pid and wait for it when done.
+ */
+int bridgeEmulatorSpawn(enum BridgeEmulatorMode mode, struct BridgeEmulatorTiming const * timing, pid_t * pid);
+
+#endif
@@ -0,0 +1,1037 @@
+/*
+ * Runs the sensor firmware on a simulated bus:
+ *   busSim [-n sensors] [-s scl Hz] [-f cpu Hz] [-i isr cycles] [-e bit error rate] [-c cycles] [-r seed] [-b segments]
+ *          [-A alerting] [-T trace] [-v] [-m module]
+ * Every sensor is a copy of the firmware module, main.c with its command dispatch, hdlc.cpp, settings.c and the USI
+ * interrupts of twiInterface.cpp, each with its own registers, RAM and EEPROM. The master is the bridge's
+ * sensorRequest.c and enumerationBus.c. The bus is clocked bit by bit, the sensors see the wired-AND of all drivers
+ * and hold SCL low for the isr cycles while their USI interrupt runs, isrTiming measures them. Conversions and
+ * EEPROM writes take their datasheet time, the rest of the firmware runs in no time.
+ * The sensors boot with an erased EEPROM, get their addresses from the enumeration and are then polled for humidity
+ * and temperature one after the other, as the scheduler of the bridge does. All times reported are simulated.
+ * -s picks the fastest speed of enum TwiSpeed not above it, as if every sensor had been calibrated to it. Each
+ * transaction is clocked at the speed of its job: sensor requests at the calibrated speed of the address, the general
+ * calls of the enumeration and the alert search at the slowest speed on their segment, 100 kHz at most and 245 Hz
+ * on a segment nothing is known of.
+ * With -b 2 the sensors are split over the hardware bus and the bit-banged one of softTwi.c, which runs at most at
+ * softSclMaxHz. Every segment keeps its own clock: the enumeration runs one segment after the other like on the
+ * bridge, a scan cycle polls both side by side and takes as long as the slower one.
+ * With -A the scan is followed by the threshold alert: every sensor gets thresholds around its reading, then the
+ * given number of them dry out and the bridge's alertBus.c finds and reads them once they pull the alert line. Timer1
+ * ticks at the period the firmware set up, the alert line is the wired-AND of PB4 of all sensors.
+ * -T records every transaction with the trace.c of the bridge and writes the records to the file, for traceReplay.
+ */
+#include <avr/io.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "simDevice.h"
+#include "protocol.h"
+#include "uartBridge/alertBus.h"
+#include "uartBridge/alertLine.h"
+#include "uartBridge/bridgeProtocol.h"
+#include "uartBridge/busSpeed.h"
+#include "uartBridge/clock.h"
+#include "uartBridge/enumerationBus.h"
+#include "uartBridge/sensorRequest.h"
+#include "uartBridge/trace.h"
+#include "uartBridge/twiMaster.h"
+#include "util/delay.h"
+
+enum {
+    maxSensors = TELEMETRY_PROBE_ADDRESS - 1,
+    stackSize = 64 * 1024,
+    eepromWriteNanoseconds = 3400000,
+    idleStepNanoseconds = 100000,   //Bus idle while a request backs off
+    bootNanoseconds = 500000000,    //Upper bound for the first settings write
+    softSclMaxHz = 25000,           //softTwi.c at SOFT_TWI_MAX_SPEED
+    alertBand = 300,                //Thresholds of -A around the reading, in 0.01%
+    alertDrying = 120,              //ADC3 LSB the alerting sensors rise by, well beyond alertBand
+    alertSettleNanoseconds = 3000000000LL, //A few timer ticks, every sensor has sampled inside its thresholds
+    alertTimeoutNanoseconds = 10000000000LL
+};
+
+static int64_t const never = INT64_MAX;
+
+/* Nominal SCL of enum TwiSpeed, the bridge's dividers come within a few percent */
+static uint32_t const speedHz_[twiSpeeds] = { 245, 245, 1000, 4000, 10000, 25000, 50000, 100000, 200000 };
+
+struct Sensor {
+    struct SimDevice * device;
+    void (*startVector)(void);
+    void (*overflowVector)(void);
+    void (*eepromVector)(void);
+    void (*timerVector)(void);
+    int (*main)(void);
+    ucontext_t context;
+    int64_t wakeAt;         //main() waits for a conversion, never if it waits for an interrupt
+    int64_t eepromReadyAt;
+    int64_t tickAt;         //Next compare match of Timer1, never while its interrupt is off
+    bool overflow;
+};
+
+/* Kept per address, the enumeration decides which sensor gets which */
+struct Latency {
+    unsigned requests;
+    unsigned failed;
+    unsigned repeated;      //Commands sent again after a broken reply
+    int64_t sum;
+    int64_t max;
+};
+
+/* A bus with its sensors, the one selected is held in the variables below */
+struct Segment {
+    struct Sensor * sensors;
+    unsigned sensorCount;
+    int64_t now;
+    int64_t nextEvent;
+    int64_t busyNanoseconds;
+    struct TwiJob * queueHead;
+    struct TwiJob * queueTail;
+};
+
+static struct Sensor allSensors_[maxSensors];
+static unsigned allSensorCount_;
+static struct Latency latencies_[maxSensors + 1];
+static struct Segment segments_[twiBuses];
+static uint8_t segmentOf_[TELEMETRY_PROBE_ADDRESS];
+static uint8_t speedOf_[TELEMETRY_PROBE_ADDRESS]; //enum TwiSpeed the address is calibrated to
+static unsigned segmentCount_ = 1;
+static unsigned selected_;
+static struct Sensor * starting_;
+static ucontext_t scheduler_;
+
+static struct Sensor * sensors_;
+static unsigned sensorCount_;
+static int64_t now_;
+static int64_t nextEvent_ = INT64_MAX;
+static int64_t bitNanoseconds_; //Of the job on the bus
+static int64_t busyNanoseconds_;
+static struct TwiJob * queueHead_;
+static struct TwiJob * queueTail_;
+
+static int64_t isrNanoseconds_;
+static double bitErrorRate_;
+static unsigned long bitErrors_;
+static unsigned long transactions_;
+static FILE * trace_;
+static unsigned long traceLost_;
+
+static void select_(unsigned const bus)
+{
+    struct Segment * segment = &segments_[selected_];
+
+    segment->sensors = sensors_;
+    segment->sensorCount = sensorCount_;
+    segment->now = now_;
+    segment->nextEvent = nextEvent_;
+    segment->busyNanoseconds = busyNanoseconds_;
+    segment->queueHead = queueHead_;
+    segment->queueTail = queueTail_;
+
+    selected_ = bus;
+    segment = &segments_[selected_];
+
+    sensors_ = segment->sensors;
+    sensorCount_ = segment->sensorCount;
+    now_ = segment->now;
+    nextEvent_ = segment->nextEvent;
+    busyNanoseconds_ = segment->busyNanoseconds;
+    queueHead_ = segment->queueHead;
+    queueTail_ = segment->queueTail;
+}
+
+/* Hooks of the modules, they switch back to the simulator */
+
+static void wait_(struct SimDevice * const device, int64_t const until)
+{
+    struct Sensor * const sensor = device->context;
+
+    sensor->wakeAt = until;
+    if(until < nextEvent_) {
+        nextEvent_ = until;
+    }
+
+    swapcontext(&sensor->context, &scheduler_);
+}
+
+static void idle_(struct SimDevice * const device)
+{
+    struct Sensor * const sensor = device->context;
+
+    sensor->wakeAt = never;
+    swapcontext(&sensor->context, &scheduler_);
+}
+
+static void entry_( void )
+{
+    starting_->main();
+}
+
+/* Lets main() run until it waits again */
+static void run_(struct Sensor * const sensor)
+{
+    swapcontext(&scheduler_, &sensor->context);
+}
+
+static bool interruptsEnabled_(struct SimDevice const * const device)
+{
+    return (device->sreg & (1<<SREG_I)) != 0;
+}
+
+/* The ready interrupt keeps firing while it is enabled and no write runs, every write it starts takes 3.4 ms */
+static void serviceEeprom_(struct Sensor * const sensor)
+{
+    struct SimDevice * const device = sensor->device;
+
+    while((device->eecr & (1<<EERIE)) && interruptsEnabled_(device) && sensor->eepromReadyAt <= now_) {
+        sensor->eepromVector();
+
+        if(device->eecr & (1<<EEPE)) {
+            uint16_t const offset = device->eear - (uint16_t)(uintptr_t)device->eeprom;
+
+            if(offset < device->eepromSize) {
+                device->eeprom[offset] = device->eedr;
+            }
+
+            device->eecr &= ~((1<<EEPE) | (1<<EEMPE));
+            sensor->eepromReadyAt = now_ + eepromWriteNanoseconds;
+        }
+    }
+}
+
+/* Timer1 in CTC mode on OCR1C with the compare A interrupt, as alert.c sets it up. A sensor waiting for an interrupt
+ * runs once the vector is done. */
+static void serviceTimer_(struct Sensor * const sensor)
+{
+    struct SimDevice * const device = sensor->device;
+    unsigned const select = device->tccr1 & 0x0f;
+
+    if(!(device->timsk & (1<<OCIE1A)) || !select) {
+        sensor->tickAt = never;
+        return;
+    }
+
+    int64_t const period = (int64_t)(device->ocr1c + 1) * (1 << (select - 1)) * 1000000000 / device->cpuHz;
+
+    if(sensor->tickAt == never) {
+        sensor->tickAt = now_ + period;
+    }
+
+    while(sensor->tickAt <= now_ && interruptsEnabled_(device)) {
+        sensor->tickAt += period;
+        sensor->timerVector();
+
+        if(sensor->wakeAt == never) {
+            run_(sensor);
+        }
+    }
+}
+
+static int64_t nextEventOf_(struct Sensor const * const sensor)
+{
+    int64_t next = sensor->wakeAt;
+
+    if((sensor->device->eecr & (1<<EERIE)) && interruptsEnabled_(sensor->device) && sensor->eepromReadyAt < next) {
+        next = sensor->eepromReadyAt;
+    }
+
+    if(interruptsEnabled_(sensor->device) && sensor->tickAt < next) {
+        next = sensor->tickAt;
+    }
+
+    return next;
+}
+
+static void serviceSensors_( void )
+{
+    nextEvent_ = never;
+
+    for(unsigned i = 0; i<sensorCount_; ++i) {
+        struct Sensor * const sensor = &sensors_[i];
+
+        if(sensor->wakeAt <= now_) {
+            run_(sensor);
+        }
+
+        serviceEeprom_(sensor);
+        serviceTimer_(sensor);
+
+        int64_t const next = nextEventOf_(sensor);
+        if(next < nextEvent_) {
+            nextEvent_ = next;
+        }
+    }
+}
+
+static void advance_(int64_t const nanoseconds)
+{
+    int64_t const until = now_ + nanoseconds;
+
+    while(nextEvent_ <= until) {
+        if(nextEvent_ > now_) {
+            now_ = nextEvent_;
+        }
+        serviceSensors_();
+    }
+
+    now_ = until;
+}
+
+static void busy_(int64_t const nanoseconds)
+{
+    advance_(nanoseconds);
+    busyNanoseconds_ += nanoseconds;
+}
+
+/* The USI of every sensor detects the START and holds SCL low until its interrupt cleared the flag */
+static void busStart_( void )
+{
+    bool detected = false;
+
+    busy_(bitNanoseconds_);
+
+    for(unsigned i = 0; i<sensorCount_; ++i) {
+        struct SimDevice * const device = sensors_[i].device;
+
+        if((device->usicr & (1<<USISIE)) && interruptsEnabled_(device)) {
+            device->pinb = 0; //SCL and SDA already low again
+            sensors_[i].startVector();
+            detected = true;
+        }
+    }
+
+    if(detected) {
+        busy_(isrNanoseconds_);
+    }
+}
+
+static void busStop_( void )
+{
+    busy_(bitNanoseconds_);
+}
+
+static bool busBit_(bool const master)
+{
+    bool line = master;
+    bool overflow = false;
+
+    for(unsigned i = 0; i<sensorCount_; ++i) {
+        struct SimDevice const * const device = sensors_[i].device;
+
+        if((device->ddrb & (1<<DDB0)) && !(device->usidr & 0x80)) {
+            line = false; //Open drain, any sensor sending a 0 wins
+        }
+    }
+
+    if(bitErrorRate_ > 0 && drand48() < bitErrorRate_) {
+        line = !line;
+        ++bitErrors_;
+    }
+
+    busy_(bitNanoseconds_);
+
+    for(unsigned i = 0; i<sensorCount_; ++i) {
+        struct Sensor * const sensor = &sensors_[i];
+        struct SimDevice * const device = sensor->device;
+
+        if(!(device->usicr & (1<<USIOIE))) {
+            continue;
+        }
+
+        uint8_t const counter = (device->usisr & 0x0f) + 2; //Counts both clock edges
+
+        device->usidr = (device->usidr << 1) | line;
+        device->usisr = (device->usisr & 0xf0) | (counter & 0x0f);
+        sensor->overflow = counter > 0x0f && interruptsEnabled_(device);
+        overflow = overflow || sensor->overflow;
+    }
+
+    if(overflow) {
+        for(unsigned i = 0; i<sensorCount_; ++i) {
+            struct Sensor * const sensor = &sensors_[i];
+
+            if(sensor->overflow) {
+                sensor->overflow = false;
+                sensor->overflowVector();
+
+                if(sensor->wakeAt == never) {
+                    run_(sensor);
+                }
+            }
+        }
+
+        busy_(isrNanoseconds_); //SCL held low, the sensors stretch in parallel
+    }
+
+    return line;
+}
+
+static bool busWrite_(uint8_t const byte)
+{
+    for(int bit = 7; bit >= 0; --bit) {
+        busBit_((byte >> bit) & 1);
+    }
+
+    return !busBit_(true);
+}
+
+static uint8_t busRead_(bool const ack)
+{
+    uint8_t byte = 0;
+
+    for(unsigned bit = 0; bit<8; ++bit) {
+        byte = (byte << 1) | busBit_(true);
+    }
+
+    busBit_(!ack);
+    return byte;
+}
+
+static uint8_t busTransfer_(struct TwiJob const * const job)
+{
+    ++transactions_;
+    bitNanoseconds_ = 1000000000 / twiMasterSpeedHz(job->bus, job->speed);
+
+    if(job->txLength || !job->rxLength) {
+        busStart_();
+
+        if(!busWrite_(job->address << 1)) {
+            busStop_();
+            return twiJobAddressNack;
+        }
+
+        for(uint8_t i = 0; i<job->txLength; ++i) {
+            if(!busWrite_(job->txBuffer[i])) {
+                busStop_();
+                return twiJobDataNack;
+            }
+        }
+    }
+
+    if(job->rxLength) {
+        busStart_();
+
+        if(!busWrite_((job->address << 1) | 1)) {
+            busStop_();
+            return twiJobAddressNack;
+        }
+
+        for(uint8_t i = 0; i<job->rxLength; ++i) {
+            job->rxBuffer[i] = busRead_(i + 1 < job->rxLength);
+        }
+    }
+
+    busStop_();
+    return twiJobOk;
+}
+
+/* Through the ring as on the bridge, it is drained after every job */
+static void traceRecord_(struct TwiJob const * const job)
+{
+    uint8_t chunk[BRIDGE_TRACE_CHUNK];
+    uint8_t lost;
+    uint8_t length;
+
+    traceJob(job, clockMillis());
+
+    while((length = traceRead(chunk, sizeof(chunk), &lost)) > 0) {
+        fwrite(chunk, 1, length, trace_);
+        traceLost_ += lost;
+    }
+}
+
+static bool runQueue_( void )
+{
+    struct TwiJob * const job = queueHead_;
+
+    if(!job) {
+        return false;
+    }
+
+    queueHead_ = job->next;
+    job->status = busTransfer_(job);
+
+    if(trace_) {
+        traceRecord_(job);
+    }
+
+    if(job->completed) {
+        job->completed(job);
+    }
+
+    serviceSensors_(); //The command may have started or stopped the timer of a sensor
+    return true;
+}
+
+/* What the bridge code needs from its drivers, every job is queued on the segment of its bus */
+
+void twiMasterSubmit(struct TwiJob * const job)
+{
+    if(job->bus != selected_) {
+        select_(job->bus);
+    }
+
+    job->status = twiJobPending;
+    job->next = NULL;
+
+    if(queueHead_) {
+        queueTail_->next = job;
+    } else {
+        queueHead_ = job;
+    }
+    queueTail_ = job;
+}
+
+uint8_t twiMasterTransfer(struct TwiJob * const job)
+{
+    twiMasterSubmit(job);
+    while(job->status == twiJobPending && runQueue_()) {}
+
+    return job->status;
+}
+
+uint32_t twiMasterSpeedHz(uint8_t const bus, uint8_t const speed)
+{
+    uint32_t const hz = speed < twiSpeeds ? speedHz_[speed] : speedHz_[twiSpeedDefault];
+
+    return bus == twiBusSoftware && hz > softSclMaxHz ? softSclMaxHz : hz;
+}
+
+uint8_t busSpeedOf(uint8_t const address)
+{
+    return address < TELEMETRY_PROBE_ADDRESS ? speedOf_[address] : twiSpeedDefault;
+}
+
+/* As busSpeed.c does it from the EEPROM */
+uint8_t busSpeedSlowest(uint8_t const bus)
+{
+    uint8_t slowest = twiSpeeds;
+
+    for(uint8_t address = 1; address<TELEMETRY_PROBE_ADDRESS; ++address) {
+        uint8_t const speed = speedOf_[address];
+
+        if(speed != twiSpeedDefault && speed < slowest && segmentOf_[address] == bus) {
+            slowest = speed;
+        }
+    }
+
+    return slowest == twiSpeeds ? twiSpeed245Hz : slowest < twiSpeed100kHz ? slowest : twiSpeed100kHz;
+}
+
+uint8_t busSegmentOf(uint8_t const address)
+{
+    return address < TELEMETRY_PROBE_ADDRESS ? segmentOf_[address] : twiBusHardware;
+}
+
+void busSegmentSet(uint8_t const address, uint8_t const bus)
+{
+    if(address < TELEMETRY_PROBE_ADDRESS) {
+        segmentOf_[address] = bus;
+    }
+}
+
+uint32_t clockMillis( void )
+{
+    return now_ / 1000000;
+}
+
+void _delay_ms(double const ms)
+{
+    advance_((int64_t)(ms * 1e6));
+}
+
+void alertLineInit( void )
+{
+}
+
+/* Shared by the sensors of all segments */
+bool alertLineAsserted( void )
+{
+    for(unsigned i = 0; i<allSensorCount_; ++i) {
+        if(allSensors_[i].device->ddrb & (1<<DDB4)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool copyFile_(char const * const from, char const * const to)
+{
+    char buffer[65536];
+    ssize_t length;
+    int const in = open(from, O_RDONLY);
+    int const out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0700);
+    bool result = in >= 0 && out >= 0;
+
+    while(result && (length = read(in, buffer, sizeof(buffer))) > 0) {
+        result = write(out, buffer, length) == length;
+    }
+
+    if(in >= 0) { close(in); }
+    if(out >= 0) { close(out); }
+
+    return result;
+}
+
+/* Every copy of the module file gets its own data segment when loaded, the file itself can go right away */
+static bool loadSensor_(struct Sensor * const sensor, char const * const module, char const * const directory,
+                        unsigned const index, unsigned long const cpuHz)
+{
+    char path[512];
+    void * handle;
+
+    snprintf(path, sizeof(path), "%s/sensor%u.so", directory, index);
+
+    if(!copyFile_(module, path)) {
+        perror(path);
+        return false;
+    }
+
+    handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    unlink(path);
+
+    if(!handle) {
+        fprintf(stderr, "%s\n", dlerror());
+        return false;
+    }
+
+    void (*init)(void) = (void (*)(void))dlsym(handle, "simDeviceInit");
+
+    sensor->device = dlsym(handle, "simDevice");
+    sensor->startVector = (void (*)(void))dlsym(handle, "USI_START_vect");
+    sensor->overflowVector = (void (*)(void))dlsym(handle, "USI_OVF_vect");
+    sensor->eepromVector = (void (*)(void))dlsym(handle, "EE_RDY_vect");
+    sensor->timerVector = (void (*)(void))dlsym(handle, "TIMER1_COMPA_vect");
+    sensor->main = (int (*)(void))dlsym(handle, "main");
+
+    if(!init || !sensor->device || !sensor->startVector || !sensor->overflowVector || !sensor->eepromVector ||
+       !sensor->timerVector || !sensor->main) {
+        fprintf(stderr, "%s: not a firmware module\n", module);
+        return false;
+    }
+
+    init();
+
+    struct SimDevice * const device = sensor->device;
+
+    device->clock = &now_;
+    device->cpuHz = cpuHz;
+    device->humidity = 200 + rand() % 600;
+    device->temperature = 280 + rand() % 40;
+    device->noise = rand() | 1;
+    device->wait = wait_;
+    device->idle = idle_;
+    device->context = sensor;
+
+    getcontext(&sensor->context);
+    sensor->context.uc_stack.ss_sp = malloc(stackSize);
+    sensor->context.uc_stack.ss_size = stackSize;
+    sensor->context.uc_link = &scheduler_;
+    makecontext(&sensor->context, entry_, 0);
+    sensor->wakeAt = never;
+    sensor->tickAt = never;
+
+    return sensor->context.uc_stack.ss_sp != NULL;
+}
+
+/* Brings every segment's clock up to until */
+static void sync_(int64_t const until)
+{
+    for(unsigned bus = 0; bus<segmentCount_; ++bus) {
+        select_(bus);
+        advance_(until - now_);
+    }
+}
+
+/* Latest clock of all segments, with sum the time they ran since start added up */
+static int64_t latest_(int64_t const start, int64_t * const sum)
+{
+    int64_t latest = 0;
+
+    *sum = 0;
+    for(unsigned bus = 0; bus<segmentCount_; ++bus) {
+        select_(bus);
+        *sum += now_ - start;
+        if(now_ > latest) {
+            latest = now_;
+        }
+    }
+
+    return latest;
+}
+
+static int64_t busyTotal_( void )
+{
+    int64_t busy = 0;
+
+    for(unsigned bus = 0; bus<segmentCount_; ++bus) {
+        select_(bus);
+        busy += busyNanoseconds_;
+    }
+
+    return busy;
+}
+
+/* Runs main() up to its first wait and lets the settings of the first boot reach the EEPROM */
+static void boot_( void )
+{
+    for(unsigned i = 0; i<sensorCount_; ++i) {
+        starting_ = &sensors_[i];
+        run_(starting_);
+    }
+
+    serviceSensors_();
+
+    for(int64_t waited = 0; nextEvent_ != never && waited < bootNanoseconds; waited += idleStepNanoseconds) {
+        advance_(idleStepNanoseconds);
+    }
+}
+
+static bool request_(uint8_t const address, struct TelemetryCommand const * command, struct TelemetryCommand * reply)
+{
+    struct Latency * const statistics = &latencies_[address];
+    struct SensorRequest request;
+
+    select_(busSegmentOf(address));
+
+    int64_t const start = now_;
+
+    sensorRequestStart(&request, address, command);
+
+    while(!sensorRequestDone(&request)) {
+        if(!runQueue_()) {
+            advance_(idleStepNanoseconds);
+        }
+    }
+
+    int64_t const latency = now_ - start;
+
+    ++statistics->requests;
+    statistics->failed += request.status != sensorRequestOk;
+    statistics->repeated += request.attempts - 1;
+    statistics->sum += latency;
+    if(latency > statistics->max) {
+        statistics->max = latency;
+    }
+
+    if(reply) {
+        *reply = request.reply;
+    }
+
+    return request.status == sensorRequestOk;
+}
+
+static double ms_(int64_t const nanoseconds)
+{
+    return nanoseconds / 1e6;
+}
+
+/* -A: the readings the thresholds were set around and what the alert search found */
+static uint16_t baseline_[TELEMETRY_PROBE_ADDRESS];
+static int64_t dryingStart_;
+static int64_t alertLatencySum_;
+static int64_t alertLatencyMax_;
+static unsigned alertsRead_;
+static unsigned alertsWrong_;  //Read but still inside the thresholds
+
+static void alerted_(uint8_t const address, struct TelemetryCommand const * const reply)
+{
+    int64_t const latency = now_ - dryingStart_;
+    int const moved = (int)reply->parameter - baseline_[address];
+
+    ++alertsRead_;
+    alertsWrong_ += moved <= alertBand && moved >= -alertBand;
+    alertLatencySum_ += latency;
+    if(latency > alertLatencyMax_) {
+        alertLatencyMax_ = latency;
+    }
+}
+
+static bool alertScenario_(unsigned const alerting, unsigned const assigned, unsigned const sensorCount)
+{
+    uint8_t tag = 0;
+
+    for(unsigned address = 1; address<=assigned; ++address) {
+        struct TelemetryCommand const humidity = { telemetryHumidity, ++tag, 0 };
+        struct TelemetryCommand reply = { 0, 0, 0 };
+
+        request_(address, &humidity, &reply);
+        baseline_[address] = reply.parameter;
+
+        struct TelemetryCommand const low = {
+            telemetryAlertLow, ++tag, reply.parameter > alertBand ? reply.parameter - alertBand : 0
+        };
+        struct TelemetryCommand const high = { telemetryAlertHigh, ++tag, reply.parameter + alertBand };
+
+        request_(address, &low, NULL);
+        request_(address, &high, NULL);
+    }
+
+    int64_t serial;
+    int64_t settled = latest_(0, &serial) + alertSettleNanoseconds;
+
+    sync_(settled);
+    if(alertLineAsserted()) {
+        printf("alert: line asserted before any sensor dried out\n");
+        return false;
+    }
+
+    /* The sensors are picked at random, the moisture drops on all of them at once */
+    for(unsigned i = 0; i<alerting; ++i) {
+        unsigned index;
+
+        do {
+            index = rand() % sensorCount;
+        } while(allSensors_[index].device->humidity >= 1023 - alertDrying);
+
+        allSensors_[index].device->humidity += alertDrying;
+    }
+
+    unsigned long const transactionsStart = transactions_;
+    unsigned runs = 0;
+    unsigned queries = 0;
+    unsigned collisions = 0;
+    unsigned failed = 0;
+
+    dryingStart_ = now_;
+
+    /* As the main loop of the bridge polls it, the segment of the job the search submitted last is selected */
+    while(alertsRead_ < alerting && now_ - dryingStart_ < alertTimeoutNanoseconds) {
+        struct AlertStatistics statistics;
+
+        if(!alertBusBusy()) {
+            select_(twiBusHardware);
+        }
+
+        if(alertBusPoll(alerted_, &statistics)) {
+            ++runs;
+            queries += statistics.queries;
+            collisions += statistics.collisions;
+            failed += statistics.failed;
+            sync_(latest_(0, &serial));
+        } else if(!alertBusBusy()) {
+            sync_(now_ + idleStepNanoseconds);
+        } else if(!runQueue_()) {
+            advance_(idleStepNanoseconds);
+        }
+    }
+
+    printf("alert: %u of %u read in %u runs, %u wrong, %u failed, %u queries, %u collisions, %lu transactions\n",
+           alertsRead_, alerting, runs, alertsWrong_, failed, queries, collisions, transactions_ - transactionsStart);
+    printf("alert latency: %.1f ms mean, %.1f ms max after the drop\n",
+           ms_(alertLatencySum_ / (alertsRead_ ? alertsRead_ : 1)), ms_(alertLatencyMax_));
+
+    return alertsRead_ == alerting && !alertsWrong_ && !alertLineAsserted();
+}
+
+int main(int argc, char ** argv)
+{
+    char const * module = SENSOR_FIRMWARE_MODULE;
+    unsigned long sclHz = 100000;
+    unsigned long cpuHz = 2000000;
+    unsigned isrCycles = 64;
+    unsigned cycles = 3;
+    unsigned seed = 1;
+    unsigned sensorCount = 64;
+    unsigned alerting = 0;
+    char const * tracePath = NULL;
+    bool verbose = false;
+    int option;
+
+    while((option = getopt(argc, argv, "n:s:f:i:e:c:r:b:A:T:vm:")) != -1) {
+        switch(option) {
+        case 'n': sensorCount = strtoul(optarg, NULL, 0); break;
+        case 's': sclHz = strtoul(optarg, NULL, 0); break;
+        case 'f': cpuHz = strtoul(optarg, NULL, 0); break;
+        case 'i': isrCycles = strtoul(optarg, NULL, 0); break;
+        case 'e': bitErrorRate_ = atof(optarg); break;
+        case 'c': cycles = strtoul(optarg, NULL, 0); break;
+        case 'r': seed = strtoul(optarg, NULL, 0); break;
+        case 'b': segmentCount_ = strtoul(optarg, NULL, 0); break;
+        case 'A': alerting = strtoul(optarg, NULL, 0); break;
+        case 'T': tracePath = optarg; break;
+        case 'v': verbose = true; break;
+        case 'm': module = optarg; break;
+        default:
+            fprintf(stderr, "usage: %s [-n sensors] [-s scl Hz] [-f cpu Hz] [-i isr cycles] [-e bit error rate] "
+                            "[-c cycles] [-r seed] [-b segments] [-A alerting] [-T trace] [-v] [-m module]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if(sensorCount < 1 || sensorCount > maxSensors || !sclHz || !cpuHz || !cycles ||
+       segmentCount_ < 1 || segmentCount_ > twiBuses || alerting > sensorCount) {
+        fprintf(stderr, "%s: 1 to %u sensors on 1 to %u segments, the rates and cycles must not be 0, at most all "
+                        "sensors alerting\n", argv[0], maxSensors, twiBuses);
+        return 1;
+    }
+
+    uint8_t speed = twiSpeed245Hz;
+
+    while(speed + 1 < twiSpeeds && speedHz_[speed + 1] <= sclHz) {
+        ++speed;
+    }
+
+    for(unsigned address = 1; address<TELEMETRY_PROBE_ADDRESS; ++address) {
+        speedOf_[address] = speed;
+    }
+
+    /* The sensors are split evenly, the software bus can't go beyond softSclMaxHz. The enumeration still visits
+     * the segments not in use, they have no sensors and their clock is never looked at. */
+    for(unsigned bus = 0; bus<twiBuses; ++bus) {
+        unsigned const first = bus < segmentCount_ ? sensorCount * bus / segmentCount_ : 0;
+
+        segments_[bus].sensors = &allSensors_[first];
+        segments_[bus].sensorCount = bus < segmentCount_ ? sensorCount * (bus + 1) / segmentCount_ - first : 0;
+        segments_[bus].nextEvent = never;
+    }
+
+    allSensorCount_ = sensorCount;
+    selected_ = 0;
+    sensors_ = segments_[0].sensors;
+    sensorCount_ = segments_[0].sensorCount;
+    isrNanoseconds_ = (int64_t)isrCycles * 1000000000 / cpuHz;
+    srand(seed);
+    srand48(seed);
+
+    if(tracePath && !(trace_ = fopen(tracePath, "wb"))) {
+        perror(tracePath);
+        return 1;
+    }
+
+    char directory[] = "/tmp/busSimXXXXXX";
+    if(!mkdtemp(directory)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    bool loaded = true;
+    for(unsigned i = 0; i<sensorCount && loaded; ++i) {
+        loaded = loadSensor_(&allSensors_[i], module, directory, i, cpuHz);
+    }
+    rmdir(directory);
+
+    if(!loaded) {
+        return 1;
+    }
+
+    struct timespec hostStart, hostEnd;
+    clock_gettime(CLOCK_MONOTONIC, &hostStart);
+
+    printf("%u sensors on %u segments, SCL %lu Hz, core %lu Hz, %u cycles per interrupt, bit error rate %g\n",
+           sensorCount, segmentCount_, (unsigned long)speedHz_[speed], cpuHz, isrCycles, bitErrorRate_);
+
+    int64_t serial;
+
+    for(unsigned bus = 0; bus<segmentCount_; ++bus) {
+        select_(bus);
+        boot_();
+    }
+    sync_(latest_(0, &serial));
+
+    struct EnumerationStatistics enumeration;
+    int64_t const enumerationStart = now_;
+
+    /* The bridge enumerates one segment after the other */
+    enumerationBusRun(1, sensorCount / segmentCount_, false, NULL, &enumeration);
+    latest_(enumerationStart, &serial);
+    sync_(enumerationStart + serial);
+
+    printf("enumeration: %u of %u assigned, %u rounds, %u slots, %u collisions, %.1f ms\n",
+           enumeration.assigned, sensorCount, enumeration.rounds, enumeration.slots, enumeration.collisions,
+           ms_(serial));
+
+    int64_t const scanStart = now_;
+    int64_t const busyStart = busyTotal_();
+    unsigned long const transactionsStart = transactions_;
+    int64_t cycleMin = never;
+    int64_t cycleMax = 0;
+    uint8_t tag = 0;
+
+    for(unsigned cycle = 0; cycle<cycles; ++cycle) {
+        int64_t const cycleStart = now_;
+
+        /* The segments poll side by side, each on its own clock */
+        for(unsigned bus = 0; bus<segmentCount_; ++bus) {
+            for(unsigned address = 1; address<=enumeration.assigned; ++address) {
+                if(busSegmentOf(address) != bus) {
+                    continue;
+                }
+
+                struct TelemetryCommand const humidity = { telemetryHumidity, ++tag, 0 };
+                struct TelemetryCommand const temperature = { telemetryTemperature, ++tag, 0 };
+
+                request_(address, &humidity, NULL);
+                request_(address, &temperature, NULL);
+            }
+        }
+
+        int64_t const cycleEnd = latest_(cycleStart, &serial);
+        int64_t const cycleTime = cycleEnd - cycleStart;
+
+        sync_(cycleEnd);
+        if(cycleTime < cycleMin) { cycleMin = cycleTime; }
+        if(cycleTime > cycleMax) { cycleMax = cycleTime; }
+    }
+
+    int64_t const scanTime = now_ - scanStart;
+
+    unsigned requests = 0;
+    unsigned failed = 0;
+    unsigned repeated = 0;
+    int64_t latencySum = 0;
+    unsigned slowest = 1;
+
+    if(verbose) {
+        printf("%8s %9s %7s %9s %12s %12s\n", "address", "requests", "failed", "repeated", "mean ms", "max ms");
+    }
+
+    for(unsigned address = 1; address<=enumeration.assigned; ++address) {
+        struct Latency const * const statistics = &latencies_[address];
+
+        requests += statistics->requests;
+        failed += statistics->failed;
+        repeated += statistics->repeated;
+        latencySum += statistics->sum;
+        if(statistics->max > latencies_[slowest].max) {
+            slowest = address;
+        }
+
+        if(verbose) {
+            printf("%8u %9u %7u %9u %12.3f %12.3f\n", address, statistics->requests, statistics->failed,
+                   statistics->repeated, ms_(statistics->sum / (statistics->requests ? statistics->requests : 1)),
+                   ms_(statistics->max));
+        }
+    }
+
+    printf("scan cycle: %.1f ms mean, %.1f ms min, %.1f ms max over %u cycles\n",
+           ms_(scanTime / cycles), ms_(cycleMin), ms_(cycleMax), cycles);
+    printf("bus: %.1f %% utilised, %lu transactions, %lu bit errors\n",
+           scanTime ? 100.0 * (busyTotal_() - busyStart) / scanTime / segmentCount_ : 0.0,
+           transactions_ - transactionsStart, bitErrors_);
+    printf("requests: %u, %u failed, %u commands repeated\n", requests, failed, repeated);
+    printf("latency: %.3f ms mean, %.3f ms max on address %u\n",
+           ms_(latencySum / (requests ? requests : 1)), ms_(latencies_[slowest].max), slowest);
+
+    bool const alerted = !alerting || alertScenario_(alerting, enumeration.assigned, sensorCount);
+
+    if(trace_) {
+        printf("trace: %ld bytes, %lu records lost\n", ftell(trace_), traceLost_);
+        fclose(trace_);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &hostEnd);
+    printf("host: %.2f s for %.2f s simulated\n",
+           (hostEnd.tv_sec - hostStart.tv_sec) + (hostEnd.tv_nsec - hostStart.tv_nsec) / 1e9, now_ / 1e9);
+
+    return enumeration.assigned != sensorCount || !alerted;
+}
@@ -0,0 +1,179 @@
+/*
+ * Checks the header only core against the C API of hdlc.h and crc16.h, which the firmware builds from it, and compares
+ * the call per byte through that API with the core inlined into the caller:
+ *   coreBench [frames]
+ * Every payload is encoded and decoded by both, the frames have to match byte for byte.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+#include "crc16.h"
+#include "hdlc.h"
+}
+
+#include "core/crc.hpp"
+#include "core/hdlcCodec.hpp"
+#include "core/protocol.hpp"
+#include "core/ringBuffer.hpp"
+
+namespace {
+
+enum {
+    maxPayload = 32,
+    maxFrame = 2 * (maxPayload + 2) + 2
+};
+
+/* Sink and source of HdlcCodec, a RingBuffer like the ones between the interrupts and the main loop */
+core::RingBuffer<128> line;
+
+struct LineIo {
+    static bool put(uint8_t const data) { return line.push(data); }
+    static bool available() { return !line.empty(); }
+    static uint8_t get() { uint8_t data = 0; line.pop(data); return data; }
+    static void idle() {}
+};
+
+typedef core::HdlcCodec<LineIo> Codec;
+
+double seconds_()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+uint32_t random_ = 0x12345678;
+
+uint8_t nextRandom_()
+{
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+
+    return random_;
+}
+
+/* Payloads with a good share of bytes that have to be escaped */
+void fill_(uint8_t * const payload, size_t const size)
+{
+    for(size_t i = 0; i<size; ++i) {
+        uint8_t const data = nextRandom_();
+        payload[i] = (data & 0x07) == 0 ? 0x7e + (data >> 7) : data;
+    }
+}
+
+int check_(unsigned const frames)
+{
+    unsigned failures = 0;
+
+    for(unsigned i = 0; i<frames; ++i) {
+        uint8_t payload[maxPayload];
+        uint8_t frameC[maxFrame];
+        uint8_t frameCore[maxFrame];
+        size_t const size = 1 + i % maxPayload;
+
+        fill_(payload, size);
+
+        size_t const lengthC = hdlcEncodeBuffer(payload, size, frameC, sizeof(frameC));
+        size_t const lengthCore = Codec::encode(payload, size, frameCore, sizeof(frameCore));
+
+        if(computeCrc(payload, size) != core::FrameCrc::compute(payload, size) ||
+           lengthC != lengthCore || memcmp(frameC, frameCore, lengthC)) {
+            ++failures;
+            continue;
+        }
+
+        /* The streamed frame has to be the same as well, and decode to the payload */
+        uint8_t decoded[maxPayload];
+
+        if(!Codec::send(payload, size) || line.size() != lengthC || !Codec::receive(decoded, size) ||
+           memcmp(decoded, payload, size)) {
+            ++failures;
+        }
+
+        line.clear();
+    }
+
+    printf("%u frames checked, %u differ\n", frames, failures);
+    return failures ? 1 : 0;
+}
+
+template<class Encode>
+double encodeNs_(Encode const encode, uint8_t const * const payload, unsigned const frames)
+{
+    uint8_t frame[maxFrame];
+    size_t bytes = 0;
+    double const start = seconds_();
+
+    for(unsigned i = 0; i<frames; ++i) {
+        bytes += encode(payload, maxPayload, frame, sizeof(frame));
+    }
+
+    return (seconds_() - start) * 1e9 / bytes;
+}
+
+template<class Decode>
+double decodeNs_(Decode const decode, uint8_t const * const frame, size_t const length, unsigned const frames)
+{
+    unsigned ok = 0;
+    double const start = seconds_();
+
+    for(unsigned i = 0; i<frames; ++i) {
+        ok += decode(frame, length);
+    }
+
+    double const ns = (seconds_() - start) * 1e9 / ((double)length * frames);
+    return ok == frames ? ns : -1;
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned const frames = argc > 1 ? strtoul(argv[1], 0, 0) : 200000;
+
+    if(check_(10000)) {
+        return 1;
+    }
+
+    uint8_t payload[maxPayload];
+    uint8_t frame[maxFrame];
+
+    fill_(payload, sizeof(payload));
+    size_t const length = hdlcEncodeBuffer(payload, sizeof(payload), frame, sizeof(frame));
+
+    double const encodeC = encodeNs_(hdlcEncodeBuffer, payload, frames);
+    double const encodeCore = encodeNs_(Codec::encode, payload, frames);
+
+    double const decodeC = decodeNs_([](uint8_t const * const frame, size_t const length) {
+        uint8_t buffer[maxPayload];
+        struct HdlcDecoder decoder;
+        bool ok = false;
+
+        hdlcDecoderInit(&decoder, buffer, sizeof(buffer));
+        for(size_t i = 0; i<length; ++i) {
+            ok = hdlcDecodeChar(&decoder, frame[i]) == hdlcFrameOk;
+        }
+        return ok;
+    }, frame, length, frames);
+
+    double const decodeCore = decodeNs_([](uint8_t const * const frame, size_t const length) {
+        uint8_t buffer[maxPayload];
+        core::HdlcDecoder<> decoder(buffer, sizeof(buffer));
+        bool ok = false;
+
+        for(size_t i = 0; i<length; ++i) {
+            ok = decoder.decode(frame[i]) == hdlcFrameOk;
+        }
+        return ok;
+    }, frame, length, frames);
+
+    printf("encode  C %6.2f ns/byte  core %6.2f ns/byte\n", encodeC, encodeCore);
+    printf("decode  C %6.2f ns/byte  core %6.2f ns/byte\n", decodeC, decodeCore);
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * Simulates the address enumeration of a bus full of unconfigured sensors. The nodes run the firmware's
+ * enumeration.c, the master runs the bridge's enumerationMaster.c and the replies are wired-AND'ed and decoded
+ * with hdlc.cpp, so collisions are detected the same way as on the real bus. Bus time is accounted per bit.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "enumeration.h"
+#include "hdlc.h"
+#include "twiInterface.h"
+#include "uartBridge/enumerationMaster.h"
+
+enum {
+    maxNodes = 126,
+    maxFrame = 32,
+    settleMicroseconds = 2000 //Delay of the bridge between the slot broadcast and the probe
+};
+
+struct Node {
+    struct Enumeration enumeration;
+    bool configured;
+    bool probe;
+    uint8_t address;
+    uint8_t reply[maxFrame];
+    size_t replyLength;
+};
+
+static struct Node nodes_[maxNodes];
+static unsigned nodeCount_;
+static double sclHz_ = 100000.0;
+static double busSeconds_;
+
+/* hdlc.cpp writes its frames through the TWI interface, capture them here */
+static uint8_t frame_[maxFrame];
+static size_t frameLength_;
+
+bool twiSendChar(char c)
+{
+    if(frameLength_ < sizeof(frame_)) {
+        frame_[frameLength_++] = c;
+    }
+    return true;
+}
+
+bool twiCharAvailable( void )
+{
+    return false;
+}
+
+char twiReceiveChar( void )
+{
+    return 0;
+}
+
+void twiSleep( void )
+{
+}
+
+static void encode(struct TelemetryCommand const * command)
+{
+    frameLength_ = 0;
+    hdlcSendBuffer(command, sizeof(*command));
+}
+
+/* START + address + data bytes, 9 clocks each, + STOP */
+static void accountTransaction(size_t const bytes)
+{
+    busSeconds_ += (2.0 + 9.0 * (1 + bytes)) / sclHz_;
+}
+
+static bool simBroadcast(struct TelemetryCommand const * command)
+{
+    encode(command);
+    accountTransaction(frameLength_);
+
+    for(unsigned i = 0; i<nodeCount_; ++i)
+    {
+        struct Node * const node = &nodes_[i];
+        struct TelemetryCommand copy = *command;
+
+        switch(enumerationHandleCommand(&node->enumeration, &copy, node->configured)) {
+        case enumerationDisarm:
+            node->probe = false;
+            node->replyLength = 0;
+            break;
+
+        case enumerationArm:
+            encode(&copy);
+            memcpy(node->reply, frame_, frameLength_);
+            node->replyLength = frameLength_;
+            node->probe = true;
+            break;
+
+        case enumerationAssigned:
+            node->probe = false;
+            node->address = copy.cmdTag;
+            node->configured = true;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return true;
+}
+
+static enum EnumerationProbe simProbe(struct TelemetryCommand * reply)
+{
+    uint8_t wire[TELEMETRY_MAX_REPLY_FRAME];
+    unsigned answering = 0;
+
+    busSeconds_ += settleMicroseconds / 1e6;
+    memset(wire, 0xff, sizeof(wire)); //Released bus reads as 1
+
+    for(unsigned i = 0; i<nodeCount_; ++i)
+    {
+        struct Node const * const node = &nodes_[i];
+
+        if(node->probe) {
+            ++answering;
+            for(size_t b = 0; b<sizeof(wire); ++b) {
+                wire[b] &= b < node->replyLength ? node->reply[b] : 0; //An empty USI shifts out zeros
+            }
+        }
+    }
+
+    if(!answering) {
+        accountTransaction(0); //Address NACK'ed
+        return enumerationEmpty;
+    }
+
+    accountTransaction(sizeof(wire));
+
+    struct HdlcDecoder decoder;
+    enum HdlcResult result = hdlcPending;
+
+    hdlcDecoderInit(&decoder, reply, sizeof(*reply));
+    for(size_t b = 0; b<sizeof(wire) && result == hdlcPending; ++b) {
+        result = hdlcDecodeChar(&decoder, wire[b]);
+    }
+
+    return result == hdlcFrameOk && decoder.length == sizeof(*reply) ? enumerationFound : enumerationCollision;
+}
+
+static unsigned duplicates( void )
+{
+    unsigned result = 0;
+
+    for(unsigned i = 0; i<nodeCount_; ++i) {
+        if(!nodes_[i].configured) {
+            ++result; //Not found at all
+            continue;
+        }
+        for(unsigned j = i + 1; j<nodeCount_; ++j) {
+            if(nodes_[j].configured && nodes_[i].address == nodes_[j].address) {
+                ++result;
+            }
+        }
+    }
+
+    return result;
+}
+
+int main(int argc, char ** argv)
+{
+    static unsigned const counts[] = { 1, 2, 4, 8, 16, 32, 64, 100, 126 };
+    unsigned trials = 20;
+    unsigned initialSlots = 16;
+
+    if(argc > 1) { sclHz_ = atof(argv[1]); }
+    if(argc > 2) { trials = atoi(argv[2]); }
+    if(argc > 3) { initialSlots = atoi(argv[3]); }
+
+    if(sclHz_ <= 0 || trials == 0) {
+        fprintf(stderr, "usage: %s [scl Hz] [trials] [initial slots]\n", argv[0]);
+        return 1;
+    }
+
+    printf("SCL %.0f Hz, %u trials, %u slots in the first round\n", sclHz_, trials, initialSlots);
+    printf("%6s %8s %8s %10s %8s %10s %10s\n", "nodes", "rounds", "slots", "collisions", "failed", "bus ms", "ms/node");
+
+    srand(1);
+
+    for(size_t c = 0; c<sizeof(counts)/sizeof(counts[0]); ++c)
+    {
+        unsigned rounds = 0, slots = 0, collisions = 0, failed = 0;
+        double seconds = 0;
+
+        nodeCount_ = counts[c];
+
+        for(unsigned t = 0; t<trials; ++t)
+        {
+            struct EnumerationBus const bus = { simBroadcast, simProbe, NULL };
+            struct EnumerationStatistics statistics;
+
+            for(unsigned i = 0; i<nodeCount_; ++i) {
+                memset(&nodes_[i], 0, sizeof(nodes_[i]));
+                enumerationInit(&nodes_[i].enumeration, ((rand() << 8) ^ rand()) & 0xffffff);
+                nodes_[i].address = 1;
+            }
+
+            busSeconds_ = 0;
+            enumerationRun(&bus, 1, initialSlots, false, &statistics);
+
+            rounds += statistics.rounds;
+            slots += statistics.slots;
+            collisions += statistics.collisions;
+            failed += duplicates();
+            seconds += busSeconds_;
+        }
+
+        printf("%6u %8.1f %8.1f %10.1f %8u %10.1f %10.2f\n", nodeCount_,
+               (double)rounds / trials, (double)slots / trials, (double)collisions / trials, failed,
+               1e3 * seconds / trials, 1e3 * seconds / trials / nodeCount_);
+    }
+
+    return 0;
+}
@@ -0,0 +1,362 @@
+/*
+ * Cycle counts of the USI interrupts of the sensor, taken under simavr:
+ *   isrTiming [-f cpu Hz] [-s scl Hz] [-b budget cycles] isrHarness.elf
+ * The harness of timing/ is the sensor's twiInterface.cpp with a trivial main loop. simavr does not model the USI, so
+ * this program stands in for it and the bus master: it loads the received byte into USIDR, sets the SCL and SDA levels
+ * and raises USI_START_vect and USI_OVF_vect through every state of a read, a write, a foreign address, the general
+ * call and the probe address, with the reply queued and without.
+ * An interrupt is timed from being raised until its reti, so the response time is included. That is how long the
+ * USI holds SCL low, only for USI_START_vect the time it spins while the master still holds SCL high is not counted.
+ * The budget is the low half of a bit at the SCL rate, within it the sensor never stretches the clock. Exits with 1
+ * if an interrupt exceeds the budget, so the build can fail on it.
+ */
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_interrupts.h>
+#include <simavr/sim_cycle_timers.h>
+
+/* ATtiny45 data space addresses and bits, the I/O registers start at 0x20 */
+enum {
+    regUsicr  = 0x2d,
+    regUsisr  = 0x2e,
+    regUsidr  = 0x2f,
+    regGpior0 = 0x31,
+    regPinb   = 0x36,
+    regPortb  = 0x38,
+
+    bitUsioie = 6,
+    bitUsisie = 7,
+    bitUsioif = 6,
+    bitUsisif = 7,
+    pinSda    = 1 << 0,
+    pinScl    = 1 << 2,
+
+    vectorUsiStart = 13,
+    vectorUsiOverflow = 14
+};
+
+enum {
+    harnessAddress = 0x10, //See timing/isrHarness.c
+    otherAddress = 0x22,
+    probeAddress = 0x7f,
+    receiveBufferBytes = 15,
+    maxSteps = 100000,     //Instructions an interrupt may take before it counts as hung
+    bootSteps = 2000,
+    maxTimings = 128
+};
+
+struct Harness {
+    avr_t * avr;
+    avr_int_vector_t start;
+    avr_int_vector_t overflow;
+    unsigned long holdCycles; //The master keeps SCL high this long after the START
+};
+
+struct Timing {
+    char const * vector;
+    char const * path;
+    unsigned long cycles;
+    unsigned long stretch;    //Cycles SCL is held low by the sensor
+};
+
+static struct Timing timings_[maxTimings];
+static unsigned timingCount_;
+
+static void record_(char const * const vector, char const * const path, unsigned long const cycles,
+                    unsigned long const stretch)
+{
+    if(timingCount_ < maxTimings) {
+        struct Timing * const timing = &timings_[timingCount_++];
+
+        timing->vector = vector;
+        timing->path = path;
+        timing->cycles = cycles;
+        timing->stretch = stretch;
+    }
+}
+
+/* SCL is an output of the sensor in two-wire mode, simavr reads it back from PORTB, SDA is an input */
+static void lines_(struct Harness * const harness, bool const scl, bool const sda)
+{
+    uint8_t * const data = harness->avr->data;
+
+    data[regPortb] = (data[regPortb] & ~pinScl) | (scl ? pinScl : 0);
+    data[regPinb] = (data[regPinb] & ~(pinScl | pinSda)) | (scl ? pinScl : 0) | (sda ? pinSda : 0);
+}
+
+static avr_cycle_count_t releaseScl_(avr_t * const avr, avr_cycle_count_t const when, void * const param)
+{
+    lines_(param, false, false);
+    return 0;
+}
+
+/* Runs from raising the interrupt until its reti, 0 if the sensor has it disabled in this state */
+static unsigned long interrupt_(struct Harness * const harness, avr_int_vector_t * const vector)
+{
+    avr_t * const avr = harness->avr;
+    avr_cycle_count_t const raised = avr->cycle;
+    bool entered = false;
+
+    if(!(avr->data[vector->enable.reg] & (1 << vector->enable.bit))) {
+        return 0;
+    }
+
+    avr_raise_interrupt(avr, vector);
+
+    for(unsigned step = 0; step<maxSteps; ++step) {
+        int const state = avr_run(avr);
+
+        if(state == cpu_Done || state == cpu_Crashed) {
+            break;
+        }
+
+        if(!avr->sreg[S_I]) {
+            entered = true;
+        } else if(entered) {
+            return avr->cycle - raised;
+        }
+    }
+
+    fprintf(stderr, "vector %u did not return\n", vector->vector);
+    exit(2);
+}
+
+static void start_(struct Harness * const harness, char const * const path, bool const sclHeld, bool const sdaHigh)
+{
+    bool const spins = sclHeld && !sdaHigh;
+
+    lines_(harness, sclHeld, sdaHigh);
+    if(spins) {
+        avr_cycle_timer_register(harness->avr, harness->holdCycles, releaseScl_, harness);
+    }
+
+    unsigned long const cycles = interrupt_(harness, &harness->start);
+
+    if(spins) {
+        avr_cycle_timer_cancel(harness->avr, releaseScl_, harness);
+    }
+    lines_(harness, false, false);
+
+    if(cycles) {
+        unsigned long const stretch = spins && cycles > harness->holdCycles ? cycles - harness->holdCycles : cycles;
+
+        record_("USI_START_vect", path, cycles, stretch);
+    }
+}
+
+static void overflow_(struct Harness * const harness, char const * const path, uint8_t const received)
+{
+    harness->avr->data[regUsidr] = received;
+
+    unsigned long const cycles = interrupt_(harness, &harness->overflow);
+
+    if(cycles) {
+        record_("USI_OVF_vect", path, cycles, cycles);
+    }
+}
+
+/* Boots the harness until its main loop runs with interrupts enabled */
+static bool boot_(struct Harness * const harness, elf_firmware_t * const firmware, unsigned long const cpuHz,
+                  uint8_t const fill)
+{
+    avr_t * const avr = avr_make_mcu_by_name("attiny45");
+
+    if(!avr) {
+        fprintf(stderr, "simavr has no attiny45 core\n");
+        return false;
+    }
+
+    avr_init(avr);
+    avr_load_firmware(avr, firmware);
+    avr->frequency = cpuHz;
+    avr->data[regGpior0] = fill;
+
+    harness->avr = avr;
+    memset(&harness->start, 0, sizeof(harness->start));
+    memset(&harness->overflow, 0, sizeof(harness->overflow));
+    harness->start.vector = vectorUsiStart;
+    harness->start.enable = (avr_regbit_t)AVR_IO_REGBIT(regUsicr, bitUsisie);
+    harness->start.raised = (avr_regbit_t)AVR_IO_REGBIT(regUsisr, bitUsisif);
+    harness->overflow.vector = vectorUsiOverflow;
+    harness->overflow.enable = (avr_regbit_t)AVR_IO_REGBIT(regUsicr, bitUsioie);
+    harness->overflow.raised = (avr_regbit_t)AVR_IO_REGBIT(regUsisr, bitUsioif);
+    avr_register_vector(avr, &harness->start);
+    avr_register_vector(avr, &harness->overflow);
+
+    lines_(harness, true, true);
+
+    unsigned step = 0;
+
+    while(!avr->sreg[S_I] && step++ < maxSteps) {
+        avr_run(avr);
+    }
+
+    if(!avr->sreg[S_I]) {
+        fprintf(stderr, "the harness did not enable the interrupts\n");
+        return false;
+    }
+
+    for(step = 0; step<bootSteps; ++step) { //Lets the main loop queue the reply
+        avr_run(avr);
+    }
+
+    return true;
+}
+
+/* Every path through the interrupts with a reply queued */
+static void runQueued_(struct Harness * const harness)
+{
+    start_(harness, "START, SCL already low", false, false);
+    overflow_(harness, "own address, read", (harnessAddress << 1) | 1);
+    overflow_(harness, "address ACK sent, reply queued", 0);
+
+    for(unsigned i = 0; i<4; ++i) {
+        overflow_(harness, "byte sent", 0xff);
+        overflow_(harness, "ACK from master, reply queued", 0x00);
+    }
+
+    overflow_(harness, "byte sent", 0xff);
+    overflow_(harness, "NACK from master", 0x01);
+
+    start_(harness, "START, SCL held by master", true, false);
+    overflow_(harness, "own address, write", harnessAddress << 1);
+    overflow_(harness, "address ACK sent", 0);
+
+    for(unsigned i = 0; i<receiveBufferBytes + 2; ++i) {
+        overflow_(harness, i < receiveBufferBytes ? "byte received" : "byte received, buffer full", 0x5a);
+        overflow_(harness, "ACK sent", 0);
+    }
+
+    start_(harness, "START, SDA high again", true, true);
+    start_(harness, "START, SCL already low", false, false);
+    overflow_(harness, "other address", otherAddress << 1);
+
+    start_(harness, "START, SCL already low", false, false);
+    overflow_(harness, "general call", 0);
+    overflow_(harness, "address ACK sent", 0);
+
+    start_(harness, "START, SCL already low", false, false);
+    overflow_(harness, "probe address, read", (probeAddress << 1) | 1);
+    overflow_(harness, "address ACK sent, reply queued", 0);
+    overflow_(harness, "byte sent", 0xff);
+    overflow_(harness, "NACK from master", 0x01);
+}
+
+/* The read paths of a sensor that has not queued its reply yet */
+static void runEmpty_(struct Harness * const harness)
+{
+    start_(harness, "START, SCL already low", false, false);
+    overflow_(harness, "own address, read", (harnessAddress << 1) | 1);
+    overflow_(harness, "address ACK sent, nothing queued", 0);
+    overflow_(harness, "byte sent", 0xff);
+    overflow_(harness, "ACK from master, nothing queued", 0x00);
+    overflow_(harness, "byte sent", 0xff);
+    overflow_(harness, "NACK from master", 0x01);
+}
+
+static int compareCycles_(void const * const a, void const * const b)
+{
+    unsigned long const x = *(unsigned long const *)a;
+    unsigned long const y = *(unsigned long const *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Prints worst and typical stretch of the vector, returns the worst */
+static unsigned long summary_(char const * const vector, unsigned long const cpuHz)
+{
+    unsigned long stretches[maxTimings];
+    unsigned count = 0;
+
+    for(unsigned i = 0; i<timingCount_; ++i) {
+        if(!strcmp(timings_[i].vector, vector)) {
+            stretches[count++] = timings_[i].stretch;
+        }
+    }
+
+    if(!count) {
+        return 0;
+    }
+
+    qsort(stretches, count, sizeof(stretches[0]), compareCycles_);
+
+    unsigned long const worst = stretches[count - 1];
+    unsigned long const typical = stretches[count / 2];
+
+    printf("%-15s worst %3lu cycles (%.1f us), typical %3lu, keeps up with SCL up to %.1f kHz (%.1f kHz typical)\n",
+           vector, worst, worst * 1e6 / cpuHz, typical, cpuHz / (2.0 * worst) / 1000, cpuHz / (2.0 * typical) / 1000);
+
+    return worst;
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned long cpuHz = 2000000;
+    unsigned long sclHz = 10000;
+    unsigned long budget = 0;
+    int option;
+
+    while((option = getopt(argc, argv, "f:s:b:")) != -1) {
+        switch(option) {
+        case 'f': cpuHz = strtoul(optarg, NULL, 0); break;
+        case 's': sclHz = strtoul(optarg, NULL, 0); break;
+        case 'b': budget = strtoul(optarg, NULL, 0); break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+
+    if(optind != argc - 1 || !cpuHz || !sclHz) {
+        fprintf(stderr, "usage: %s [-f cpu Hz] [-s scl Hz] [-b budget cycles] isrHarness.elf\n", argv[0]);
+        return 2;
+    }
+
+    if(!budget) {
+        budget = cpuHz / (2 * sclHz);
+    }
+
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof(firmware));
+
+    if(elf_read_firmware(argv[optind], &firmware)) {
+        fprintf(stderr, "%s: can't read the firmware\n", argv[optind]);
+        return 2;
+    }
+
+    struct Harness harness;
+    harness.holdCycles = cpuHz / (2 * sclHz); //The TWI of the bridge holds the START for about half a bit
+
+    if(!boot_(&harness, &firmware, cpuHz, 0x55)) {
+        return 2;
+    }
+    runQueued_(&harness);
+    avr_terminate(harness.avr);
+
+    if(!boot_(&harness, &firmware, cpuHz, 0)) {
+        return 2;
+    }
+    runEmpty_(&harness);
+    avr_terminate(harness.avr);
+
+    printf("%-15s %-34s %7s %8s\n", "vector", "path", "cycles", "stretch");
+    for(unsigned i = 0; i<timingCount_; ++i) {
+        printf("%-15s %-34s %7lu %8lu\n", timings_[i].vector, timings_[i].path, timings_[i].cycles, timings_[i].stretch);
+    }
+
+    unsigned long const start = summary_("USI_START_vect", cpuHz);
+    unsigned long const overflow = summary_("USI_OVF_vect", cpuHz);
+    bool const exceeded = start > budget || overflow > budget;
+
+    printf("budget %lu cycles, the low half of a bit at %lu Hz with a %lu Hz core: %s\n", budget, sclHz, cpuHz,
+           exceeded ? "EXCEEDED" : "ok");
+
+    return exceeded;
+}
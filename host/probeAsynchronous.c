@@ -0,0 +1,2 @@
+// probe.c with the conversions started in software, see adcNoise.c
+#include "probe.c"
@@ -0,0 +1,269 @@
+/*
+ * Lets the bridge poll the sensors on its own and appends the streamed samples to a series store:
+ *   sensorDaemon [-d device | -e] [-b baud] [-a first-last] [-i interval] [-D deadband] [-H heartbeat] [-r rollup s]
+ *                [-t seconds] [-T trace] <store>
+ * -e serves an emulated bridge on a pseudo terminal instead of a real one. The interval is in 100 ms, every sensor
+ * of the address range is polled for humidity and temperature. With -D the bridge reports by exception: readings
+ * within the deadband of the last one are held back, except for every heartbeat-th one (default 10). The bridge
+ * has room for REPORT_FILTERS filters, the readings of the sensors beyond them all arrive. With -T the bus trace of a
+ * bridge built with BRIDGE_TRACE is read once a second and appended to the file, host/traceReplay replays it. Stops
+ * on SIGINT or SIGTERM, or after -t seconds.
+ */
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bridgeClient.h"
+#include "bridgeEmulator.h"
+#include "seriesStore.h"
+
+struct Daemon {
+    struct SeriesStore * store;
+    int64_t offset;         //Host time of bridge time 0
+    uint32_t lastTimestamp;
+    int anchored;
+    unsigned long samples;
+    unsigned long lost;
+    uint8_t sequence;
+};
+
+static volatile sig_atomic_t stop_;
+
+static void onSignal_(int signal)
+{
+    stop_ = 1;
+}
+
+static int64_t epochMillis_( void )
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/* The bridge counts milliseconds since its reset in 32 bit, follow the wrap and anchor again after a reset */
+static int64_t hostTime_(struct Daemon * const daemon, uint32_t const timestamp)
+{
+    int64_t const now = epochMillis_();
+
+    if(daemon->anchored && timestamp < daemon->lastTimestamp && daemon->lastTimestamp - timestamp > 0x80000000u) {
+        daemon->offset += 0x100000000LL;
+    }
+
+    int64_t const time = daemon->offset + timestamp;
+
+    if(!daemon->anchored || time > now + 5000 || time < now - 5000) {
+        daemon->offset = now - timestamp;
+        daemon->anchored = 1;
+    }
+
+    daemon->lastTimestamp = timestamp;
+    return daemon->offset + timestamp;
+}
+
+static void ingest_(struct Daemon * const daemon, struct BridgeSample const * const sample)
+{
+    struct SeriesSample const record = {
+        hostTime_(daemon, sample->timestamp), sample->address, sample->reply.cmdId, sample->status,
+        (int16_t)sample->reply.parameter
+    };
+
+    if(daemon->samples) {
+        daemon->lost += (uint8_t)(sample->header.sequence - daemon->sequence - 1);
+    }
+    daemon->sequence = sample->header.sequence;
+    ++daemon->samples;
+
+    if(seriesAppend(daemon->store, &record) != 0) {
+        perror("store");
+        stop_ = 1;
+    }
+}
+
+/* Drains the trace ring of the bridge, the samples arriving meanwhile are stored by the callback */
+static int readTrace_(struct BridgeClient * const client, FILE * const file, unsigned long * const bytes,
+                      unsigned long * const lost)
+{
+    struct BridgeTraceData data;
+    int status;
+
+    do {
+        status = bridgeTrace(client, &data);
+
+        if(status == 0) {
+            *lost += data.lost;
+            *bytes += data.length;
+
+            if(fwrite(data.data, 1, data.length, file) != data.length) {
+                return -1;
+            }
+        }
+    } while(status == 0 && data.length > 0);
+
+    return status;
+}
+
+static struct Daemon * daemon_; //For the sample callback
+
+static void sampleReceived_(struct BridgeClient * const client, struct BridgeSample const * const sample)
+{
+    ingest_(daemon_, sample);
+}
+
+static int configure_(struct BridgeClient * const client, unsigned const first, unsigned const last,
+                      uint16_t const interval, int const deadband, uint8_t const heartbeat)
+{
+    if(bridgeHello(client) != BRIDGE_PROTOCOL_VERSION) {
+        fprintf(stderr, "No binary protocol bridge\n");
+        return -1;
+    }
+
+    for(unsigned address = first; address <= last; ++address) {
+        if(bridgeSchedule(client, address, (1<<telemetryHumidity) | (1<<telemetryTemperature), interval) != 0) {
+            fprintf(stderr, "Bridge refused the schedule of %02x\n", address);
+            return -1;
+        }
+
+        /* Filters of an earlier run are still there after a restart of the daemon, 1 removes them */
+        uint8_t const beat = deadband < 0 ? 1 : heartbeat;
+
+        for(uint8_t command = telemetryHumidity; command <= telemetryTemperature; ++command) {
+            int const status = bridgeReport(client, address, command, deadband < 0 ? 0 : deadband, beat);
+
+            if(status == bridgeStatusFull) {
+                fprintf(stderr, "No report filter left for %02x, all its readings are sent\n", address);
+            } else if(status != 0) {
+                fprintf(stderr, "Bridge refused the report filter of %02x\n", address);
+                return -1;
+            }
+        }
+    }
+
+    return bridgeRun(client, 1);
+}
+
+int main(int argc, char **argv)
+{
+    struct BridgeEmulatorTiming timing = { BRIDGE_DEFAULT_BAUD, 100000, 200 };
+    char const * device = NULL;
+    unsigned first = 1, last = 8;
+    unsigned interval = 10;
+    unsigned rollupSeconds = 60;
+    unsigned seconds = 0;
+    int deadband = -1;
+    unsigned heartbeat = 10;
+    int emulate = 0;
+    char const * tracePath = NULL;
+    int option;
+
+    while((option = getopt(argc, argv, "d:eb:a:i:D:H:r:t:T:")) != -1) {
+        switch(option) {
+        case 'd': device = optarg; break;
+        case 'e': emulate = 1; break;
+        case 'b': timing.baud = atoi(optarg); break;
+        case 'a': if(sscanf(optarg, "%u-%u", &first, &last) == 1) last = first; break;
+        case 'i': interval = atoi(optarg); break;
+        case 'D': deadband = atoi(optarg); break;
+        case 'H': heartbeat = atoi(optarg); break;
+        case 'r': rollupSeconds = atoi(optarg); break;
+        case 't': seconds = atoi(optarg); break;
+        case 'T': tracePath = optarg; break;
+        default:  return 2;
+        }
+    }
+
+    if(optind + 1 != argc || (!device && !emulate) || first == 0 || last >= TELEMETRY_PROBE_ADDRESS || first > last ||
+       deadband > 0xffff || heartbeat > 255) {
+        fprintf(stderr, "usage: %s [-d device | -e] [-b baud] [-a first-last] [-i interval] [-D deadband] "
+                        "[-H heartbeat] [-r rollup s] [-t seconds] [-T trace] <store>\n", argv[0]);
+        return 2;
+    }
+
+    struct Daemon daemon = { seriesOpen(argv[optind], rollupSeconds * 1000LL) };
+    struct BridgeClient client;
+    pid_t emulator = 0;
+    FILE * trace = NULL;
+    unsigned long traceBytes = 0;
+    unsigned long traceLost = 0;
+
+    if(!daemon.store) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    if(tracePath && !(trace = fopen(tracePath, "ab"))) {
+        perror(tracePath);
+        return 1;
+    }
+
+    if(emulate) {
+        int const fd = bridgeEmulatorSpawn(bridgeEmulatorBinary, &timing, &emulator);
+
+        if(fd < 0) {
+            perror("pty");
+            return 1;
+        }
+        bridgeAttach(&client, fd);
+    } else if(bridgeOpen(&client, device, timing.baud) != 0) {
+        perror(device);
+        return 1;
+    }
+
+    daemon_ = &daemon;
+    client.sampleReceived = sampleReceived_;
+    signal(SIGINT, onSignal_);
+    signal(SIGTERM, onSignal_);
+
+    int result = configure_(&client, first, last, interval, deadband, heartbeat) == 0 ? 0 : 1;
+    time_t const start = time(NULL);
+    time_t synced = start;
+
+    while(!result && !stop_ && (!seconds || time(NULL) - start < (time_t)seconds)) {
+        struct BridgeSample sample;
+
+        if(bridgeReceiveSample(&client, &sample, 200) == 0) {
+            ingest_(&daemon, &sample);
+        }
+
+        if(time(NULL) != synced) {
+            synced = time(NULL);
+            seriesSync(daemon.store);
+
+            if(trace && readTrace_(&client, trace, &traceBytes, &traceLost) != 0) {
+                fprintf(stderr, "Bridge keeps no bus trace\n");
+                result = 1;
+            }
+        }
+    }
+
+    struct BridgeReportSummary summary;
+
+    bridgeRun(&client, 0);
+    fprintf(stderr, "%lu samples, %lu lost, %zu in the store, %zu roll-ups\n", daemon.samples, daemon.lost,
+            seriesCount(daemon.store), seriesRollupCount(daemon.store));
+
+    if(bridgeReportSummary(&client, &summary) == 0) {
+        fprintf(stderr, "bridge: %u samples sent, %u readings held back, %u heartbeats\n", summary.forwarded,
+                summary.held, summary.heartbeats);
+    }
+
+    if(trace) {
+        fprintf(stderr, "trace: %lu bytes, %lu records lost\n", traceBytes, traceLost);
+        fclose(trace);
+    }
+
+    seriesClose(daemon.store);
+    bridgeClose(&client);
+
+    if(emulator > 0) {
+        kill(emulator, SIGTERM);
+        waitpid(emulator, NULL, 0);
+    }
+
+    return result;
+}
@@ -0,0 +1,103 @@
+/*
+ * Ingest rate and query latency of the series store:
+ *   seriesBench <store> [million samples] [queries]
+ * 126 sensors report humidity and temperature once a second, the queries read one hour of one sensor channel
+ * at random places, the roll-up queries one day.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "seriesStore.h"
+
+enum {
+    sensors = 126,
+    hourMillis = 3600 * 1000
+};
+
+static double seconds_( void )
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s <store> [million samples] [queries]\n", argv[0]);
+        return 2;
+    }
+
+    char name[4096];
+    double const millions = argc > 2 ? atof(argv[2]) : 10;
+    unsigned const queries = argc > 3 ? atoi(argv[3]) : 200;
+    size_t const total = millions * 1e6;
+    int64_t const epoch = 1700000000000LL;
+
+    snprintf(name, sizeof(name), "%s.samples", argv[1]);
+    unlink(name);
+    snprintf(name, sizeof(name), "%s.rollup", argv[1]);
+    unlink(name);
+
+    struct SeriesStore * const store = seriesOpen(argv[1], 60000);
+    if(!store) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    double start = seconds_();
+
+    for(size_t i = 0; i<total; ++i) {
+        size_t const second = i / (2 * sensors);
+        uint8_t const address = 1 + (i / 2) % sensors;
+        uint8_t const channel = 2 + (i & 1);
+        struct SeriesSample const sample = {
+            epoch + second * 1000 + address, address, channel, 0, (channel == 2 ? 4000 : 2000) + (second + address) % 1000
+        };
+
+        if(seriesAppend(store, &sample) != 0) {
+            perror("append");
+            return 1;
+        }
+    }
+
+    double const ingest = seconds_() - start;
+    int64_t const span = (int64_t)(total / (2 * sensors)) * 1000;
+
+    printf("ingest  %zu samples in %.2f s, %.2f M samples/s, %zu roll-ups\n", total, ingest, total / ingest / 1e6,
+           seriesRollupCount(store));
+
+    struct SeriesSample * const samples = malloc(sizeof(*samples) * 4000);
+    struct SeriesRollup * const rollups = malloc(sizeof(*rollups) * 1500);
+    size_t found = 0;
+
+    srand(1);
+    start = seconds_();
+    for(unsigned i = 0; i<queries; ++i) {
+        int64_t const from = epoch + (span > hourMillis ? rand() % (span - hourMillis) : 0);
+
+        found += seriesQuery(store, 1 + rand() % sensors, 2 + rand() % 2, from, from + hourMillis, samples, 4000);
+    }
+    double const query = (seconds_() - start) / queries;
+
+    printf("query   1 h of one channel: %.3f ms, %.0f samples each\n", query * 1000, (double)found / queries);
+
+    found = 0;
+    start = seconds_();
+    for(unsigned i = 0; i<queries; ++i) {
+        found += seriesQueryRollups(store, 1 + rand() % sensors, 2 + rand() % 2, epoch, epoch + 24LL * hourMillis,
+                                    rollups, 1500);
+    }
+    double const rollup = (seconds_() - start) / queries;
+
+    printf("rollup  1 day of one channel: %.3f ms, %.0f buckets each\n", rollup * 1000, (double)found / queries);
+
+    free(samples);
+    free(rollups);
+    seriesClose(store);
+    return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Prints the samples or roll-ups of one sensor channel from a series store:
+ *   seriesQuery [-r] <store> <address> <channel> [from ms] [to ms]
+ * The channel is the telemetry command id of the reading, 2 humidity and 3 temperature.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "seriesStore.h"
+
+int main(int argc, char **argv)
+{
+    int const rollups = argc > 1 && strcmp(argv[1], "-r") == 0;
+    char ** const args = argv + rollups;
+    int const count = argc - rollups;
+
+    if(count < 4) {
+        fprintf(stderr, "usage: %s [-r] <store> <address> <channel> [from ms] [to ms]\n", argv[0]);
+        return 2;
+    }
+
+    struct SeriesStore * const store = seriesOpenReadOnly(args[1]);
+    uint8_t const address = strtoul(args[2], NULL, 0);
+    uint8_t const channel = strtoul(args[3], NULL, 0);
+    int64_t const from = count > 4 ? strtoll(args[4], NULL, 0) : INT64_MIN;
+    int64_t const to = count > 5 ? strtoll(args[5], NULL, 0) : INT64_MAX;
+
+    if(!store) {
+        perror(args[1]);
+        return 1;
+    }
+
+    if(rollups) {
+        size_t const found = seriesQueryRollups(store, address, channel, from, to, NULL, 0);
+        struct SeriesRollup * const rollup = calloc(found + 1, sizeof(*rollup));
+
+        seriesQueryRollups(store, address, channel, from, to, rollup, found);
+        for(size_t i = 0; i<found; ++i) {
+            printf("%" PRId64 " %u %d %d %.2f\n", rollup[i].start, rollup[i].count, rollup[i].minimum, rollup[i].maximum,
+                   (double)rollup[i].sum / rollup[i].count);
+        }
+        free(rollup);
+    } else {
+        size_t const found = seriesQuery(store, address, channel, from, to, NULL, 0);
+        struct SeriesSample * const sample = calloc(found + 1, sizeof(*sample));
+
+        seriesQuery(store, address, channel, from, to, sample, found);
+        for(size_t i = 0; i<found; ++i) {
+            printf("%" PRId64 " %u %d\n", sample[i].timestamp, sample[i].status, sample[i].value);
+        }
+        free(sample);
+    }
+
+    seriesClose(store);
+    return 0;
+}
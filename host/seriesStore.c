@@ -0,0 +1,433 @@
+#define _GNU_SOURCE
+#include "seriesStore.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "protocol.h"
+
+enum {
+    SERIES_MAGIC = 0x5354534d, //"MSTS"
+    SERIES_VERSION = 1,
+    maxColumns = 8,
+    addresses = TELEMETRY_PROBE_ADDRESS
+};
+
+struct SeriesFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t columns;
+    uint32_t chunkRecords;
+    uint32_t chunkSize;         //Bytes per chunk including its header
+    uint64_t count;             //Records written, only counted once all their columns are in place
+    int64_t rollupMillis;
+    uint8_t columnWidth[maxColumns];
+    uint8_t reserved[64 - 40];
+};
+
+struct SeriesChunkHeader {
+    int64_t first;              //Smallest timestamp in the chunk
+    int64_t last;               //Largest one
+};
+
+struct ColumnFile {
+    int fd;
+    int protection;             //Of the mapping, PROT_READ only for a store opened read only
+    uint8_t * map;
+    size_t mapSize;
+    size_t columnOffset[maxColumns]; //Of the column inside a chunk
+};
+
+/* Accumulates the bucket of one sensor channel that is still open */
+struct Bucket {
+    struct SeriesRollup rollup;
+    int open;
+};
+
+struct SeriesStore {
+    struct ColumnFile samples;
+    struct ColumnFile rollups;
+    int64_t rollupMillis;
+    struct Bucket buckets[addresses][SERIES_CHANNELS];
+};
+
+/* Columns of the files, the order is the order of the arrays in a chunk */
+enum { sampleTime, sampleAddress, sampleChannel, sampleStatus, sampleValue, sampleColumns };
+static uint8_t const sampleWidths[sampleColumns] = { 8, 1, 1, 1, 2 };
+
+enum { rollupStart, rollupAddress, rollupChannel, rollupCount, rollupMinimum, rollupMaximum, rollupSum, rollupColumns };
+static uint8_t const rollupWidths[rollupColumns] = { 8, 1, 1, 4, 2, 2, 8 };
+
+static struct SeriesFileHeader * header_(struct ColumnFile const * const file)
+{
+    return (struct SeriesFileHeader *)file->map;
+}
+
+static struct SeriesChunkHeader * chunk_(struct ColumnFile const * const file, size_t const chunk)
+{
+    return (struct SeriesChunkHeader *)(file->map + sizeof(struct SeriesFileHeader) + chunk * header_(file)->chunkSize);
+}
+
+static void * column_(struct ColumnFile const * const file, size_t const chunk, unsigned const column)
+{
+    return (uint8_t *)chunk_(file, chunk) + file->columnOffset[column];
+}
+
+static size_t chunks_(struct ColumnFile const * const file)
+{
+    return (file->mapSize - sizeof(struct SeriesFileHeader)) / header_(file)->chunkSize;
+}
+
+static int map_(struct ColumnFile * const file, size_t const size)
+{
+    if((file->protection & PROT_WRITE) && ftruncate(file->fd, size) != 0) {
+        return -1;
+    }
+
+    void * const map = file->map ? mremap(file->map, file->mapSize, size, MREMAP_MAYMOVE)
+                                 : mmap(NULL, size, file->protection, MAP_SHARED, file->fd, 0);
+
+    if(map == MAP_FAILED) {
+        return -1;
+    }
+
+    file->map = map;
+    file->mapSize = size;
+    return 0;
+}
+
+static int openFile_(struct ColumnFile * const file, char const * const path, uint8_t const * const widths,
+                     unsigned const columns, int64_t * const rollupMillis, bool const writable)
+{
+    struct SeriesFileHeader header;
+    struct stat status;
+    size_t offset = sizeof(struct SeriesChunkHeader);
+
+    memset(&header, 0, sizeof(header));
+    header.magic = SERIES_MAGIC;
+    header.version = SERIES_VERSION;
+    header.columns = columns;
+    header.chunkRecords = SERIES_CHUNK_RECORDS;
+    header.rollupMillis = *rollupMillis;
+
+    for(unsigned i = 0; i<columns; ++i) {
+        header.columnWidth[i] = widths[i];
+        file->columnOffset[i] = offset;
+        offset += (size_t)widths[i] * SERIES_CHUNK_RECORDS;
+    }
+    header.chunkSize = offset;
+
+    file->map = NULL;
+    file->protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    file->fd = writable ? open(path, O_RDWR | O_CREAT, 0644) : open(path, O_RDONLY);
+    if(file->fd < 0 || fstat(file->fd, &status) != 0) {
+        return -1;
+    }
+
+    if(status.st_size < (off_t)sizeof(header) && !writable) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if(status.st_size == 0) {
+        if(map_(file, sizeof(header) + header.chunkSize) != 0) {
+            return -1;
+        }
+        memcpy(file->map, &header, sizeof(header));
+        chunk_(file, 0)->first = INT64_MAX;
+        chunk_(file, 0)->last = INT64_MIN;
+        return 0;
+    }
+
+    if(map_(file, status.st_size) != 0) {
+        return -1;
+    }
+
+    struct SeriesFileHeader const * const existing = header_(file);
+
+    if(existing->magic != SERIES_MAGIC || existing->version != SERIES_VERSION || existing->columns != columns ||
+       existing->chunkSize != header.chunkSize || memcmp(existing->columnWidth, header.columnWidth, maxColumns) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *rollupMillis = existing->rollupMillis;
+    return 0;
+}
+
+static void closeFile_(struct ColumnFile * const file)
+{
+    if(file->map) {
+        if(file->protection & PROT_WRITE) {
+            msync(file->map, file->mapSize, MS_SYNC);
+        }
+        munmap(file->map, file->mapSize);
+    }
+    if(file->fd >= 0) {
+        close(file->fd);
+    }
+}
+
+/* Returns the index of the next record, the file grows by a chunk when it is full */
+static int64_t reserve_(struct ColumnFile * const file, int64_t const timestamp)
+{
+    uint64_t const index = header_(file)->count;
+    size_t const chunk = index / SERIES_CHUNK_RECORDS;
+
+    if(chunk >= chunks_(file)) {
+        if(map_(file, file->mapSize + header_(file)->chunkSize) != 0) {
+            return -1;
+        }
+        chunk_(file, chunk)->first = INT64_MAX;
+        chunk_(file, chunk)->last = INT64_MIN;
+    }
+
+    struct SeriesChunkHeader * const header = chunk_(file, chunk);
+
+    if(timestamp < header->first) header->first = timestamp;
+    if(timestamp > header->last) header->last = timestamp;
+
+    return index;
+}
+
+#define COLUMN(file, type, column, index) \
+    ((type *)column_((file), (index) / SERIES_CHUNK_RECORDS, (column)))[(index) % SERIES_CHUNK_RECORDS]
+
+static int appendRollup_(struct SeriesStore * const store, struct SeriesRollup const * const rollup)
+{
+    int64_t const index = reserve_(&store->rollups, rollup->start);
+
+    if(index < 0) {
+        return -1;
+    }
+
+    COLUMN(&store->rollups, int64_t, rollupStart, index) = rollup->start;
+    COLUMN(&store->rollups, uint8_t, rollupAddress, index) = rollup->address;
+    COLUMN(&store->rollups, uint8_t, rollupChannel, index) = rollup->channel;
+    COLUMN(&store->rollups, uint32_t, rollupCount, index) = rollup->count;
+    COLUMN(&store->rollups, int16_t, rollupMinimum, index) = rollup->minimum;
+    COLUMN(&store->rollups, int16_t, rollupMaximum, index) = rollup->maximum;
+    COLUMN(&store->rollups, int64_t, rollupSum, index) = rollup->sum;
+    ++header_(&store->rollups)->count;
+
+    return 0;
+}
+
+static struct SeriesStore * open_(char const * const path, int64_t rollupMillis, bool const writable)
+{
+    struct SeriesStore * const store = calloc(1, sizeof(*store));
+    char name[4096];
+
+    if(!store) {
+        return NULL;
+    }
+
+    store->samples.fd = -1;
+    store->rollups.fd = -1;
+
+    snprintf(name, sizeof(name), "%s.samples", path);
+    if(openFile_(&store->samples, name, sampleWidths, sampleColumns, &rollupMillis, writable) != 0) {
+        seriesClose(store);
+        return NULL;
+    }
+
+    snprintf(name, sizeof(name), "%s.rollup", path);
+    if(openFile_(&store->rollups, name, rollupWidths, rollupColumns, &rollupMillis, writable) != 0) {
+        seriesClose(store);
+        return NULL;
+    }
+
+    store->rollupMillis = rollupMillis > 0 ? rollupMillis : 60000;
+    return store;
+}
+
+struct SeriesStore * seriesOpen(char const * const path, int64_t const rollupMillis)
+{
+    return open_(path, rollupMillis, true);
+}
+
+struct SeriesStore * seriesOpenReadOnly(char const * const path)
+{
+    return open_(path, 0, false);
+}
+
+void seriesClose(struct SeriesStore * const store)
+{
+    if(!store) {
+        return;
+    }
+
+    if(store->rollups.map && (store->rollups.protection & PROT_WRITE)) {
+        for(unsigned address = 0; address < addresses; ++address) {
+            for(unsigned channel = 0; channel < SERIES_CHANNELS; ++channel) {
+                if(store->buckets[address][channel].open) {
+                    appendRollup_(store, &store->buckets[address][channel].rollup);
+                }
+            }
+        }
+    }
+
+    closeFile_(&store->samples);
+    closeFile_(&store->rollups);
+    free(store);
+}
+
+int seriesAppend(struct SeriesStore * const store, struct SeriesSample const * const sample)
+{
+    int64_t const index = reserve_(&store->samples, sample->timestamp);
+
+    if(index < 0) {
+        return -1;
+    }
+
+    COLUMN(&store->samples, int64_t, sampleTime, index) = sample->timestamp;
+    COLUMN(&store->samples, uint8_t, sampleAddress, index) = sample->address;
+    COLUMN(&store->samples, uint8_t, sampleChannel, index) = sample->channel;
+    COLUMN(&store->samples, uint8_t, sampleStatus, index) = sample->status;
+    COLUMN(&store->samples, int16_t, sampleValue, index) = sample->value;
+    ++header_(&store->samples)->count;
+
+    if(sample->status != 0 || sample->address >= addresses || sample->channel >= SERIES_CHANNELS) {
+        return 0; //Failed transactions are kept in the samples, but have no value for the roll-ups
+    }
+
+    struct Bucket * const bucket = &store->buckets[sample->address][sample->channel];
+    int64_t const offset = sample->timestamp % store->rollupMillis;
+    int64_t const start = sample->timestamp - (offset < 0 ? offset + store->rollupMillis : offset); //Floor, also before 1970
+
+    if(bucket->open && bucket->rollup.start != start) {
+        if(appendRollup_(store, &bucket->rollup) != 0) {
+            return -1;
+        }
+        bucket->open = 0;
+    }
+
+    if(!bucket->open) {
+        struct SeriesRollup const rollup = { start, sample->address, sample->channel, 0, INT16_MAX, INT16_MIN, 0 };
+
+        bucket->rollup = rollup;
+        bucket->open = 1;
+    }
+
+    ++bucket->rollup.count;
+    bucket->rollup.sum += sample->value;
+    if(sample->value < bucket->rollup.minimum) bucket->rollup.minimum = sample->value;
+    if(sample->value > bucket->rollup.maximum) bucket->rollup.maximum = sample->value;
+
+    return 0;
+}
+
+void seriesSync(struct SeriesStore * const store)
+{
+    msync(store->samples.map, store->samples.mapSize, MS_ASYNC);
+    msync(store->rollups.map, store->rollups.mapSize, MS_ASYNC);
+}
+
+size_t seriesCount(struct SeriesStore const * const store)
+{
+    return header_(&store->samples)->count;
+}
+
+size_t seriesRollupCount(struct SeriesStore const * const store)
+{
+    return header_(&store->rollups)->count;
+}
+
+/* Calls found for every record in the window whose address and channel match, chunk by chunk */
+static size_t scan_(struct ColumnFile const * const file, unsigned const timeColumn, unsigned const addressColumn,
+                    unsigned const channelColumn, uint8_t const address, uint8_t const channel, int64_t const from,
+                    int64_t const to, void (* const found)(struct ColumnFile const *, uint64_t, size_t, void *),
+                    void * const context)
+{
+    uint64_t const count = header_(file)->count;
+    size_t matches = 0;
+
+    for(size_t chunk = 0; (uint64_t)chunk * SERIES_CHUNK_RECORDS < count; ++chunk) {
+        struct SeriesChunkHeader const * const header = chunk_(file, chunk);
+
+        if(header->last < from || header->first >= to) {
+            continue;
+        }
+
+        int64_t const * const times = column_(file, chunk, timeColumn);
+        uint8_t const * const addresses = column_(file, chunk, addressColumn);
+        uint8_t const * const channels = column_(file, chunk, channelColumn);
+        uint64_t const base = (uint64_t)chunk * SERIES_CHUNK_RECORDS;
+        size_t const records = count - base < SERIES_CHUNK_RECORDS ? count - base : SERIES_CHUNK_RECORDS;
+
+        for(size_t i = 0; i<records; ++i) {
+            if(addresses[i] == address && channels[i] == channel && times[i] >= from && times[i] < to) {
+                found(file, base + i, matches++, context);
+            }
+        }
+    }
+
+    return matches;
+}
+
+struct SampleOutput {
+    struct SeriesSample * samples;
+    size_t size;
+};
+
+static void sampleFound_(struct ColumnFile const * const file, uint64_t const index, size_t const match, void * const context)
+{
+    struct SampleOutput const * const output = context;
+
+    if(match < output->size) {
+        struct SeriesSample * const sample = &output->samples[match];
+
+        sample->timestamp = COLUMN(file, int64_t, sampleTime, index);
+        sample->address = COLUMN(file, uint8_t, sampleAddress, index);
+        sample->channel = COLUMN(file, uint8_t, sampleChannel, index);
+        sample->status = COLUMN(file, uint8_t, sampleStatus, index);
+        sample->value = COLUMN(file, int16_t, sampleValue, index);
+    }
+}
+
+size_t seriesQuery(struct SeriesStore const * const store, uint8_t const address, uint8_t const channel,
+                   int64_t const from, int64_t const to, struct SeriesSample * const samples, size_t const size)
+{
+    struct SampleOutput output = { samples, size };
+
+    return scan_(&store->samples, sampleTime, sampleAddress, sampleChannel, address, channel, from, to,
+                 sampleFound_, &output);
+}
+
+struct RollupOutput {
+    struct SeriesRollup * rollups;
+    size_t size;
+};
+
+static void rollupFound_(struct ColumnFile const * const file, uint64_t const index, size_t const match, void * const context)
+{
+    struct RollupOutput const * const output = context;
+
+    if(match < output->size) {
+        struct SeriesRollup * const rollup = &output->rollups[match];
+
+        rollup->start = COLUMN(file, int64_t, rollupStart, index);
+        rollup->address = COLUMN(file, uint8_t, rollupAddress, index);
+        rollup->channel = COLUMN(file, uint8_t, rollupChannel, index);
+        rollup->count = COLUMN(file, uint32_t, rollupCount, index);
+        rollup->minimum = COLUMN(file, int16_t, rollupMinimum, index);
+        rollup->maximum = COLUMN(file, int16_t, rollupMaximum, index);
+        rollup->sum = COLUMN(file, int64_t, rollupSum, index);
+    }
+}
+
+size_t seriesQueryRollups(struct SeriesStore const * const store, uint8_t const address, uint8_t const channel,
+                          int64_t const from, int64_t const to, struct SeriesRollup * const rollups, size_t const size)
+{
+    struct RollupOutput output = { rollups, size };
+
+    return scan_(&store->rollups, rollupStart, rollupAddress, rollupChannel, address, channel, from, to,
+                 rollupFound_, &output);
+}
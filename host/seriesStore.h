@@ -0,0 +1,86 @@
+#ifndef SERIES_STORE_H
+#define SERIES_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Append only time series of sensor samples in memory mapped files. Records have a fixed size and are stored
+ * column by column in chunks of SERIES_CHUNK_RECORDS, every chunk keeps the time range it covers so a query
+ * only touches the chunks of its window. Next to the samples a second file holds roll-ups: count, minimum,
+ * maximum and sum of every sensor channel per bucket of rollupMillis.
+ *
+ * Layout of <path>.samples and <path>.rollup:
+ *   struct SeriesFileHeader, then chunks of struct SeriesChunkHeader followed by one array per column.
+ */
+enum {
+    SERIES_CHUNK_RECORDS = 65536,
+    SERIES_CHANNELS      = 8   //Telemetry command ids that produce a value
+};
+
+struct SeriesSample {
+    int64_t timestamp;   //Milliseconds since the epoch
+    uint8_t address;
+    uint8_t channel;     //enum TelemetryCommandId of the reading
+    uint8_t status;      //enum BridgeStatus
+    int16_t value;       //Signed for the temperature, the other readings stay below 32768
+};
+
+struct SeriesRollup {
+    int64_t start;       //Begin of the bucket
+    uint8_t address;
+    uint8_t channel;
+    uint32_t count;      //Samples with status ok in the bucket
+    int16_t minimum;
+    int16_t maximum;
+    int64_t sum;
+};
+
+struct SeriesStore;
+
+/**
+ * @brief seriesOpen opens or creates the store
+ * @param rollupMillis Bucket width of the roll-ups, taken from the file if it exists already
+ * @return NULL with errno set on error
+ */
+struct SeriesStore * seriesOpen(char const * path, int64_t rollupMillis);
+
+/**
+ * @brief seriesOpenReadOnly opens an existing store for queries only, nothing is created
+ * @return NULL with errno set on error, ENOENT if there is no store at path
+ */
+struct SeriesStore * seriesOpenReadOnly(char const * path);
+
+/**
+ * @brief seriesClose writes the open roll-up buckets and unmaps the files
+ */
+void seriesClose(struct SeriesStore * store);
+
+/**
+ * @brief seriesAppend adds a sample, samples of a sensor channel need to come in time order for the roll-ups
+ * @return 0 on success, -1 if a file could not grow
+ */
+int seriesAppend(struct SeriesStore * store, struct SeriesSample const * sample);
+
+/**
+ * @brief seriesSync flushes the mapped pages to the disk
+ */
+void seriesSync(struct SeriesStore * store);
+
+size_t seriesCount(struct SeriesStore const * store);
+size_t seriesRollupCount(struct SeriesStore const * store);
+
+/**
+ * @brief seriesQuery returns the samples of a sensor channel with from <= timestamp < to
+ * @return Number of samples found, only the first size of them are written to samples
+ */
+size_t seriesQuery(struct SeriesStore const * store, uint8_t address, uint8_t channel, int64_t from, int64_t to,
+                   struct SeriesSample * samples, size_t size);
+
+/**
+ * @brief seriesQueryRollups does the same for the roll-up buckets starting in the window
+ */
+size_t seriesQueryRollups(struct SeriesStore const * store, uint8_t address, uint8_t channel, int64_t from, int64_t to,
+                          struct SeriesRollup * rollups, size_t size);
+
+#endif
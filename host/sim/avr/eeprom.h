@@ -0,0 +1,25 @@
+#ifndef SIM_AVR_EEPROM_H
+#define SIM_AVR_EEPROM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The EEMEM variables get a section of their own, their offset in it is the EEPROM address */
+#define EEMEM __attribute__((section("simeeprom")))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint8_t eeprom_read_byte(uint8_t const * address);
+uint16_t eeprom_read_word(uint16_t const * address);
+void eeprom_read_block(void * destination, void const * source, size_t size);
+void eeprom_update_byte(uint8_t * address, uint8_t value);
+void eeprom_update_word(uint16_t * address, uint16_t value);
+void eeprom_update_block(void const * source, void * destination, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+#include "io.h"
+
+/* The vectors become plain functions the simulator looks up in the module by name */
+#ifdef __cplusplus
+    #define ISR(vector) extern "C" void vector(void); void vector(void)
+#else
+    #define ISR(vector) void vector(void); void vector(void)
+#endif
+
+#define sei() (simDevice.sreg |= (1<<SREG_I))
+#define cli() (simDevice.sreg &= ~(1<<SREG_I))
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+/* ATtiny45 registers and bits used by the firmware, see simDevice.h */
+
+#include <stdint.h>
+
+#include "../simDevice.h"
+
+#define SREG    (simDevice.sreg)
+#define CLKPR   (simDevice.clkpr)
+#define PRR     (simDevice.prr)
+#define DDRB    (simDevice.ddrb)
+#define PORTB   (simDevice.portb)
+#define PINB    (simDevice.pinb)
+#define TCCR0A  (simDevice.tccr0a)
+#define TCCR0B  (simDevice.tccr0b)
+#define OCR0A   (simDevice.ocr0a)
+#define OCR0B   (simDevice.ocr0b)
+#define TIFR    (simDevice.tifr)
+#define TCCR1   (simDevice.tccr1)
+#define OCR1A   (simDevice.ocr1a)
+#define OCR1C   (simDevice.ocr1c)
+#define TIMSK   (simDevice.timsk)
+#define USICR   (simDevice.usicr)
+#define USISR   (simDevice.usisr)
+#define USIDR   (simDevice.usidr)
+#define ADMUX   (simDevice.admux)
+#define ADCSRA  (*simAdcsra())
+#define ADCSRB  (simDevice.adcsrb)
+#define ADCL    (simDevice.adcl)
+#define ADCH    (simDevice.adch)
+#define EECR    (simDevice.eecr)
+#define EEDR    (simDevice.eedr)
+#define EEAR    (simDevice.eear)
+
+#define E2END   255
+
+#define CLKPCE  7
+#define CLKPS3  3
+#define CLKPS2  2
+#define CLKPS1  1
+#define CLKPS0  0
+
+#define PRTIM1  3
+#define PRTIM0  2
+#define PRUSI   1
+#define PRADC   0
+
+#define DDB5    5
+#define DDB4    4
+#define DDB3    3
+#define DDB2    2
+#define DDB1    1
+#define DDB0    0
+
+#define PB4     4
+
+#define COM0A1  7
+#define COM0A0  6
+#define COM0B1  5
+#define COM0B0  4
+#define WGM01   1
+#define WGM00   0
+#define WGM02   3
+#define CS02    2
+#define CS01    1
+#define CS00    0
+
+#define CTC1    7
+#define CS13    3
+#define CS12    2
+#define CS11    1
+#define CS10    0
+
+#define OCIE1A  6
+
+#define OCF0A   4
+#define OCF0B   3
+
+#define USISIE  7
+#define USIOIE  6
+#define USIWM1  5
+#define USIWM0  4
+#define USICS1  3
+#define USICS0  2
+#define USICLK  1
+#define USITC   0
+
+#define USISIF  7
+#define USIOIF  6
+#define USIPF   5
+#define USIDC   4
+#define USICNT0 0
+
+#define REFS1   7
+#define REFS0   6
+#define ADLAR   5
+#define REFS2   4
+
+#define ADEN    7
+#define ADSC    6
+#define ADATE   5
+#define ADIF    4
+#define ADIE    3
+#define ADPS2   2
+#define ADPS1   1
+#define ADPS0   0
+
+#define ADTS2   2
+#define ADTS1   1
+#define ADTS0   0
+
+#define EEPM1   5
+#define EEPM0   4
+#define EERIE   3
+#define EEMPE   2
+#define EEPE    1
+#define EERE    0
+
+#define SREG_I  7
+
+#endif
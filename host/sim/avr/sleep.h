@@ -0,0 +1,10 @@
+#ifndef SIM_AVR_SLEEP_H
+#define SIM_AVR_SLEEP_H
+
+/* The simulator replaces twiSleep(), which is the only place the firmware sleeps */
+#define SLEEP_MODE_IDLE 0
+
+#define set_sleep_mode(mode) ((void)(mode))
+#define sleep_mode() ((void)0)
+
+#endif
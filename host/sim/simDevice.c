@@ -0,0 +1,145 @@
+#include "simDevice.h"
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+
+#include <stdint.h>
+#include <string.h>
+
+enum {
+    firstConversionClocks = 25, //Includes the initialisation of the analog circuit
+    conversionClocks = 13,
+    noiseLsb = 3                //Conversions scatter by up to +-3 LSB
+};
+
+struct SimDevice simDevice;
+
+/* Defined by the linker for the section of EEMEM, see avr/eeprom.h */
+extern uint8_t __start_simeeprom[];
+extern uint8_t __stop_simeeprom[];
+
+void simDeviceInit( void )
+{
+    simDevice.eeprom = __start_simeeprom;
+    simDevice.eepromSize = __stop_simeeprom - __start_simeeprom;
+
+    memset(simDevice.eeprom, 0xff, simDevice.eepromSize);
+}
+
+/* Pointers into the section map to their offset, anything else is taken as a plain EEPROM address */
+static uint8_t * eepromAt_(void const * const address)
+{
+    uint8_t const * const byte = address;
+
+    if(byte >= __start_simeeprom && byte < __stop_simeeprom) {
+        return (uint8_t *)byte;
+    }
+
+    return __start_simeeprom + (uintptr_t)address;
+}
+
+uint8_t eeprom_read_byte(uint8_t const * const address)
+{
+    return *eepromAt_(address);
+}
+
+uint16_t eeprom_read_word(uint16_t const * const address)
+{
+    uint16_t result;
+
+    memcpy(&result, eepromAt_(address), sizeof(result));
+    return result;
+}
+
+void eeprom_read_block(void * const destination, void const * const source, size_t const size)
+{
+    memcpy(destination, eepromAt_(source), size);
+}
+
+/* The bridge code writes through these, the sensor firmware through EECR */
+void eeprom_update_byte(uint8_t * const address, uint8_t const value)
+{
+    *eepromAt_(address) = value;
+}
+
+void eeprom_update_word(uint16_t * const address, uint16_t const value)
+{
+    memcpy(eepromAt_(address), &value, sizeof(value));
+}
+
+void eeprom_update_block(void const * const source, void * const destination, size_t const size)
+{
+    memcpy(eepromAt_(destination), source, size);
+}
+
+static uint32_t random_( void )
+{
+    simDevice.noise ^= simDevice.noise << 13;
+    simDevice.noise ^= simDevice.noise >> 17;
+    simDevice.noise ^= simDevice.noise << 5;
+
+    return simDevice.noise;
+}
+
+static uint16_t noise_( void )
+{
+    return random_() % (2 * noiseLsb + 1);
+}
+
+/* The excitation is high or low on ADC3 when the sample and hold closes. phase is +1 or -1, 0 picks one at random. */
+static uint16_t sample_(int phase)
+{
+    bool const probe = (simDevice.admux & 0x0f) == 0x03;
+    uint16_t const level = (simDevice.admux & 0x0f) == 0x0f ? simDevice.temperature : simDevice.humidity;
+    int32_t value = (int32_t)level + noise_() - noiseLsb;
+
+    if(probe && simDevice.ripple) {
+        if(!phase) {
+            phase = (random_() & 0x100) ? 1 : -1;
+        }
+
+        value += phase * (int32_t)simDevice.ripple;
+    }
+
+    return value < 0 ? 0 : value > 1023 ? 1023 : value;
+}
+
+/* Auto triggered by Timer0 compare A once its flag is cleared, the rising edge of the next match starts it. The
+ * conversion is assumed to start on that match, as the datasheet has it, the model can't tell if it does. OC0B is
+ * cleared on that match, unless inverted. */
+static int triggerPhase_( void )
+{
+    if(!(simDevice.adcsra & (1<<ADATE)) || (simDevice.adcsrb & 0x07) != ((1<<ADTS1) | (1<<ADTS0)) ||
+       !(simDevice.tifr & (1<<OCF0A))) {
+        return 0;
+    }
+
+    simDevice.tifr &= ~(1<<OCF0A);
+    return (simDevice.tccr0a & (1<<COM0B0)) ? 1 : -1;
+}
+
+uint8_t volatile * simAdcsra( void )
+{
+    int phase = 0;
+
+    if(!(simDevice.adcsra & (1<<ADEN))) {
+        simDevice.adcRunning = false;
+    } else if((simDevice.adcsra & (1<<ADSC)) || (phase = triggerPhase_()) != 0) {
+        unsigned const prescaler = (simDevice.adcsra & 0x07) ? 1u << (simDevice.adcsra & 0x07) : 2;
+        unsigned const clocks = simDevice.adcRunning ? conversionClocks : firstConversionClocks;
+        int64_t const done = *simDevice.clock + (int64_t)clocks * prescaler * 1000000000 / simDevice.cpuHz;
+
+        while(*simDevice.clock < done) {
+            simDevice.wait(&simDevice, done);
+        }
+
+        uint16_t const value = sample_(phase);
+
+        simDevice.adcl = value & 0xff;
+        simDevice.adch = value >> 8;
+        simDevice.adcsra = (simDevice.adcsra & ~(1<<ADSC)) | (1<<ADIF);
+        simDevice.adcRunning = true;
+    }
+
+    return &simDevice.adcsra;
+}
@@ -0,0 +1,78 @@
+#ifndef SIM_DEVICE_H
+#define SIM_DEVICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Register file and peripheral state of one simulated ATtiny45. The firmware is built as a loadable module with the
+ * headers of this directory in place of avr-libc, so every register access lands in the simDevice of its own copy
+ * of the module. The simulator drives the USI and the EEPROM from the outside and calls the interrupt vectors.
+ */
+struct SimDevice {
+    uint8_t sreg;
+    uint8_t clkpr;
+    uint8_t prr;
+    uint8_t ddrb;
+    uint8_t portb;
+    uint8_t pinb;
+    uint8_t tccr0a;
+    uint8_t tccr0b;
+    uint8_t ocr0a;
+    uint8_t ocr0b;
+    uint8_t tifr;            //Flags the firmware cleared by writing a one, the next compare match sets them again
+    uint8_t tccr1;
+    uint8_t ocr1a;
+    uint8_t ocr1c;
+    uint8_t timsk;
+    uint8_t usicr;
+    uint8_t usisr;
+    uint8_t usidr;
+    uint8_t admux;
+    uint8_t adcsra;
+    uint8_t adcsrb;
+    uint8_t adcl;
+    uint8_t adch;
+    uint8_t eecr;
+    uint8_t eedr;
+    uint16_t eear;
+
+    /* Set by the simulator before main() runs */
+    int64_t const * clock;   //Simulated time in ns
+    unsigned long cpuHz;
+    uint16_t humidity;       //ADC3 reading the probe settles at
+    uint16_t temperature;    //Reading of the internal sensor
+    uint16_t ripple;         //Amplitude of the excitation on ADC3, the sign depends on the phase of the sample
+    uint32_t noise;          //LFSR state for the conversion noise, never 0
+    void (*wait)(struct SimDevice * device, int64_t until); //Suspends main() until the clock reaches until
+    void (*idle)(struct SimDevice * device);                //Suspends main() until the next interrupt
+    void * context;
+
+    /* Kept by the module */
+    uint8_t * eeprom;        //The firmware writes the low 16 bit of its address + offset to EEAR
+    uint16_t eepromSize;
+    bool adcRunning;         //Enabled and converted at least once, the first conversion takes longer
+};
+
+extern struct SimDevice simDevice;
+
+/**
+ * @brief simDeviceInit points the EEPROM at the EEMEM variables of the module and erases it
+ */
+void simDeviceInit( void );
+
+/**
+ * @brief simAdcsra runs the conversion the firmware or a cleared Timer0 flag started, main() is suspended until it is
+ * done
+ */
+uint8_t volatile * simAdcsra( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,8 @@
+#include "simDevice.h"
+#include "twiInterface.h"
+
+/* The firmware only sleeps in one bus state, a simulated core has to give up the host CPU in all of them */
+void twiSleep( void )
+{
+    simDevice.idle(&simDevice);
+}
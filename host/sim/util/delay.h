@@ -0,0 +1,7 @@
+#ifndef SIM_UTIL_DELAY_H
+#define SIM_UTIL_DELAY_H
+
+/* Busy waits of the bridge code run in the simulator, they advance the simulated time */
+void _delay_ms(double ms);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef SIM_UTIL_TWI_H
+#define SIM_UTIL_TWI_H
+
+/* Only the TWI master of the bridge uses the status codes */
+
+#endif
@@ -0,0 +1,313 @@
+/*
+ * Replays a bus trace through the decoders of the sensor and the bridge:
+ *   traceReplay [-e byte error rate] [-n repetitions] [-r seed] [-v] <trace>
+ * The trace is the record stream of uartBridge/trace.h, as sensorDaemon -T reads it from a bridge built with
+ * BRIDGE_TRACE or busSim -T captures it. The bytes the bridge wrote are clocked bit by bit through the USI interrupts
+ * of twiInterface.cpp into the HDLC decoder of the sensor, as hdlcReceiveBuffer() runs it. The bytes the bridge read go
+ * into the decoder of sensorRequest.c, which starts over with every read. Jobs that failed on the bus are counted
+ * but not replayed.
+ * With -e that share of the bytes gets a random bit flipped before it is replayed. The resync is the number of bytes
+ * from a broken byte to the end of the next good frame of the same direction. The replay runs -n times, the rates
+ * are host time of the replay against the time the traffic took on the bus.
+ */
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "simDevice.h"
+#include "hdlc.h"
+#include "protocol.h"
+#include "twiInterface.h"
+#include "uartBridge/trace.h"
+
+enum {
+    maxTrace = 64 * 1024 * 1024
+};
+
+/* The USI interrupts of twiInterface.cpp */
+void USI_START_vect( void );
+void USI_OVF_vect( void );
+
+/* The interface keeps nothing in the EEPROM, simDevice.c still wants the section */
+static uint8_t eepromUnused_ EEMEM __attribute__((used));
+
+/* One direction of the traffic */
+struct Stream {
+    char const * name;
+    struct HdlcDecoder decoder;
+    struct TelemetryCommand frame;
+    unsigned long bytes;
+    unsigned long frames;       //Complete, with a correct CRC and the length of a command
+    unsigned long broken;       //Complete but rejected by the decoder
+    unsigned long corrupted;    //Bytes -e flipped a bit of
+    unsigned long resyncs;
+    unsigned long resyncSum;
+    unsigned long resyncMax;
+    long brokenAt;              //Byte count of the first broken byte not resynced yet, -1 if none
+    struct timespec elapsed;
+};
+
+static double errorRate_;
+
+static uint8_t corrupt_(struct Stream * const stream, uint8_t const byte)
+{
+    if(errorRate_ > 0 && drand48() < errorRate_) {
+        ++stream->corrupted;
+        if(stream->brokenAt < 0) {
+            stream->brokenAt = stream->bytes;
+        }
+
+        return byte ^ (1 << (lrand48() & 7));
+    }
+
+    return byte;
+}
+
+/* hdlcReceiveBuffer() starts a new decoder for every frame, so does the sensor side here */
+static void decode_(struct Stream * const stream, uint8_t const byte, bool const restart)
+{
+    enum HdlcResult const result = hdlcDecodeChar(&stream->decoder, byte);
+
+    ++stream->bytes;
+
+    if(result == hdlcPending) {
+        return;
+    }
+
+    if(result == hdlcFrameOk && stream->decoder.length == sizeof(stream->frame)) {
+        ++stream->frames;
+
+        if(stream->brokenAt >= 0) {
+            unsigned long const resync = stream->bytes - stream->brokenAt;
+
+            ++stream->resyncs;
+            stream->resyncSum += resync;
+            if(resync > stream->resyncMax) {
+                stream->resyncMax = resync;
+            }
+            stream->brokenAt = -1;
+        }
+    } else {
+        ++stream->broken;
+    }
+
+    if(restart) {
+        hdlcDecoderInit(&stream->decoder, &stream->frame, sizeof(stream->frame));
+    }
+}
+
+/* The master drives SDA, the sensor pulls it low while its data register shifts out a 0 */
+static bool busBit_(bool const master)
+{
+    bool line = master;
+
+    if((simDevice.ddrb & (1<<DDB0)) && !(simDevice.usidr & 0x80)) {
+        line = false;
+    }
+
+    if(simDevice.usicr & (1<<USIOIE)) {
+        uint8_t const counter = (simDevice.usisr & 0x0f) + 2; //Counts both clock edges
+
+        simDevice.usidr = (simDevice.usidr << 1) | line;
+        simDevice.usisr = (simDevice.usisr & 0xf0) | (counter & 0x0f);
+
+        if(counter > 0x0f) {
+            USI_OVF_vect();
+        }
+    }
+
+    return line;
+}
+
+static bool busWrite_(uint8_t const byte)
+{
+    for(int bit = 7; bit >= 0; --bit) {
+        busBit_((byte >> bit) & 1);
+    }
+
+    return !busBit_(true);
+}
+
+/* The main loop of the sensor takes every byte before the next one arrives */
+static void sensorWrite_(struct Stream * const stream, uint8_t const address, uint8_t const * const data,
+                         uint8_t const length)
+{
+    if(simDevice.usicr & (1<<USISIE)) {
+        simDevice.pinb = 0; //SCL and SDA already low again
+        USI_START_vect();
+    }
+
+    twiSetAddress(address);
+    if(!busWrite_(address << 1)) {
+        return;
+    }
+
+    for(uint8_t i = 0; i<length; ++i) {
+        busWrite_(corrupt_(stream, data[i]));
+
+        while(twiCharAvailable()) {
+            decode_(stream, twiReceiveChar(), true);
+        }
+    }
+}
+
+static void bridgeRead_(struct Stream * const stream, uint8_t const * const data, uint8_t const length)
+{
+    hdlcDecoderInit(&stream->decoder, &stream->frame, sizeof(stream->frame));
+
+    for(uint8_t i = 0; i<length; ++i) {
+        decode_(stream, corrupt_(stream, data[i]), false);
+    }
+}
+
+static void addElapsed_(struct timespec * const sum, struct timespec const * const start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sum->tv_sec += end.tv_sec - start->tv_sec;
+    sum->tv_nsec += end.tv_nsec - start->tv_nsec;
+}
+
+static double seconds_(struct timespec const * const time)
+{
+    return time->tv_sec + time->tv_nsec / 1e9;
+}
+
+static void report_(struct Stream const * const stream, double const busSeconds)
+{
+    double const seconds = seconds_(&stream->elapsed);
+
+    printf("%s: %lu bytes, %lu frames, %lu broken, %.1f ns per byte, %.0f frames/s replayed",
+           stream->name, stream->bytes, stream->frames, stream->broken,
+           stream->bytes ? seconds * 1e9 / stream->bytes : 0.0, seconds > 0 ? stream->frames / seconds : 0.0);
+    if(busSeconds > 0) {
+        printf(", %.0fx the bus", seconds > 0 ? busSeconds / seconds : 0.0);
+    }
+    printf("\n");
+
+    if(stream->corrupted) {
+        printf("%s resync: %lu bytes corrupted, %lu resyncs, %.1f bytes mean, %lu bytes max\n", stream->name,
+               stream->corrupted, stream->resyncs,
+               stream->resyncs ? (double)stream->resyncSum / stream->resyncs : 0.0, stream->resyncMax);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned repetitions = 1;
+    unsigned seed = 1;
+    bool verbose = false;
+    int option;
+
+    while((option = getopt(argc, argv, "e:n:r:v")) != -1) {
+        switch(option) {
+        case 'e': errorRate_ = atof(optarg); break;
+        case 'n': repetitions = strtoul(optarg, NULL, 0); break;
+        case 'r': seed = strtoul(optarg, NULL, 0); break;
+        case 'v': verbose = true; break;
+        default:
+            fprintf(stderr, "usage: %s [-e byte error rate] [-n repetitions] [-r seed] [-v] <trace>\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if(optind + 1 != argc || !repetitions || errorRate_ < 0 || errorRate_ > 1) {
+        fprintf(stderr, "usage: %s [-e byte error rate] [-n repetitions] [-r seed] [-v] <trace>\n", argv[0]);
+        return 2;
+    }
+
+    FILE * const file = fopen(argv[optind], "rb");
+    uint8_t * const trace = malloc(maxTrace);
+    size_t size;
+
+    if(!file || !trace) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    size = fread(trace, 1, maxTrace, file);
+    fclose(file);
+
+    /* The records as they are, up to the first one that doesn't fit */
+    unsigned long records = 0;
+    unsigned long failed = 0;
+    unsigned long busMillis = 0;
+    size_t end = 0;
+    uint16_t lastMillis = 0;
+
+    while(end + TRACE_RECORD_HEADER <= size) {
+        struct TraceRecordHeader const * const record = (struct TraceRecordHeader const *)&trace[end];
+
+        if(record->length < TRACE_RECORD_HEADER + record->txLength || end + record->length > size) {
+            fprintf(stderr, "%s: record at %zu broken, the rest is left out\n", argv[optind], end);
+            break;
+        }
+
+        uint16_t const millis = trace[end + 4] | (trace[end + 5] << 8); //Little endian on the wire
+
+        if(verbose) {
+            printf("%5u ms %02x%s status %u, %u written, %u read\n", millis,
+                   record->address & ~TRACE_BUS_FLAG, record->address & TRACE_BUS_FLAG ? " soft" : "",
+                   record->status, record->txLength, record->length - TRACE_RECORD_HEADER - record->txLength);
+        }
+
+        uint16_t const step = millis - lastMillis;
+
+        if(records && step < 0x8000) { //busSim keeps a clock per segment, going back adds nothing
+            busMillis += step;
+        }
+        lastMillis = millis;
+        failed += record->status != 0;
+        ++records;
+        end += record->length;
+    }
+
+    struct Stream sensor = { "sensor" };
+    struct Stream bridge = { "bridge" };
+
+    sensor.brokenAt = -1;
+    bridge.brokenAt = -1;
+    srand48(seed);
+    simDeviceInit();
+    twiInitialize(TELEMETRY_PROBE_ADDRESS);
+    hdlcDecoderInit(&sensor.decoder, &sensor.frame, sizeof(sensor.frame));
+
+    for(unsigned repetition = 0; repetition<repetitions; ++repetition) {
+        struct timespec start;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(size_t offset = 0; offset<end; offset += trace[offset]) {
+            struct TraceRecordHeader const * const record = (struct TraceRecordHeader const *)&trace[offset];
+
+            if(record->status == 0 && record->txLength) {
+                sensorWrite_(&sensor, record->address & ~TRACE_BUS_FLAG, &trace[offset + TRACE_RECORD_HEADER],
+                             record->txLength);
+            }
+        }
+        addElapsed_(&sensor.elapsed, &start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(size_t offset = 0; offset<end; offset += trace[offset]) {
+            struct TraceRecordHeader const * const record = (struct TraceRecordHeader const *)&trace[offset];
+            uint8_t const read = record->length - TRACE_RECORD_HEADER - record->txLength;
+
+            if(record->status == 0 && read) {
+                bridgeRead_(&bridge, &trace[offset + TRACE_RECORD_HEADER + record->txLength], read);
+            }
+        }
+        addElapsed_(&bridge.elapsed, &start);
+    }
+
+    printf("trace: %zu bytes, %lu records, %lu failed on the bus, %.1f s of traffic\n", end, records, failed,
+           busMillis / 1e3);
+    report_(&sensor, busMillis / 1e3 * repetitions);
+    report_(&bridge, busMillis / 1e3 * repetitions);
+
+    free(trace);
+    return end != size;
+}
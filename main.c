@@ -4,12 +4,11 @@
 #include "twiInterface.h"
 #include "hdlc.h"
 #include "settings.h"
-
-struct TelemetryCommand {
-    uint8_t cmdId;
-    uint8_t cmdTag;
-    uint16_t parameter;
-};
+#include "calibration.h"
+#include "enumeration.h"
+#include "protocol.h"
+#include "probe.h"
+#include "alert.h"
 
 static void setupClockPrescaler( void )
 {
@@ -17,150 +16,237 @@ static void setupClockPrescaler( void )
     CLKPR  = (1<<CLKPS1); //Setup a Clockspeed of 2Mhz so we get 1Mhz Timeroutput ...
 }
 
-static void setupTimer0( void )
-{
-    TCCR0A = (1<<COM0B0) | //Toggle OC0B on compare
-             (1<<WGM01);   //Enable CTC mode
-
-    OCR0A  = 0;            //Should this provide a div by 2?
-    OCR0B  = 0;
-
-    TCCR0B = (1<<CS00);     //Maximum IO Clock speed, no prescaler
-}
-
 static void setupPortBConfiguration( void )
 {
     DDRB   = (1<<DDB1);    //Put Port B Pin1 into output mode
 }
 
-static uint16_t readAnalogValue( void )
-{
-    uint16_t result = 0;
-
-    ADCSRA |= (1<<ADSC); //Start conversion and clear Interrupt flag
-    while((ADCSRA & (1<<ADSC)) != 0) {} //Wait for the conversion to finish
-
-    result = (ADCL) | (ADCH << 8);   //Read the value
-
-    return result;
-}
-
-static uint16_t getHumidityReading( void )
-{
-    uint16_t result = 0;
-
-    ADMUX = 0x03; //Select PB3 (ADC3) and internal VCC Vref
-    ADCSRA |= (1<<ADEN); //Enable the ADC
-
-    for(unsigned i = 0; i<16; ++i) {
-        result += readAnalogValue();
-    }
-
-    ADCSRA &= ~(1<<ADEN); //Disable the ADC again to save power
-
-    return result;
-}
-
-
-static uint16_t getTemperatureReading( void )
-{
-    uint16_t result = 0;
-
-    ADMUX = 0x0f | (1<<REFS1); //Select Temperature Sensor and internal 1.1V Vref
-    ADCSRA |= (1<<ADEN); //Enable the ADC
-
-    for(unsigned i = 0; i<16; ++i) {
-        result += readAnalogValue();
-    }
-
-    ADCSRA &= ~(1<<ADEN); //Disable the ADC again to save power
-
-    return result;
-}
-
-
-static void setupADC( void )
-{
-   ADCSRA = (1<<ADIF) | (1<<ADPS2); //Clear IF Flag, set Prescaler to 16, which should result in 125khz clock with 2Mhz CPU Clock
-}
-
 static void setupPowerSave( void )
 {
-   PRR = (1<<PRTIM1); //Disable Clocking of timer1 we don't need
+   PRR = (1<<PRTIM1); //Disable Clocking of timer1, only the alert needs it
 }
 
 static struct TelemetryCommand commandBuffer;
+static struct Calibration stagedHumidity;    //Coefficients written by the host, applied on commit
+static struct Calibration stagedTemperature;
+static struct Enumeration enumeration;
 
 int main( void )
 {
     setupClockPrescaler();
     setupPortBConfiguration();
-    setupTimer0();
+    probeInit();
 
     /* Try to load the settings */
     struct Settings * settings = loadSettings();
     /* If it fails, create a new set of settings */
 
-    if(!settings || settings->address == 0 || settings->address > 127) {
+    if(!settings || settings->address == 0 || settings->address >= TELEMETRY_PROBE_ADDRESS) {
         settings = newSettings();
         settings->address = 1;
+    }
+
+    if(!settings->id) { //New or migrated device, it needs an id for the enumeration
+        settings->id = probeDeviceId();
         saveSettings(); /* store them to the EEPROM, so that next time loading does not fail */
     }
 
+    stagedHumidity = settings->humidity;
+    stagedTemperature = settings->temperature;
+
+    enumerationInit(&enumeration, settings->id);
+
     twiInitialize(settings->address);
-    setupADC();
     setupPowerSave();
+    alertConfigure(settings->alertLow, settings->alertHigh);
     sei();
 
     for(;;) {
 
+        /* Frames are only decoded once they start, the background samples are taken while the bus is quiet. A tick
+         * that comes right before the sleep is sampled with the next one. */
+        if(!twiCharAvailable()) {
+            if(alertDue()) {
+                alertSample(calibrateHumidity(probeHumidity(PROBE_HUMIDITY_CONVERSIONS), &settings->humidity));
+            } else {
+                twiSleep();
+            }
+            continue;
+        }
+
         //Do we have successfully received an command?
         if(hdlcReceiveBuffer(&commandBuffer, sizeof(commandBuffer)))
         {
             switch (commandBuffer.cmdId) {
-            case 0: //Ping ... we are alive ... so just loop back the data ...
+            case telemetryPing: //Ping ... we are alive ... so just loop back the data ...
             {
                 hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
                 break;
             }
 
-            case 1: //Request id
+            case telemetryId: //Request id
             {
-                commandBuffer.parameter = (1<<8)| //FW Version 1
+                commandBuffer.parameter = (2<<8)| //FW Version 2
+                                          (1<<2)| //Readings are calibrated
                                           (1<<1)| //Temperature Sensor
                                           (1<<0); //Humidity Sensor
                 hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
                 break;
             }
 
-            case 2: //Request a moisture measurement ...
+            case telemetryHumidity: //Request a moisture measurement in 0.01% ...
             {
-                commandBuffer.parameter = getHumidityReading();
+                commandBuffer.parameter = calibrateHumidity(probeHumidity(PROBE_HUMIDITY_CONVERSIONS), &settings->humidity);
                 hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
                 break;
             }
 
-            case 3: //Request a temperature measurement ...
+            case telemetryTemperature: //Request a temperature measurement in 0.01 degree Celsius ...
             {
-                commandBuffer.parameter = getTemperatureReading();
+                commandBuffer.parameter = calibrateTemperature(probeTemperature(), &settings->temperature);
                 hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
                 break;
             }
-            case 4: // Request an update of the client address ...
+            case telemetrySetAddress: // Request an update of the client address ...
             {
                 uint8_t const newAddress = commandBuffer.parameter & 0x7f;
                 uint8_t const oldAddress = (commandBuffer.parameter >> 8) & 0x7f;
 
-                if(newAddress > 0 && oldAddress == settings->address) {
+                if(newAddress > 0 && newAddress != TELEMETRY_PROBE_ADDRESS && oldAddress == settings->address) {
                     settings->address = newAddress;
+                    settings->configured = 1;
                     commandBuffer.parameter = 0;
 
                     saveSettings();
+                    twiSetAddress(newAddress);
                 } else {
                     commandBuffer.parameter = oldAddress != settings->address ? 1 : 2;
                 }
 
                 hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                break;
+            }
+
+            case telemetryRawHumidity: //Request the raw moisture sum, needed to work out the calibration
+            {
+                commandBuffer.parameter = probeHumidity(PROBE_HUMIDITY_CONVERSIONS);
+                hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                break;
+            }
+
+            case telemetryRawTemperature: //Request the raw temperature sum
+            {
+                commandBuffer.parameter = probeTemperature();
+                hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                break;
+            }
+
+            case telemetryHumidityOffset: //Stage the moisture offset
+            {
+                stagedHumidity.offset = commandBuffer.parameter;
+                hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                break;
+            }
+
+            case telemetryHumidityGain: //Stage the moisture gain (Q4.12)
+            {
+                stagedHumidity.gain = commandBuffer.parameter;
+                hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                break;
+            }
+
+            case telemetryTemperatureOffset: //Stage the temperature offset
+            {
+                stagedTemperature.offset = commandBuffer.parameter;
+                hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                break;
+            }
+
+            case telemetryTemperatureGain: //Stage the temperature gain (Q4.12)
+            {
+                stagedTemperature.gain = commandBuffer.parameter;
+                hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                break;
+            }
+
+            case telemetryCommitCalibration: //Commit the staged coefficients, they are used and stored from now on
+            {
+                settings->humidity = stagedHumidity;
+                settings->temperature = stagedTemperature;
+                commandBuffer.parameter = 0;
+
+                saveSettings();
+                hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                break;
+            }
+
+            case telemetryEnumerationStart: //Address enumeration, these come as general call and are never answered
+            case telemetryEnumerationSlot:
+            case telemetryEnumerationAssign:
+            {
+                switch(enumerationHandleCommand(&enumeration, &commandBuffer, settings->configured)) {
+                case enumerationDisarm:
+                    twiSetProbeAddress(0);
+                    twiClearSendBuffer();
+                    break;
+
+                case enumerationArm:
+                    twiClearSendBuffer();
+                    hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                    twiSetProbeAddress(TELEMETRY_PROBE_ADDRESS);
+                    break;
+
+                case enumerationAssigned:
+                    twiSetProbeAddress(0);
+                    settings->address = commandBuffer.cmdTag & 0x7f;
+                    settings->configured = 1;
+                    saveSettings();
+                    twiSetAddress(settings->address);
+                    break;
+
+                default:
+                    break;
+                }
+                break;
+            }
+
+            case telemetryAlertLow: //Set a threshold of the alert in 0.01%, stored right away
+            case telemetryAlertHigh:
+            {
+                if(commandBuffer.cmdId == telemetryAlertLow) {
+                    settings->alertLow = commandBuffer.parameter;
+                } else {
+                    settings->alertHigh = commandBuffer.parameter;
+                }
+
+                alertConfigure(settings->alertLow, settings->alertHigh);
+                saveSettings();
+                hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                break;
+            }
+
+            case telemetryAlertQuery: //General call, only a node with an alert in the range answers on the probe address
+            {
+                uint8_t const first = commandBuffer.parameter >> 8;
+                uint8_t const last = commandBuffer.parameter & 0xff;
+
+                twiSetProbeAddress(0);
+                twiClearSendBuffer();
+
+                if(alertRaised() && settings->address >= first && settings->address <= last) {
+                    commandBuffer.parameter = settings->address;
+                    hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                    twiSetProbeAddress(TELEMETRY_PROBE_ADDRESS);
+                }
+                break;
+            }
+
+            case telemetryAlertRead: //Latest background sample, releases the alert line
+            {
+                twiSetProbeAddress(0);
+                commandBuffer.parameter = alertRead();
+                hdlcSendBuffer(&commandBuffer, sizeof(commandBuffer));
+                break;
             }
 
             default:
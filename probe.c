@@ -0,0 +1,112 @@
+#include "probe.h"
+
+#include <avr/io.h>
+
+void probeInit( void )
+{
+    /* Fast PWM up to OCR0A = 1: a two cycle period, OC0B is high while TCNT0 is 0. Compare A comes once per period on
+     * a fixed half of the excitation, unlike CTC with a toggle, which matches on every cycle. */
+    OCR0A  = 1;
+    OCR0B  = 0;
+    TCCR0A = (1<<COM0B1) | //Clear OC0B on compare, set at BOTTOM
+             (1<<WGM01) | (1<<WGM00);
+
+    TCCR0B = (1<<WGM02) |  //TOP = OCR0A
+             (1<<CS00);    //Maximum IO Clock speed, no prescaler, 1 MHz on OC0B with the 2 MHz core
+
+    ADCSRA = (1<<ADIF) | (1<<ADPS2); //Clear IF Flag, set Prescaler to 16, which should result in 125khz clock with 2Mhz CPU Clock
+    ADCSRB = (1<<ADTS1) | (1<<ADTS0); //Timer0 compare A starts the conversions while ADATE is set
+}
+
+static uint16_t readAnalogValue( void )
+{
+    uint16_t result = 0;
+
+    ADCSRA |= (1<<ADSC); //Start conversion and clear Interrupt flag
+    while((ADCSRA & (1<<ADSC)) != 0) {} //Wait for the conversion to finish
+
+    result = (ADCL) | (ADCH << 8);   //Read the value
+
+    return result;
+}
+
+#ifndef PROBE_ASYNCHRONOUS
+/* The auto trigger starts a conversion on the rising edge of OCF0A, not on its level. ADATE is already set here and
+ * the flag has been high since the last compare match, so nothing starts before it is cleared. The next match sets it
+ * again and starts the conversion on that match, with the ADC prescaler reset, however far into the two cycle period
+ * the clear landed. The sample and hold then closes a fixed number of cycles after a compare match, interrupts in
+ * between don't move it, unlike a conversion started in software. ADIF is cleared first, a stale one would end the
+ * wait before the conversion. */
+static uint16_t readSynchronousValue( void )
+{
+    ADCSRA |= (1<<ADIF);
+    TIFR = (1<<OCF0A);
+    while((ADCSRA & (1<<ADIF)) == 0) {}
+
+    return (ADCL) | (ADCH << 8);
+}
+#endif
+
+uint16_t probeHumidity(uint8_t const conversions)
+{
+    uint16_t result = 0;
+
+    ADMUX = 0x03; //Select PB3 (ADC3) and internal VCC Vref
+
+#ifdef PROBE_ASYNCHRONOUS
+    /* Conversions started in software at any phase of the excitation, the former method, kept for comparisons */
+    ADCSRA |= (1<<ADEN);
+
+    for(uint8_t i = 0; i<conversions; ++i) {
+        result += readAnalogValue();
+    }
+
+    ADCSRA &= ~(1<<ADEN);
+#else
+    ADCSRA |= (1<<ADEN) | (1<<ADATE); //Enable the ADC, started by Timer0. Set before the flag is cleared, see above
+
+    /* Inverting OC0B moves the other half of the excitation under the trigger, an even count ends non inverted */
+    for(uint8_t i = 0; i<conversions; ++i) {
+        TCCR0A ^= (1<<COM0B0);
+        result += readSynchronousValue();
+    }
+
+    TCCR0A &= ~(1<<COM0B0);
+    ADCSRA &= ~((1<<ADEN) | (1<<ADATE)); //Disable the ADC again to save power
+#endif
+
+    return conversions ? (uint32_t)result * PROBE_READING_CONVERSIONS / conversions : 0;
+}
+
+uint16_t probeTemperature( void )
+{
+    uint16_t result = 0;
+
+    ADMUX = 0x0f | (1<<REFS1); //Select Temperature Sensor and internal 1.1V Vref
+    ADCSRA |= (1<<ADEN); //Enable the ADC
+
+    for(unsigned i = 0; i<PROBE_READING_CONVERSIONS; ++i) {
+        result += readAnalogValue();
+    }
+
+    ADCSRA &= ~(1<<ADEN); //Disable the ADC again to save power
+
+    return result;
+}
+
+/* The probe input sits on the excitation signal, so the LSBs of its conversions are noisy enough to seed an id */
+uint32_t probeDeviceId( void )
+{
+    uint32_t id = 0;
+
+    ADMUX = 0x03; //Select PB3 (ADC3) and internal VCC Vref
+    ADCSRA |= (1<<ADEN);
+
+    for(unsigned i = 0; i<48; ++i) {
+        id = (((id << 3) | (id >> 21)) & 0xffffff) ^ readAnalogValue(); //Rotate within the 24 bit, so no bit is lost
+    }
+
+    ADCSRA &= ~(1<<ADEN);
+
+    return id ? id : 1;
+}
@@ -0,0 +1,39 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <stdint.h>
+
+/**
+ * Analog front end. Timer0 excites the probe with a 1 MHz square wave on OC0B, ADC3 sees it on top of the level
+ * the probe settles at. The humidity conversions are started by the Timer0 compare match, so they sample a fixed
+ * phase of the excitation. Every other one runs with OC0B inverted and the sum demodulates to the level of the
+ * probe: the ripple cancels instead of adding to the noise as it does for conversions started in software.
+ */
+enum {
+    PROBE_HUMIDITY_CONVERSIONS = 8, //Synchronous conversions match the precision of 16 started at random
+    PROBE_READING_CONVERSIONS  = 16 //Readings are scaled to the sum of this many conversions, see calibration.h
+};
+
+/**
+ * @brief probeInit starts the excitation and sets up the ADC
+ */
+void probeInit( void );
+
+/**
+ * @brief probeHumidity reads the probe with the given number of conversions, an even number
+ * @return Sum scaled to PROBE_READING_CONVERSIONS conversions
+ */
+uint16_t probeHumidity(uint8_t conversions);
+
+/**
+ * @brief probeTemperature reads the internal temperature sensor
+ * @return Sum of PROBE_READING_CONVERSIONS conversions
+ */
+uint16_t probeTemperature( void );
+
+/**
+ * @brief probeDeviceId builds a random, non zero 24 bit id from the conversion noise
+ */
+uint32_t probeDeviceId( void );
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+
+/**
+ * Frame exchanged between the bridge and the sensors. Every command is answered with the same structure, the
+ * cmdTag is looped back so the master can match the reply.
+ */
+struct TelemetryCommand {
+    uint8_t cmdId;
+    uint8_t cmdTag;
+    uint16_t parameter;
+};
+
+enum TelemetryCommandId {
+    telemetryPing               = 0,  //Loops back the data
+    telemetryId                 = 1,  //Firmware version and feature bits
+    telemetryHumidity           = 2,  //Moisture in 0.01%
+    telemetryTemperature        = 3,  //Temperature in 0.01 degree Celsius
+    telemetrySetAddress         = 4,  //parameter = old address << 8 | new address
+    telemetryRawHumidity        = 5,
+    telemetryRawTemperature     = 6,
+    telemetryHumidityOffset     = 7,  //Staged until telemetryCommitCalibration
+    telemetryHumidityGain       = 8,
+    telemetryTemperatureOffset  = 9,
+    telemetryTemperatureGain    = 10,
+    telemetryCommitCalibration  = 11,
+    telemetryEnumerationStart   = 12, //General call only, never answered
+    telemetryEnumerationSlot    = 13, //General call, the nodes in the slot answer on TELEMETRY_PROBE_ADDRESS
+    telemetryEnumerationAssign  = 14, //General call, cmdTag = new address, parameter = low 16 bit of the node id
+    telemetryAlertLow           = 15, //Moisture in 0.01% below which the node alerts, stored, see alert.h
+    telemetryAlertHigh          = 16, //Moisture in 0.01% above which the node alerts, stored
+    telemetryAlertQuery         = 17, //General call, parameter = first << 8 | last address. Nodes in the range with
+                                      //an alert answer on TELEMETRY_PROBE_ADDRESS, parameter = their address
+    telemetryAlertRead          = 18  //Latest moisture sampled in the background, releases the alert line
+};
+
+enum {
+    TELEMETRY_GENERAL_CALL_ADDRESS = 0,
+    TELEMETRY_PROBE_ADDRESS        = 0x7f, //Reserved for enumeration, never assigned to a node
+
+    TELEMETRY_ENUMERATION_SLOTS    = 0x0fff, //telemetryEnumerationStart parameter bits
+    TELEMETRY_ENUMERATION_ALL      = 0x4000, //Configured nodes take part as well
+    TELEMETRY_ENUMERATION_NEW      = 0x8000, //First round, every node decides again whether it takes part
+
+    TELEMETRY_MAX_REPLY_FRAME      = 2 + 2 * (sizeof(struct TelemetryCommand) + 2) //Flags plus worst case escaping
+};
+
+#endif
@@ -1,35 +1,215 @@
 #include "settings.h"
+#include "alert.h"
 #include "crc16.h"
 
+#include <avr/io.h>
+#include <avr/interrupt.h>
 #include <avr/eeprom.h>
-#include <stddef.h> //For NULL definition
+#include <stddef.h> //For NULL and offsetof
 #include <string.h>
 
+/*
+ * The settings are stored as an append-only journal of records spread over the whole EEPROM.
+ * Every save goes into the next slot, so the cells wear evenly, and the record with the newest
+ * valid sequence number wins on load. A record that got torn by a reset while being written
+ * simply fails its CRC, so the previous one is used instead.
+ */
 struct EepromSettings {
+    uint16_t sequence; //Increments with every saved record, compared with wrap around
     uint16_t version;
     struct Settings settings;
     uint16_t crc; //Keep the CRC always at the END. The code expects it to be there!
 };
 
-static struct EepromSettings eepromSettings EEMEM;
+/* Layout written by the firmware before the journal existed. Only read to migrate old devices. */
+struct LegacySettings {
+    uint16_t version;
+    uint8_t address;
+    uint16_t crc;
+};
+
+/* Journal records of versions 2 to 4, before the alert thresholds. Their slots are spaced by their own size. */
+struct EepromSettings2 {
+    uint16_t sequence;
+    uint16_t version;
+    uint8_t address;
+    uint16_t crc;
+};
+
+/* Version 3 added the calibration */
+struct EepromSettings3 {
+    uint16_t sequence;
+    uint16_t version;
+    uint8_t address;
+    struct Calibration humidity;
+    struct Calibration temperature;
+    uint16_t crc;
+};
+
+/* Version 4 added the configured flag and the enumeration id */
+struct EepromSettings4 {
+    uint16_t sequence;
+    uint16_t version;
+    uint8_t address;
+    uint8_t configured;
+    uint32_t id;
+    struct Calibration humidity;
+    struct Calibration temperature;
+    uint16_t crc;
+};
+
+enum {
+    LEGACY_SETTINGS_VERSION = 1,
+    LEGACY_DEFAULT_ADDRESS = 1, //First boot default before the configured flag
+    journalSlots = (E2END + 1) / sizeof(struct EepromSettings)
+};
+
+static struct EepromSettings eepromJournal[journalSlots] EEMEM;
 static struct EepromSettings ramSettings;
 
+static struct EepromSettings writeRecord_; //Snapshot the EEPROM ISR is currently writing
+static volatile uint8_t writeIndex_;       //Next byte of the snapshot to program
+static volatile bool writePending_;        //Settings were saved again while a write was running
+static uint8_t writeSlot_;
+static uint8_t nextSlot_;
+
 static uint16_t getRamCrc_( void )
 {
     return computeCrc((uint8_t const*)&ramSettings, sizeof (struct EepromSettings) - sizeof (ramSettings.crc));
 }
 
+static bool isNewer_(uint16_t const sequence, uint16_t const reference)
+{
+    return (int16_t)(sequence - reference) > 0;
+}
+
+static bool migrateLegacySettings_( void )
+{
+    struct LegacySettings legacy;
+
+    eeprom_read_block(&legacy, (void const*)0, sizeof(legacy)); //The old block was the only EEMEM variable
+
+    bool const valid = legacy.version == LEGACY_SETTINGS_VERSION &&
+                       computeCrc((uint8_t const*)&legacy, sizeof(legacy) - sizeof(legacy.crc)) == legacy.crc;
+
+    if(valid) {
+        struct Settings * const settings = newSettings();
+
+        settings->address = legacy.address;
+        settings->configured = legacy.address != LEGACY_DEFAULT_ADDRESS;
+    }
+
+    return valid;
+}
+
+/* Copies the newest valid record of an old version to record. Its sequence is kept, so the journal carries on
+ * counting from it. */
+static bool findRecord_(uint16_t const version, void * const record, uint8_t const size, uint8_t const crcOffset)
+{
+    struct EepromSettings4 candidate; //The largest of them, all start with the sequence and the version
+    bool valid = false;
+
+    for(uint8_t slot = 0; slot < (E2END + 1) / size; ++slot) {
+        uint16_t crc;
+
+        eeprom_read_block(&candidate, (uint8_t const*)eepromJournal + slot * size, size);
+        memcpy(&crc, (uint8_t const*)&candidate + crcOffset, sizeof(crc));
+
+        if(candidate.version != version || computeCrc((uint8_t const*)&candidate, crcOffset) != crc ||
+           (valid && !isNewer_(candidate.sequence, ramSettings.sequence))) {
+            continue;
+        }
+
+        ramSettings.sequence = candidate.sequence;
+        memcpy(record, &candidate, size);
+        valid = true;
+    }
+
+    return valid;
+}
+
+static bool migrateVersion4_( void )
+{
+    struct EepromSettings4 record;
+
+    if(!findRecord_(4, &record, sizeof(record), offsetof(struct EepromSettings4, crc))) {
+        return false;
+    }
+
+    struct Settings * const settings = newSettings();
+
+    settings->address = record.address;
+    settings->configured = record.configured;
+    settings->id = record.id;
+    settings->humidity = record.humidity;
+    settings->temperature = record.temperature;
+
+    return true;
+}
+
+static bool migrateVersion3_( void )
+{
+    struct EepromSettings3 record;
+
+    if(!findRecord_(3, &record, sizeof(record), offsetof(struct EepromSettings3, crc))) {
+        return false;
+    }
+
+    struct Settings * const settings = newSettings();
+
+    settings->address = record.address;
+    settings->configured = record.address != LEGACY_DEFAULT_ADDRESS;
+    settings->humidity = record.humidity;
+    settings->temperature = record.temperature;
+
+    return true;
+}
+
+/* Uncalibrated, the calibration stays at offset 0 and unity gain */
+static bool migrateVersion2_( void )
+{
+    struct EepromSettings2 record;
+
+    if(!findRecord_(2, &record, sizeof(record), offsetof(struct EepromSettings2, crc))) {
+        return false;
+    }
+
+    struct Settings * const settings = newSettings();
+
+    settings->address = record.address;
+    settings->configured = record.address != LEGACY_DEFAULT_ADDRESS;
+
+    return true;
+}
+
 struct Settings * loadSettings( void )
 {
     struct Settings  * settings = NULL; //In case of Error we return a NULL (default)
+    struct EepromSettings candidate;
 
-    eeprom_read_block(&ramSettings, &eepromSettings, sizeof(struct EepromSettings)); //Load the settings from the EEPROM
-
-    if( getRamCrc_() == ramSettings.crc && //Check the CRC (CRC is at the end ==> if correct
-            SETTINGS_VERSION == ramSettings.version //the CRC will always be 0 over the complete block) and the Version
-            )
+    for(uint8_t slot = 0; slot < journalSlots; ++slot)
     {
-        settings = &ramSettings.settings;  //If CRC is OK and Version is OK ... return the Settings
+        /* Only the sequence is read for records that can't win, that keeps the startup scan short */
+        uint16_t const sequence = eeprom_read_word(&eepromJournal[slot].sequence);
+
+        if(settings && !isNewer_(sequence, ramSettings.sequence)) {
+            continue;
+        }
+
+        eeprom_read_block(&candidate, &eepromJournal[slot], sizeof(struct EepromSettings));
+
+        if(computeCrc((uint8_t const*)&candidate, sizeof (struct EepromSettings) - sizeof (candidate.crc)) == candidate.crc &&
+           SETTINGS_VERSION == candidate.version)
+        {
+            memcpy(&ramSettings, &candidate, sizeof(struct EepromSettings));
+            nextSlot_ = (slot + 1) % journalSlots;
+            settings = &ramSettings.settings;
+        }
+    }
+
+    /* A device updated more than once may hold records of several versions, the newest version wins */
+    if(!settings && (migrateVersion4_() || migrateVersion3_() || migrateVersion2_() || migrateLegacySettings_())) {
+        settings = &ramSettings.settings;
     }
 
     return settings;
@@ -37,15 +217,65 @@ struct Settings * loadSettings( void )
 
 struct Settings * newSettings( void )
 {
+    uint16_t const sequence = ramSettings.sequence;         //Keep counting, older records may still be in the journal
+
     memset(&ramSettings,0, sizeof (struct EepromSettings)); //Clearout the Settings
     ramSettings.version = SETTINGS_VERSION;                 //Set the Version correct
+    ramSettings.sequence = sequence;
+    calibrationReset(&ramSettings.settings.humidity);
+    calibrationReset(&ramSettings.settings.temperature);
+    ramSettings.settings.alertLow = ALERT_OFF_LOW;
+    ramSettings.settings.alertHigh = ALERT_OFF_HIGH;
 
     return &ramSettings.settings; //Let the user fill in the rest
 }
 
+static void startWrite_( void )
+{
+    /* If the main loop is changing the settings right now the snapshot fails its CRC. That is fine,
+     * the following saveSettings() will flag another write with the consistent data. */
+    memcpy(&writeRecord_, &ramSettings, sizeof (struct EepromSettings));
+    writePending_ = false;
+    writeIndex_ = 0;
+    writeSlot_ = nextSlot_;
+    nextSlot_ = (nextSlot_ + 1) % journalSlots;
+
+    EECR |= (1<<EERIE); //The ready interrupt fires right away if the EEPROM is idle
+}
 
 void saveSettings( void )
 {
+    ++ramSettings.sequence;
     ramSettings.crc = getRamCrc_();
-    eeprom_update_block(&ramSettings, &eepromSettings, sizeof (struct EepromSettings)); //Save !
+
+    uint8_t const sreg = SREG;
+    cli();
+
+    if(EECR & (1<<EERIE)) {
+        writePending_ = true; //Coalesce with the running write, the ISR starts the next record
+    } else {
+        startWrite_();
+    }
+
+    SREG = sreg;
+}
+
+bool settingsSaving( void )
+{
+    return (EECR & (1<<EERIE)) != 0;
+}
+
+ISR(EE_RDY_vect)
+{
+    if(writeIndex_ < sizeof (struct EepromSettings)) {
+        EEAR = (uint16_t)(uintptr_t)&eepromJournal[writeSlot_] + writeIndex_;
+        EEDR = ((uint8_t const*)&writeRecord_)[writeIndex_];
+        EECR = (1<<EERIE) | (1<<EEMPE); //Atomic erase and write
+        EECR |= (1<<EEPE);
+        ++writeIndex_;
+    } else if(writePending_) {
+        startWrite_();
+    } else {
+        EECR &= ~(1<<EERIE); //Record complete, nothing more to do
+    }
 }
@@ -2,13 +2,22 @@
 #define SETTINGS_H
 
 #include <stdint.h>
+#include <stdbool.h>
+
+#include "calibration.h"
 
 enum {
-    SETTINGS_VERSION = 1
+    SETTINGS_VERSION = 5
 };
 
 struct Settings {
     uint8_t address;
+    uint8_t configured;    //Address was assigned by the master, not the first boot default
+    uint32_t id;           //Random 24 bit id used for the address enumeration, 0 if not generated yet
+    struct Calibration humidity;
+    struct Calibration temperature;
+    uint16_t alertLow;     //Moisture thresholds in 0.01%, see alert.h
+    uint16_t alertHigh;
 };
 
 
@@ -20,17 +29,24 @@ struct Settings * loadSettings( void );
 
 
 /**
- * @brief newSettings will reset the settings
+ * @brief newSettings will reset the settings, the calibration is set to offset 0 and unity gain, the alert is off
  * @return a pointer to the erased settings structure is returned
  */
 struct Settings * newSettings( void );
 
 /**
- * @brief saveSettings will save the settings to the EEPROM. This may take a while.
+ * @brief saveSettings will append the settings to the EEPROM journal. Returns right away.
  *
  * This function will save the settings to the EEPROM. The settings need to be filled into the pointer returned by the
- * load / new Settings functions.
+ * load / new Settings functions. The record is written in the background by the EEPROM ready interrupt, so interrupts
+ * need to be enabled for it to complete. Saving again while a write is running queues one more record.
  */
 void saveSettings( void );
 
+/**
+ * @brief settingsSaving tells if a record is still being written to the EEPROM
+ * @return True - Write in progress
+ */
+bool settingsSaving( void );
+
 #endif
@@ -0,0 +1,29 @@
+/*
+ * Firmware for the ISR timing analysis, host/isrTiming.c runs it under simavr. It is the TWI interface of the sensor
+ * with a main loop that keeps the send buffer topped up with the byte the analysis left in GPIOR0, 0 leaves it empty.
+ * Nothing drains the receive buffer, so a long write also runs the NACK path once it is full.
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "twiInterface.h"
+#include "protocol.h"
+
+enum {
+    harnessAddress = 0x10 //Has to match host/isrTiming.c
+};
+
+int main( void )
+{
+    uint8_t const fill = GPIOR0;
+
+    twiInitialize(harnessAddress);
+    twiSetProbeAddress(TELEMETRY_PROBE_ADDRESS); //The address compare is longest while an enumeration runs
+    sei();
+
+    for(;;) {
+        if(fill) {
+            twiSendChar(fill);
+        }
+    }
+}
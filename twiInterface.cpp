@@ -1,11 +1,14 @@
+#include "core/ringBuffer.hpp"
+
+extern "C" {
 #include "twiInterface.h"
+}
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <avr/sleep.h>
 #include <util/twi.h>
 #include <stdint.h>
-#include <string.h>
 
 #define SDA DDB0
 #define SCL DDB2
@@ -28,17 +31,14 @@ enum TwiStatus {
     twiRequestAck,
 };
 
-struct Buffer{
-    uint8_t buffer[maxBufferSize];
-    unsigned read;
-    unsigned write;
-};
-
-static struct Buffer rxBuffer_;
-static struct Buffer txBuffer_;
+/* The main loop writes txBuffer_ and reads rxBuffer_, the USI interrupt the other way round */
+static core::RingBuffer<maxBufferSize> rxBuffer_;
+static core::RingBuffer<maxBufferSize> txBuffer_;
 
 static volatile enum TwiStatus internalState_;
 static uint8_t ownAddress_;
+static uint8_t probeAddress_;
+static bool replying_; //The reply was queued before the read started, a reply queued later waits for the next read
 
 static void usiSetUsIsr(unsigned const bits)
 {
@@ -110,38 +110,20 @@ static void usiSetToReadData( void )
     usiSetUsIsr(0xf);
 }
 
-static unsigned next(unsigned i)
-{
-    return (i + 1) % maxBufferSize;
-}
-
 bool twiSendChar(char const c)
 {
-    bool result = false;
-
-    unsigned const nextWrite = next(txBuffer_.write);
-
-    if( nextWrite != txBuffer_.read) {
-        txBuffer_.buffer[txBuffer_.write] = c;
-        txBuffer_.write = nextWrite;
-        result = true;
-    }
-
-    return result;
+    return txBuffer_.push(c);
 }
 
 bool twiCharAvailable( void )
 {
-    return rxBuffer_.write != rxBuffer_.read;
+    return !rxBuffer_.empty();
 }
 
 char twiReceiveChar( void )
 {
-    char result = 0;
-    if(twiCharAvailable()) {
-        result = rxBuffer_.buffer[rxBuffer_.read];
-        rxBuffer_.read = next(rxBuffer_.read);
-    }
+    uint8_t result = 0;
+    rxBuffer_.pop(result);
 
     return result;
 }
@@ -150,9 +132,10 @@ void twiInitialize(uint8_t const address)
 {
     internalState_ = twiWaitForStart;
     ownAddress_ = address;
+    probeAddress_ = 0;
 
-    memset(&rxBuffer_,0,sizeof(rxBuffer_));
-    memset(&txBuffer_,0,sizeof(txBuffer_));
+    rxBuffer_.clear();
+    txBuffer_.clear();
 
     PORTB |= (1<<SCL) | (1<<SDA); //Set SCL and SDA to high
     DDRB  |= (1<<SCL);            //Set SCL to Output
@@ -164,6 +147,24 @@ void twiInitialize(uint8_t const address)
 
 }
 
+void twiSetAddress(uint8_t const address)
+{
+    ownAddress_ = address;
+}
+
+void twiSetProbeAddress(uint8_t const address)
+{
+    probeAddress_ = address;
+}
+
+void twiClearSendBuffer( void )
+{
+    uint8_t const sreg = SREG;
+    cli(); //The reader's side of the buffer, the interrupt may not read meanwhile
+    txBuffer_.clear();
+    SREG = sreg;
+}
+
 ISR(USI_START_vect)
 {
     internalState_ = twiWaitForAddress; //We received the START, now wait for the address
@@ -195,10 +196,13 @@ ISR(USI_OVF_vect)
     case twiWaitForAddress:
     {
         //Check if we are addressed at all ...
-        if((dataByte == 0) || ((dataByte >> 1) == ownAddress_))
+        uint8_t const address = dataByte >> 1;
+
+        if((dataByte == 0) || (address == ownAddress_) || (probeAddress_ && address == probeAddress_))
         {
             //The address is our address ... do we have to send or receive?
             internalState_ = dataByte & 1 ? twiSendData : twiSendAck;
+            replying_ = !txBuffer_.empty();
             usiPrepareAck(); //Acknowledge the reception of the Address
         } else {
             usiSetToStartCondition(); //We are not addressed ... so sleep again ...
@@ -217,12 +221,9 @@ ISR(USI_OVF_vect)
     case twiWaitForData:
     {
         internalState_ = twiSendAck;
-        unsigned const nextWrite = next(rxBuffer_.write);
 
-        if(nextWrite != rxBuffer_.read)
+        if(rxBuffer_.push(dataByte))
         {
-            rxBuffer_.buffer[rxBuffer_.write] = dataByte;
-            rxBuffer_.write = nextWrite;
             usiPrepareAck();
         } else {
             usiPrepareNack();
@@ -242,11 +243,12 @@ ISR(USI_OVF_vect)
     } //fall through
     case twiSendData:
     {
-        //Do we have data ...
-        if(txBuffer_.read != txBuffer_.write)
+        //Do we have data ... a frame starting halfway through the read would reach the master cut in two
+        uint8_t data;
+
+        if(replying_ && txBuffer_.pop(data))
         {
-            USIDR = txBuffer_.buffer[txBuffer_.read];
-            txBuffer_.read = next(txBuffer_.read);
+            USIDR = data;
         } else {
             USIDR = 0;
 /*            internalState_ = twiWaitForStart;
@@ -27,6 +27,21 @@ char twiReceiveChar( void );
  */
 void twiInitialize(uint8_t);
 
+/**
+ * @brief twiSetAddress changes the own address, the change takes effect with the next START
+ */
+void twiSetAddress(uint8_t);
+
+/**
+ * @brief twiSetProbeAddress sets an additional address the interface answers on, 0 disables it
+ */
+void twiSetProbeAddress(uint8_t);
+
+/**
+ * @brief twiClearSendBuffer drops all characters not yet read by the master
+ */
+void twiClearSendBuffer( void );
+
 /**
  * @brief twiSleep will enter IDLE, if USI allows it right now
  */
@@ -0,0 +1,156 @@
+#include "alertBus.h"
+#include "alertLine.h"
+#include "clock.h"
+#include "generalCall.h"
+#include "sensorRequest.h"
+#include "twiMaster.h"
+
+#include <stddef.h>
+
+enum AlertState {
+    alertIdle,
+    alertQuerying,      //The query is on the bus
+    alertDecoding,      //The nodes decode the query until probeAt_
+    alertProbing,       //The probe is on the bus
+    alertReading        //telemetryAlertRead is on the bus
+};
+
+static uint8_t state_;         //enum AlertState
+static bool probing_;          //The query on the bus is followed by a probe
+static uint16_t probeAt_;      //Low 16 bit of clockMillis()
+static uint16_t holdoffUntil_;
+static struct GeneralCall call_;
+static struct SensorRequest request_;
+static struct AlertSearch search_;
+static struct AlertStatistics statistics_; //Of all segments
+
+static bool reached_(uint16_t const millis)
+{
+    return (int16_t)((uint16_t)clockMillis() - millis) >= 0;
+}
+
+static void query_( void )
+{
+    struct TelemetryCommand query;
+
+    probing_ = alertSearchQuery(&search_, &query);
+    state_ = alertQuerying;
+    twiMasterSubmit(generalCallBroadcast(&call_, &query));
+}
+
+/* The line is shared, every segment is searched */
+static void startSegment_(uint8_t const bus)
+{
+    generalCallInit(&call_, bus);
+    alertSearchStart(&search_);
+    query_();
+}
+
+/* Adds up the counts of the segment, returns true once the last one is done */
+static bool endSegment_( void )
+{
+    statistics_.found += search_.statistics.found;
+    statistics_.failed += search_.statistics.failed;
+    statistics_.queries += search_.statistics.queries;
+    statistics_.collisions += search_.statistics.collisions;
+
+    if(call_.job.bus + 1 < twiBuses) {
+        startSegment_(call_.job.bus + 1);
+        return false;
+    }
+
+    state_ = alertIdle;
+    holdoffUntil_ = (uint16_t)clockMillis() + ALERT_BUS_HOLDOFF_MS;
+    return true;
+}
+
+bool alertBusPending( void )
+{
+    return state_ == alertIdle && alertLineAsserted() && reached_(holdoffUntil_);
+}
+
+bool alertBusBusy( void )
+{
+    return state_ != alertIdle;
+}
+
+bool alertBusPoll(void (* const alerted)(uint8_t address, struct TelemetryCommand const * reply),
+                  struct AlertStatistics * const statistics)
+{
+    switch(state_) {
+    case alertIdle:
+        if(alertBusPending()) {
+            statistics_.found = 0;
+            statistics_.failed = 0;
+            statistics_.queries = 0;
+            statistics_.collisions = 0;
+            startSegment_(twiBusHardware);
+        }
+        return false;
+
+    case alertQuerying:
+        if(!generalCallDone(&call_)) {
+            return false;
+        }
+
+        if(!probing_) {
+            if(!endSegment_()) {
+                return false;
+            }
+
+            *statistics = statistics_;
+            return true;
+        }
+
+        probeAt_ = (uint16_t)clockMillis() + GENERAL_CALL_DECODE_MS;
+        state_ = alertDecoding;
+        return false;
+
+    case alertDecoding:
+        if(reached_(probeAt_)) {
+            state_ = alertProbing;
+            twiMasterSubmit(generalCallProbe(&call_));
+        }
+        return false;
+
+    case alertProbing:
+    {
+        struct TelemetryCommand reply;
+        uint8_t address;
+
+        if(!generalCallDone(&call_)) {
+            return false;
+        }
+
+        address = alertSearchProbed(&search_, generalCallProbeResult(&call_, &reply), &reply);
+
+        if(address) {
+            /* A node that doesn't answer keeps its alert and is found again after the holdoff */
+            struct TelemetryCommand const command = { telemetryAlertRead, address, 0 };
+
+            state_ = alertReading;
+            sensorRequestStart(&request_, address, &command);
+        } else {
+            query_();
+        }
+        return false;
+    }
+
+    case alertReading:
+        if(!sensorRequestDone(&request_)) {
+            return false;
+        }
+
+        alertSearchRead(&search_, request_.status == sensorRequestOk);
+        if(request_.status == sensorRequestOk && alerted) {
+            alerted(request_.job.address, &request_.reply);
+        }
+
+        query_();
+        return false;
+
+    default:
+        state_ = alertIdle;
+        return false;
+    }
+}
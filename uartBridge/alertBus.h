@@ -0,0 +1,32 @@
+#ifndef ALERT_BUS_H
+#define ALERT_BUS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "alertMaster.h"
+
+enum {
+    ALERT_BUS_HOLDOFF_MS = 250 //Between two runs, a node that can't be read doesn't take the bus over
+};
+
+/**
+ * @brief alertBusPending tells if the alert line is low and the holdoff after the last run is over
+ */
+bool alertBusPending( void );
+
+/**
+ * @brief alertBusBusy returns true while a run has the bus, nothing else may start a transaction then
+ */
+bool alertBusBusy( void );
+
+/**
+ * @brief alertBusPoll moves the search for the nodes with an alert on, over every bus segment. Call it from the main
+ * loop once the bus is free, a run starts when alertBusPending() and keeps the bus until it is done.
+ * @param alerted is called with the telemetryAlertRead reply of every node read, may be NULL
+ * @return True when a run ended, its counts are in statistics
+ */
+bool alertBusPoll(void (*alerted)(uint8_t address, struct TelemetryCommand const * reply),
+                  struct AlertStatistics * statistics);
+
+#endif
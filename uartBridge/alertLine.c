@@ -0,0 +1,14 @@
+#include "alertLine.h"
+
+#include <avr/io.h>
+
+void alertLineInit( void )
+{
+    DDRD &= ~(1<<PD2);
+    PORTD |= (1<<PD2);
+}
+
+bool alertLineAsserted( void )
+{
+    return (PIND & (1<<PD2)) == 0;
+}
@@ -0,0 +1,15 @@
+#ifndef ALERT_LINE_H
+#define ALERT_LINE_H
+
+#include <stdbool.h>
+
+/**
+ * Alert line of the sensors on PD2, open drain and low while any sensor has an alert, see alert.h. Shared by the
+ * sensors of all bus segments. The internal pull up holds it high, a long line wants an external resistor as well.
+ */
+
+void alertLineInit( void );
+
+bool alertLineAsserted( void );
+
+#endif
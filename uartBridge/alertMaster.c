@@ -0,0 +1,76 @@
+#include "alertMaster.h"
+
+#include <string.h>
+
+void alertSearchStart(struct AlertSearch * const search)
+{
+    memset(search, 0, sizeof(*search));
+
+    search->firsts[0] = 1;
+    search->lasts[0] = TELEMETRY_PROBE_ADDRESS - 1;
+    search->ranges = 1;
+}
+
+bool alertSearchQuery(struct AlertSearch * const search, struct TelemetryCommand * const query)
+{
+    bool const probe = search->ranges > 0;
+
+    query->cmdId = telemetryAlertQuery;
+    query->cmdTag = search->statistics.queries++;
+
+    if(probe) {
+        uint8_t const top = search->ranges - 1;
+
+        query->parameter = ((uint16_t)search->firsts[top] << 8) | search->lasts[top];
+    } else {
+        query->parameter = 0; //No node has address 0, all stop answering on the probe address
+        search->closed = true;
+    }
+
+    return probe;
+}
+
+uint8_t alertSearchProbed(struct AlertSearch * const search, enum EnumerationProbe const result,
+                          struct TelemetryCommand const * const reply)
+{
+    uint8_t const first = search->firsts[--search->ranges];
+    uint8_t const last = search->lasts[search->ranges];
+
+    switch(result) {
+    case enumerationFound:
+        return reply->parameter & 0x7f;
+
+    case enumerationCollision:
+    {
+        uint8_t const middle = first + (last - first) / 2;
+
+        ++search->statistics.collisions;
+
+        /* The lower half goes on top, so the nodes are read in the order of their addresses */
+        if(first < last && search->ranges + 2 <= ALERT_MAX_RANGES) {
+            search->firsts[search->ranges] = middle + 1;
+            search->lasts[search->ranges++] = last;
+            search->firsts[search->ranges] = first;
+            search->lasts[search->ranges++] = middle;
+        }
+        return 0;
+    }
+
+    default:
+        return 0;
+    }
+}
+
+void alertSearchRead(struct AlertSearch * const search, bool const read)
+{
+    if(read) {
+        ++search->statistics.found;
+    } else {
+        ++search->statistics.failed;
+    }
+}
+
+bool alertSearchDone(struct AlertSearch const * const search)
+{
+    return search->closed;
+}
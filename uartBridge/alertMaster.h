@@ -0,0 +1,63 @@
+#ifndef ALERT_MASTER_H
+#define ALERT_MASTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "enumerationMaster.h"
+
+/**
+ * Master side of the threshold alert, see alert.h of the sensor. The nodes pulling the alert line are found with
+ * telemetryAlertQuery over the address range: a range with a single node answering gives its address, a collision
+ * splits it in halves, so k nodes out of 126 take about k * 7 queries. Every node found is read, which releases its
+ * part of the line. The search only decides, the caller runs the bus between the steps, so the same procedure
+ * runs on the bridge and in the host simulation.
+ */
+enum {
+    ALERT_MAX_RANGES = 8 //Depth first, the 126 addresses halve down to one in 7 splits
+};
+
+struct AlertStatistics {
+    uint8_t found;
+    uint8_t failed;     //Found but not read, the node keeps its alert
+    uint8_t queries;
+    uint8_t collisions;
+};
+
+struct AlertSearch {
+    uint8_t firsts[ALERT_MAX_RANGES];
+    uint8_t lasts[ALERT_MAX_RANGES];
+    uint8_t ranges;     //Still to query, the top one next
+    bool closed;        //The closing query went out
+    struct AlertStatistics statistics;
+};
+
+/**
+ * @brief alertSearchStart begins a search over all addresses
+ */
+void alertSearchStart(struct AlertSearch * search);
+
+/**
+ * @brief alertSearchQuery gives the next telemetryAlertQuery to broadcast
+ * @return true if the nodes' answer is to be probed, false for the closing query after which no node answers
+ */
+bool alertSearchQuery(struct AlertSearch * search, struct TelemetryCommand * query);
+
+/**
+ * @brief alertSearchProbed takes the result of the probe after a query
+ * @return The address to send telemetryAlertRead to, 0 if there is none
+ */
+uint8_t alertSearchProbed(struct AlertSearch * search, enum EnumerationProbe result,
+                          struct TelemetryCommand const * reply);
+
+/**
+ * @brief alertSearchRead counts the outcome of the read of the address alertSearchProbed gave
+ */
+void alertSearchRead(struct AlertSearch * search, bool read);
+
+/**
+ * @brief alertSearchDone returns true once the closing query went out
+ */
+bool alertSearchDone(struct AlertSearch const * search);
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef BRIDGE_PROTOCOL_H
+#define BRIDGE_PROTOCOL_H
+
+#include <stdint.h>
+
+#include "../protocol.h"
+
+/**
+ * Binary protocol between the host and the bridge. Every message is one HDLC frame (see hdlc.h) on the serial line
+ * that starts with a BridgeHeader. The bridge copies the sequence number of a request into all messages it sends
+ * for it. Multi byte fields are little endian, the structures are laid out without padding on AVR and host alike.
+ */
+enum BridgeOpcode {
+    bridgeOpHello       = 0x00, //BridgeHello both ways
+    bridgeOpTransaction = 0x01, //BridgeTransaction, answered with a BridgeTransactionResult, pipelined
+    bridgeOpEnumerate   = 0x02, //BridgeEnumerate, answered with BridgeAssigned events and a BridgeEnumerateResult
+    bridgeOpAssigned    = 0x03,
+    bridgeOpStatistics  = 0x04, //BridgeHeader, answered with BridgeStatistics
+    bridgeOpSchedule    = 0x05, //BridgeSchedule, echoed once stored
+    bridgeOpRun         = 0x06, //BridgeRun, echoed
+    bridgeOpSample      = 0x07, //BridgeSample, sent by the scheduler whenever a transaction completed, see BridgeReport,
+                                //and for every node read after it pulled the alert line, cmdId telemetryAlertRead
+    bridgeOpCalibrateSpeed = 0x08, //BridgeSpeed with the address, answered with the BridgeSpeed found
+    bridgeOpSpeed       = 0x09, //BridgeSpeed, sets the speed of the address without calibration, echoed
+    bridgeOpReport      = 0x0a, //BridgeReport, sets the report filter of a scheduled command, echoed
+    bridgeOpReportSummary = 0x0b, //BridgeHeader, answered with BridgeReportSummary
+    bridgeOpTrace       = 0x0c, //BridgeHeader, answered with BridgeTraceData, only on a bridge built with BRIDGE_TRACE
+    bridgeOpError       = 0x7f  //BridgeHello carrying a BridgeStatus in version, answer to a request the bridge can't handle
+};
+
+enum BridgeStatus {
+    bridgeStatusOk          = 0,
+    bridgeStatusBusError    = 1, //Sensor did not acknowledge or the bus failed
+    bridgeStatusNotReady    = 2, //Sensor had no reply queued
+    bridgeStatusBadReply    = 3, //Reply broken even after the retries
+    bridgeStatusNoSpeed     = 4, //The sensor did not pass the calibration at any speed
+    bridgeStatusFull        = 5, //No room for another report filter
+    bridgeStatusUnknown     = 0x10,
+    bridgeStatusMalformed   = 0x11
+};
+
+enum {
+    BRIDGE_PROTOCOL_VERSION = 3, //2: enum TwiSpeed starts with twiSpeedDefault, 3: 16 bit BridgeReport deadband
+    BRIDGE_PIPELINE_DEPTH   = 2, //Transactions the bridge accepts before it answers the first
+    BRIDGE_MAX_MESSAGE      = 12, //Largest message in either direction
+    BRIDGE_MAX_FRAME        = 2 + 2 * (BRIDGE_MAX_MESSAGE + 2),
+    BRIDGE_TRACE_CHUNK      = 8
+};
+
+struct BridgeHeader {
+    uint8_t opcode;
+    uint8_t sequence;
+};
+
+struct BridgeHello {
+    struct BridgeHeader header;
+    uint8_t version;
+    uint8_t features; //Reserved, 0
+};
+
+struct BridgeTransaction {
+    struct BridgeHeader header;
+    uint8_t address;   //1 to TELEMETRY_PROBE_ADDRESS - 1, others are answered with bridgeStatusMalformed
+    uint8_t reserved;
+    struct TelemetryCommand command;
+};
+
+struct BridgeTransactionResult {
+    struct BridgeHeader header;
+    uint8_t address;
+    uint8_t status;    //enum BridgeStatus
+    struct TelemetryCommand reply;
+};
+
+struct BridgeEnumerate {
+    struct BridgeHeader header;
+    uint8_t firstAddress;
+    uint8_t all;       //Configured nodes get a new address as well
+    uint16_t slots;
+};
+
+struct BridgeAssigned {
+    struct BridgeHeader header;
+    uint8_t address;
+    uint8_t reserved;
+    uint32_t id;
+};
+
+struct BridgeEnumerateResult {
+    struct BridgeHeader header;
+    uint8_t assigned;
+    uint8_t rounds;
+    uint16_t slots;
+    uint16_t collisions;
+};
+
+struct BridgeStatistics {
+    struct BridgeHeader header;
+    uint16_t hardwareOverruns; //See struct Rs232Statistics
+    uint16_t bufferOverruns;
+    uint16_t framingErrors;
+};
+
+struct BridgeSchedule {
+    struct BridgeHeader header;
+    uint8_t address;
+    uint8_t commands;  //Bit mask of enum TelemetryCommandId, 0 removes the sensor from the schedule
+    uint16_t interval; //In 100 ms, 0 polls as often as the bus allows
+};
+
+struct BridgeRun {
+    struct BridgeHeader header;
+    uint8_t run;       //Stays set over a reset of the bridge
+    uint8_t reserved;
+};
+
+struct BridgeSpeed {
+    struct BridgeHeader header;
+    uint8_t address;
+    uint8_t speed;     //enum TwiSpeed of twiMaster.h
+    uint32_t sclHz;    //Set by the bridge in its answer
+};
+
+/* The sequence of a sample counts up with every sample, a gap shows samples were lost. Readings held back by a
+ * report filter are not sent and take no sequence number. */
+struct BridgeSample {
+    struct BridgeHeader header;
+    uint8_t address;
+    uint8_t status;    //enum BridgeStatus, the reply holds the command sent if it is not ok
+    struct TelemetryCommand reply;
+    uint32_t timestamp; //Milliseconds since the bridge started
+};
+
+/* Samples of the command from address are only sent when the reading moved by more than deadband since the last
+ * one sent, or when heartbeat - 1 readings in a row were held back. Failed transactions are always sent. A
+ * heartbeat of 1 removes the filter. Kept in RAM for up to REPORT_FILTERS commands, see reportFilter.h. */
+struct BridgeReport {
+    struct BridgeHeader header;
+    uint8_t address;
+    uint8_t command;   //enum TelemetryCommandId
+    uint16_t deadband; //In units of the reading
+    uint8_t heartbeat; //0 sends a reading within the deadband never
+    uint8_t reserved;
+};
+
+/* Counts since the bridge started, they wrap */
+struct BridgeReportSummary {
+    struct BridgeHeader header;
+    uint16_t forwarded;  //Samples sent
+    uint16_t held;       //Readings held back
+    uint16_t heartbeats; //Readings within the deadband sent for the heartbeat
+};
+
+/* The next bytes of the bus trace, they are taken from the bridge with the answer. The bytes form a stream of the
+ * records of uartBridge/trace.h, a record can span several chunks. An empty chunk means the trace is read up. */
+struct BridgeTraceData {
+    struct BridgeHeader header;
+    uint8_t length;    //Bytes of data used
+    uint8_t lost;      //Records dropped since the last chunk because the ring was full
+    uint8_t data[BRIDGE_TRACE_CHUNK];
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "busSpeed.h"
+#include "sensorRequest.h"
+#include "twiMaster.h"
+
+#include <avr/eeprom.h>
+
+/* The EEPROM of the ATmega16 has no room for a second table, the segment is a bit of the speed entry. Entries
+ * written before there was a second bus hold the plain speed, so they stay on the hardware bus. The speed is kept
+ * as its step above twiSpeed245Hz, as it was stored before there was a twiSpeedDefault. */
+enum {
+    entrySpeed    = 0x0f,
+    entrySoftware = 0x10,
+    entryErased   = 0xff
+};
+
+/* The calibration in progress, its pings take turns with the other transactions on the bus */
+struct Calibration {
+    struct SensorRequest request;
+    uint8_t address;
+    uint8_t candidate;  //enum TwiSpeed being pinged
+    uint8_t ping;       //Of the candidate
+    uint8_t passed;     //Fastest enum TwiSpeed that passed, twiSpeeds if none did
+    bool busy;          //request is on the bus
+};
+
+static uint8_t eepromSpeeds[TELEMETRY_PROBE_ADDRESS] EEMEM; //Indexed by the address
+static struct Calibration calibration_;
+
+static uint8_t entryOf_(uint8_t const address)
+{
+    return address < TELEMETRY_PROBE_ADDRESS ? eeprom_read_byte(&eepromSpeeds[address]) : entryErased;
+}
+
+static uint8_t speedOfEntry_(uint8_t const entry)
+{
+    uint8_t const speed = twiSpeed245Hz + (entry & entrySpeed);
+
+    return entry != entryErased && speed < twiSpeeds ? speed : twiSpeedDefault;
+}
+
+static uint8_t entryOfSpeed_(uint8_t const speed)
+{
+    return (speed != twiSpeedDefault && speed < twiSpeeds ? speed : twiSpeed245Hz) - twiSpeed245Hz;
+}
+
+uint8_t busSpeedOf(uint8_t const address)
+{
+    return speedOfEntry_(entryOf_(address));
+}
+
+void busSpeedSet(uint8_t const address, uint8_t const speed)
+{
+    uint8_t const entry = entryOf_(address);
+
+    if(address < TELEMETRY_PROBE_ADDRESS) {
+        eeprom_update_byte(&eepromSpeeds[address],
+                           (entry != entryErased ? entry & entrySoftware : 0) | entryOfSpeed_(speed));
+    }
+}
+
+uint8_t busSpeedSlowest(uint8_t const bus)
+{
+    uint8_t slowest = twiSpeeds;
+
+    for(uint8_t address = 1; address < TELEMETRY_PROBE_ADDRESS; ++address) {
+        uint8_t const speed = busSpeedOf(address);
+
+        if(speed != twiSpeedDefault && speed < slowest && busSegmentOf(address) == bus) {
+            slowest = speed;
+        }
+    }
+
+    /* Nothing known on a fresh segment, the first enumeration comes before any calibration */
+    return slowest == twiSpeeds ? twiSpeed245Hz : slowest < twiSpeed100kHz ? slowest : twiSpeed100kHz;
+}
+
+uint8_t busSegmentOf(uint8_t const address)
+{
+    uint8_t const entry = entryOf_(address);
+
+    return twiBuses > 1 && entry != entryErased && (entry & entrySoftware) ? twiBusSoftware : twiBusHardware;
+}
+
+void busSegmentSet(uint8_t const address, uint8_t const bus)
+{
+    uint8_t const entry = entryOf_(address);
+
+    if(address < TELEMETRY_PROBE_ADDRESS) {
+        eeprom_update_byte(&eepromSpeeds[address],
+                           entryOfSpeed_(speedOfEntry_(entry)) | (bus == twiBusSoftware ? entrySoftware : 0));
+    }
+}
+
+void busSpeedCalibrateStart(uint8_t const address)
+{
+    /* At 245 Hz a single ping takes about a second, so the ladder starts one step above and only falls back to it */
+    calibration_.address = address;
+    calibration_.candidate = twiSpeed1kHz;
+    calibration_.ping = 0;
+    calibration_.passed = twiSpeeds;
+    calibration_.busy = false;
+}
+
+/* A speed passes when every ping comes back on the first attempt with its parameter intact. Returns false once the
+ * ladder is done. */
+static bool checkPing_( void )
+{
+    struct SensorRequest const * const request = &calibration_.request;
+    uint8_t const candidate = calibration_.candidate;
+
+    if(request->status == sensorRequestOk && request->attempts == 1 &&
+       request->reply.parameter == request->command.parameter) {
+        if(++calibration_.ping < BUS_SPEED_PINGS) {
+            return true;
+        }
+
+        calibration_.passed = candidate;
+        calibration_.candidate = candidate + 1;
+        calibration_.ping = 0;
+        return candidate != twiSpeed245Hz && calibration_.candidate < twiSpeeds;
+    }
+
+    if(candidate == twiSpeed1kHz) {
+        calibration_.candidate = twiSpeed245Hz;
+        calibration_.ping = 0;
+        return true;
+    }
+
+    return false;
+}
+
+uint8_t busSpeedCalibratePoll(bool const start, uint8_t * const speed)
+{
+    if(calibration_.busy) {
+        if(!sensorRequestDone(&calibration_.request)) {
+            return busSpeedCalibrating;
+        }
+
+        calibration_.busy = false;
+
+        if(!checkPing_()) {
+            bool const passed = calibration_.passed < twiSpeeds;
+
+            *speed = passed ? calibration_.passed : twiSpeed245Hz;
+            busSpeedSet(calibration_.address, *speed);
+            return passed ? busSpeedPassed : busSpeedFailed;
+        }
+    }
+
+    if(start) {
+        uint8_t const i = calibration_.ping;
+        /* Alternating bits and the HDLC flag and escape bytes in the payload */
+        struct TelemetryCommand const ping = { telemetryPing, i, (i & 1) ? 0x7e7f : (0x55aa ^ (i << 8)) };
+
+        calibration_.busy = true;
+        sensorRequestStartAt(&calibration_.request, calibration_.address, calibration_.candidate, &ping);
+    }
+
+    return busSpeedCalibrating;
+}
+
+bool busSpeedCalibrateIdle( void )
+{
+    return !calibration_.busy;
+}
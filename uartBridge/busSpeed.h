@@ -0,0 +1,59 @@
+#ifndef BUS_SPEED_H
+#define BUS_SPEED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * SCL rate and bus segment of every sensor address, see enum TwiSpeed and enum TwiBus. Both are kept in one
+ * EEPROM byte per address, an address that was never calibrated runs at twiSpeedDefault on the hardware bus.
+ */
+enum {
+    BUS_SPEED_PINGS = 8 //Round trips that all need to pass at a speed
+};
+
+enum BusSpeedProgress {
+    busSpeedCalibrating = 0,
+    busSpeedPassed      = 1, //The fastest speed that passed is stored
+    busSpeedFailed      = 2  //No speed passed, twiSpeed245Hz is stored
+};
+
+/**
+ * @brief busSpeedOf returns the enum TwiSpeed stored for address
+ */
+uint8_t busSpeedOf(uint8_t address);
+
+void busSpeedSet(uint8_t address, uint8_t speed);
+
+/**
+ * @brief busSpeedSlowest returns the slowest enum TwiSpeed stored for an address on the bus segment, at most
+ * twiSpeed100kHz, twiSpeed245Hz if there is none. Broadcasts run at it so every node follows them.
+ */
+uint8_t busSpeedSlowest(uint8_t bus);
+
+/**
+ * @brief busSegmentOf returns the enum TwiBus the address was enumerated on
+ */
+uint8_t busSegmentOf(uint8_t address);
+
+void busSegmentSet(uint8_t address, uint8_t bus);
+
+/**
+ * @brief busSpeedCalibrateStart begins to ping the sensor at increasing speeds, one calibration runs at a time
+ */
+void busSpeedCalibrateStart(uint8_t address);
+
+/**
+ * @brief busSpeedCalibratePoll checks the running ping and sends the next one, call it from the main loop
+ * @param start false only completes the running ping, so the bus can be shared with other transactions
+ * @param speed Receives the stored enum TwiSpeed once the calibration is done
+ * @return enum BusSpeedProgress
+ */
+uint8_t busSpeedCalibratePoll(bool start, uint8_t * speed);
+
+/**
+ * @brief busSpeedCalibrateIdle returns true when the calibration has no ping on the bus
+ */
+bool busSpeedCalibrateIdle( void );
+
+#endif
@@ -0,0 +1,35 @@
+#include "clock.h"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+enum {
+    clockPrescaler = 64,
+    clockCompare = F_CPU / clockPrescaler / 1000 - 1
+};
+
+static volatile uint32_t millis_;
+
+void clockInit( void )
+{
+    millis_ = 0;
+
+    OCR0  = clockCompare;
+    TCCR0 = (1<<WGM01) | (1<<CS01) | (1<<CS00); //CTC mode, prescaler 64
+    TIMSK |= (1<<OCIE0);
+}
+
+uint32_t clockMillis( void )
+{
+    uint8_t const sreg = SREG;
+    cli();
+    uint32_t const result = millis_;
+    SREG = sreg;
+
+    return result;
+}
+
+ISR(TIMER0_COMP_vect)
+{
+    ++millis_;
+}
@@ -0,0 +1,16 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+/**
+ * @brief clockInit starts the millisecond tick on Timer0
+ */
+void clockInit( void );
+
+/**
+ * @brief clockMillis returns the milliseconds since clockInit
+ */
+uint32_t clockMillis( void );
+
+#endif
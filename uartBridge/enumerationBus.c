@@ -0,0 +1,62 @@
+#include "enumerationBus.h"
+#include "busSpeed.h"
+#include "generalCall.h"
+#include "twiMaster.h"
+
+#include <util/delay.h>
+
+#include <stddef.h>
+
+static struct GeneralCall call_;                       //On the segment being enumerated
+static void (*assigned_)(uint8_t address, uint32_t id); //Of the caller
+
+/* The enumeration owns the bus until it is done, it waits for every call */
+static bool broadcast_(struct TelemetryCommand const * command)
+{
+    return twiMasterTransfer(generalCallBroadcast(&call_, command)) == twiJobOk;
+}
+
+static enum EnumerationProbe probe_(struct TelemetryCommand * reply)
+{
+    _delay_ms(GENERAL_CALL_DECODE_MS);
+    twiMasterTransfer(generalCallProbe(&call_));
+
+    return generalCallProbeResult(&call_, reply);
+}
+
+/* Sensor requests find the segment of an address in the EEPROM, next to its speed */
+static void recordSegment_(uint8_t const address, uint32_t const id)
+{
+    busSegmentSet(address, call_.job.bus);
+
+    if(assigned_) {
+        assigned_(address, id);
+    }
+}
+
+void enumerationBusRun(uint8_t firstAddress, uint16_t const slots, bool const all,
+                       void (* const assigned)(uint8_t address, uint32_t id), struct EnumerationStatistics * const statistics)
+{
+    struct EnumerationBus const bus = { broadcast_, probe_, recordSegment_ };
+
+    assigned_ = assigned;
+    statistics->assigned = 0;
+    statistics->rounds = 0;
+    statistics->slots = 0;
+    statistics->collisions = 0;
+
+    /* One segment after the other, the addresses continue where the last segment stopped */
+    for(uint8_t segmentBus = twiBusHardware; segmentBus < twiBuses && firstAddress < TELEMETRY_PROBE_ADDRESS;
+        ++segmentBus) {
+        struct EnumerationStatistics segment;
+
+        generalCallInit(&call_, segmentBus);
+        enumerationRun(&bus, firstAddress, slots, all, &segment);
+
+        firstAddress += segment.assigned;
+        statistics->assigned += segment.assigned;
+        statistics->rounds += segment.rounds;
+        statistics->slots += segment.slots;
+        statistics->collisions += segment.collisions;
+    }
+}
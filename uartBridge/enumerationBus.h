@@ -0,0 +1,17 @@
+#ifndef ENUMERATION_BUS_H
+#define ENUMERATION_BUS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "enumerationMaster.h"
+
+/**
+ * @brief enumerationBusRun runs the address enumeration on every bus segment, blocks until it is done
+ * @param assigned is called for every node that got an address, may be NULL
+ * The segment a node was found on is stored with its address, see busSegmentOf().
+ */
+void enumerationBusRun(uint8_t firstAddress, uint16_t slots, bool all, void (*assigned)(uint8_t address, uint32_t id),
+                       struct EnumerationStatistics * statistics);
+
+#endif
@@ -0,0 +1,75 @@
+#include "enumerationMaster.h"
+
+#include <string.h>
+
+enum {
+    maxRounds = 32
+};
+
+static void broadcast_(struct EnumerationBus const * const bus, uint8_t const cmdId, uint8_t const cmdTag,
+                       uint16_t const parameter)
+{
+    struct TelemetryCommand command;
+
+    command.cmdId = cmdId;
+    command.cmdTag = cmdTag;
+    command.parameter = parameter;
+
+    bus->broadcast(&command);
+}
+
+void enumerationRun(struct EnumerationBus const * const bus, uint8_t address, uint16_t slots, bool const all,
+                    struct EnumerationStatistics * const statistics)
+{
+    uint16_t startFlags = TELEMETRY_ENUMERATION_NEW | (all ? TELEMETRY_ENUMERATION_ALL : 0);
+
+    memset(statistics, 0, sizeof(*statistics));
+
+    while(statistics->rounds < maxRounds && slots > 0 && address < TELEMETRY_PROBE_ADDRESS)
+    {
+        uint16_t collisions = 0;
+
+        if(slots > TELEMETRY_ENUMERATION_SLOTS) {
+            slots = TELEMETRY_ENUMERATION_SLOTS;
+        }
+
+        broadcast_(bus, telemetryEnumerationStart, statistics->rounds, startFlags | slots);
+        startFlags = 0; //Only the first round decides who takes part, the others continue with the remaining nodes
+
+        for(uint16_t slot = 0; slot < slots && address < TELEMETRY_PROBE_ADDRESS; ++slot)
+        {
+            struct TelemetryCommand reply;
+
+            broadcast_(bus, telemetryEnumerationSlot, statistics->rounds, slot);
+
+            switch(bus->probe(&reply)) {
+            case enumerationFound:
+                broadcast_(bus, telemetryEnumerationAssign, address, reply.parameter);
+
+                if(bus->assigned) {
+                    bus->assigned(address, ((uint32_t)reply.cmdTag << 16) | reply.parameter);
+                }
+
+                ++address;
+                ++statistics->assigned;
+                break;
+
+            case enumerationCollision:
+                ++collisions;
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        ++statistics->rounds;
+        statistics->slots += slots;
+        statistics->collisions += collisions;
+
+        /* Every collided slot hides about 2.39 nodes (Schoute), size the next round for them */
+        slots = (collisions * 239u + 99u) / 100u;
+    }
+
+    broadcast_(bus, telemetryEnumerationSlot, statistics->rounds, TELEMETRY_ENUMERATION_SLOTS); //Nobody is in this slot, all disarm
+}
@@ -0,0 +1,51 @@
+#ifndef ENUMERATION_MASTER_H
+#define ENUMERATION_MASTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../protocol.h"
+
+enum EnumerationProbe {
+    enumerationEmpty,      //Nobody answered on the probe address
+    enumerationFound,      //Exactly one node answered, the reply is valid
+    enumerationCollision   //The reply was corrupted, more than one node answered
+};
+
+/**
+ * Bus access used by the enumeration, so the same procedure runs on the bridge and in the host simulation.
+ */
+struct EnumerationBus {
+    /**
+     * @brief broadcast sends the command to the general call address
+     */
+    bool (*broadcast)(struct TelemetryCommand const * command);
+
+    /**
+     * @brief probe reads the reply of the nodes in the current slot from TELEMETRY_PROBE_ADDRESS
+     */
+    enum EnumerationProbe (*probe)(struct TelemetryCommand * reply);
+
+    /**
+     * @brief assigned is called for every node that got an address, may be NULL
+     */
+    void (*assigned)(uint8_t address, uint32_t id);
+};
+
+struct EnumerationStatistics {
+    uint8_t assigned;
+    uint8_t rounds;
+    uint16_t slots;
+    uint16_t collisions;
+};
+
+/**
+ * @brief enumerationRun discovers the unconfigured nodes and assigns them consecutive addresses
+ * @param firstAddress is given to the first node found, the range above it must be free
+ * @param slots Number of slots of the first round, roughly the expected number of nodes
+ * @param all If true the configured nodes get a new address as well
+ */
+void enumerationRun(struct EnumerationBus const * bus, uint8_t firstAddress, uint16_t slots, bool all,
+                    struct EnumerationStatistics * statistics);
+
+#endif
@@ -0,0 +1,58 @@
+#include "generalCall.h"
+#include "busSpeed.h"
+#include "../hdlc.h"
+
+#include <stddef.h>
+
+void generalCallInit(struct GeneralCall * const call, uint8_t const bus)
+{
+    call->job.bus = bus;
+    call->job.speed = busSpeedSlowest(bus);
+    call->job.completed = NULL;
+    call->job.status = twiJobOk;
+}
+
+struct TwiJob * generalCallBroadcast(struct GeneralCall * const call, struct TelemetryCommand const * const command)
+{
+    call->job.address = TELEMETRY_GENERAL_CALL_ADDRESS;
+    call->job.txBuffer = call->frame;
+    call->job.txLength = hdlcEncodeBuffer(command, sizeof(*command), call->frame, sizeof(call->frame));
+    call->job.rxBuffer = NULL;
+    call->job.rxLength = 0;
+
+    return &call->job;
+}
+
+struct TwiJob * generalCallProbe(struct GeneralCall * const call)
+{
+    call->job.address = TELEMETRY_PROBE_ADDRESS;
+    call->job.txBuffer = NULL;
+    call->job.txLength = 0;
+    call->job.rxBuffer = call->frame;
+    call->job.rxLength = sizeof(call->frame);
+
+    return &call->job;
+}
+
+bool generalCallDone(struct GeneralCall const * const call)
+{
+    return call->job.status != twiJobPending;
+}
+
+enum EnumerationProbe generalCallProbeResult(struct GeneralCall const * const call, struct TelemetryCommand * const reply)
+{
+    struct HdlcDecoder decoder;
+    enum HdlcResult result = hdlcPending;
+
+    if(call->job.status != twiJobOk) {
+        return enumerationEmpty; //Nobody acknowledged the probe address
+    }
+
+    hdlcDecoderInit(&decoder, reply, sizeof(*reply));
+    for(size_t i = 0; i<call->job.rxLength && result == hdlcPending; ++i) {
+        result = hdlcDecodeChar(&decoder, call->frame[i]);
+    }
+
+    /* Several nodes sending at once get wired-AND together, which breaks the CRC */
+    return result == hdlcFrameOk && decoder.length == sizeof(*reply) ? enumerationFound : enumerationCollision;
+}
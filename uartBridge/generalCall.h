@@ -0,0 +1,48 @@
+#ifndef GENERAL_CALL_H
+#define GENERAL_CALL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "enumerationMaster.h"
+#include "twiMaster.h"
+
+/**
+ * The broadcasts to the general call address and the reads from TELEMETRY_PROBE_ADDRESS the enumeration and the
+ * alert search are made of. Every node of the segment has to follow them, so they run at the slowest speed
+ * calibrated on it. The calls only prepare the job, the caller hands it to twiMasterTransfer() or submits it and
+ * polls generalCallDone().
+ */
+enum {
+    GENERAL_CALL_DECODE_MS = 2 //Time the nodes need between a broadcast and the probe to decode it and load their reply
+};
+
+struct GeneralCall {
+    struct TwiJob job;
+    uint8_t frame[TELEMETRY_MAX_REPLY_FRAME];
+};
+
+/**
+ * @brief generalCallInit sets up the calls for the bus segment, see busSpeedSlowest()
+ */
+void generalCallInit(struct GeneralCall * call, uint8_t bus);
+
+/**
+ * @brief generalCallBroadcast prepares the command to the general call address
+ */
+struct TwiJob * generalCallBroadcast(struct GeneralCall * call, struct TelemetryCommand const * command);
+
+/**
+ * @brief generalCallProbe prepares the read of TELEMETRY_PROBE_ADDRESS, run it GENERAL_CALL_DECODE_MS after the
+ * broadcast
+ */
+struct TwiJob * generalCallProbe(struct GeneralCall * call);
+
+bool generalCallDone(struct GeneralCall const * call);
+
+/**
+ * @brief generalCallProbeResult decodes the reply of the nodes once the probe is done
+ */
+enum EnumerationProbe generalCallProbeResult(struct GeneralCall const * call, struct TelemetryCommand * reply);
+
+#endif
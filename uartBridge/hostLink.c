@@ -0,0 +1,380 @@
+#include "hostLink.h"
+#include "alertBus.h"
+#include "alertLine.h"
+#include "bridgeProtocol.h"
+#include "busSpeed.h"
+#include "clock.h"
+#include "enumerationBus.h"
+#include "reportFilter.h"
+#include "rs232.h"
+#include "scheduler.h"
+#include "sensorRequest.h"
+#include "trace.h"
+#include "twiMaster.h"
+#include "../hdlc.h"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Host requests are staged in request_ while the transactions of earlier ones still run, each transaction has a
+ * slot with its own bus frames. The slots form a ring, so the results go out in the order of the requests.
+ */
+struct Slot {
+    struct SensorRequest request;
+    struct BridgeTransactionResult result;
+    bool busy;                 //request is on the bus for result
+};
+
+static uint8_t request_[BRIDGE_MAX_MESSAGE];
+static struct HdlcDecoder decoder_;
+static bool staged_;           //request_ holds a decoded request that waits for the bus
+static size_t stagedLength_;
+static struct Slot slots_[BRIDGE_PIPELINE_DEPTH];
+static uint8_t oldest_;        //Slot whose result is sent next
+static uint8_t sequence_;      //Of the request being processed, for the enumeration events
+static uint8_t sampleSequence_;
+static struct BridgeSpeed calibration_; //Answer of the running speed calibration
+static bool calibrating_;
+
+static void sendMessage_(void const * const message, size_t const length)
+{
+    uint8_t frame[BRIDGE_MAX_FRAME];
+    size_t const frameLength = hdlcEncodeBuffer(message, length, frame, sizeof(frame));
+
+    for(size_t i = 0; i<frameLength; ++i) {
+        while(!rs232WriteByte(frame[i])) {} //Only the enumeration and alert events can fill the buffer
+    }
+}
+
+static void sendError_(struct BridgeHeader const * const header, uint8_t const status)
+{
+    struct BridgeHello const error = { { bridgeOpError, header->sequence }, status, 0 };
+
+    sendMessage_(&error, sizeof(error));
+}
+
+static void enumerationAssigned_(uint8_t const address, uint32_t const id)
+{
+    struct BridgeAssigned const event = { { bridgeOpAssigned, sequence_ }, address, 0, id };
+
+    sendMessage_(&event, sizeof(event));
+}
+
+/* Not filtered, a node only alerts when its reading crossed a threshold */
+static void alerted_(uint8_t const address, struct TelemetryCommand const * const reply)
+{
+    struct BridgeSample const message = {
+        { bridgeOpSample, sampleSequence_++ }, address, bridgeStatusOk, *reply, clockMillis()
+    };
+
+    sendMessage_(&message, sizeof(message));
+}
+
+static uint8_t busySlots_( void )
+{
+    uint8_t busy = 0;
+
+    for(uint8_t i = 0; i<BRIDGE_PIPELINE_DEPTH; ++i) {
+        busy += slots_[i].busy;
+    }
+
+    return busy;
+}
+
+/* A transaction needs a free slot and must not overtake one to the same sensor, whose reply is not read yet.
+ * Everything else waits for the running transactions, so its answer stays in order and it gets the bus alone. */
+static bool canDispatch_( void )
+{
+    struct BridgeHeader const * const header = (struct BridgeHeader const *)request_;
+    uint8_t const busy = busySlots_();
+
+    if(calibrating_ || alertBusBusy()) {
+        return false;
+    }
+
+    if(header->opcode != bridgeOpTransaction || stagedLength_ != sizeof(struct BridgeTransaction)) {
+        return busy == 0;
+    }
+
+    uint8_t const address = ((struct BridgeTransaction const *)request_)->address;
+
+    for(uint8_t i = 0; i<BRIDGE_PIPELINE_DEPTH; ++i) {
+        if(slots_[i].busy && slots_[i].result.address == address) {
+            return false;
+        }
+    }
+
+    return busy < BRIDGE_PIPELINE_DEPTH;
+}
+
+static void dispatch_(size_t const length)
+{
+    struct BridgeHeader const * const header = (struct BridgeHeader const *)request_;
+
+    switch(header->opcode) {
+    case bridgeOpHello:
+    {
+        struct BridgeHello const hello = { { bridgeOpHello, header->sequence }, BRIDGE_PROTOCOL_VERSION, 0 };
+
+        sendMessage_(&hello, sizeof(hello));
+        break;
+    }
+
+    case bridgeOpStatistics:
+    {
+        struct Rs232Statistics serial;
+
+        rs232GetStatistics(&serial);
+
+        struct BridgeStatistics const statistics = {
+            { bridgeOpStatistics, header->sequence },
+            serial.hardwareOverruns, serial.bufferOverruns, serial.framingErrors
+        };
+        sendMessage_(&statistics, sizeof(statistics));
+        break;
+    }
+
+    case bridgeOpSchedule:
+    {
+        struct BridgeSchedule const * const schedule = (struct BridgeSchedule const *)request_;
+
+        if(length != sizeof(*schedule) ||
+           !schedulerSetEntry(schedule->address, schedule->commands, schedule->interval)) {
+            sendError_(header, bridgeStatusMalformed);
+            break;
+        }
+
+        sendMessage_(schedule, sizeof(*schedule));
+        break;
+    }
+
+    case bridgeOpRun:
+    {
+        struct BridgeRun const * const run = (struct BridgeRun const *)request_;
+
+        if(length != sizeof(*run)) {
+            sendError_(header, bridgeStatusMalformed);
+            break;
+        }
+
+        schedulerRun(run->run != 0);
+        sendMessage_(run, sizeof(*run));
+        break;
+    }
+
+    case bridgeOpReport:
+    {
+        struct BridgeReport const * const report = (struct BridgeReport const *)request_;
+
+        if(length != sizeof(*report) || report->address == TELEMETRY_GENERAL_CALL_ADDRESS ||
+           report->address >= TELEMETRY_PROBE_ADDRESS) {
+            sendError_(header, bridgeStatusMalformed);
+            break;
+        }
+
+        if(!reportFilterSet(report->address, report->command, report->deadband, report->heartbeat)) {
+            sendError_(header, bridgeStatusFull);
+            break;
+        }
+
+        sendMessage_(report, sizeof(*report));
+        break;
+    }
+
+    case bridgeOpReportSummary:
+    {
+        struct ReportSummary counts;
+
+        reportFilterSummary(&counts);
+
+        struct BridgeReportSummary const summary = {
+            { bridgeOpReportSummary, header->sequence }, counts.forwarded, counts.held, counts.heartbeats
+        };
+        sendMessage_(&summary, sizeof(summary));
+        break;
+    }
+
+#ifdef BRIDGE_TRACE
+    case bridgeOpTrace:
+    {
+        struct BridgeTraceData data = { { bridgeOpTrace, header->sequence }, 0, 0, { 0 } };
+        uint8_t const sreg = SREG;
+
+        cli(); //The TWI interrupts append to the ring
+        data.length = traceRead(data.data, sizeof(data.data), &data.lost);
+        SREG = sreg;
+
+        sendMessage_(&data, sizeof(data));
+        break;
+    }
+#endif
+
+    case bridgeOpCalibrateSpeed:
+    case bridgeOpSpeed:
+    {
+        struct BridgeSpeed speed = *(struct BridgeSpeed const *)request_;
+
+        if(length != sizeof(speed) || speed.address == TELEMETRY_GENERAL_CALL_ADDRESS ||
+           speed.address >= TELEMETRY_PROBE_ADDRESS || speed.speed >= twiSpeeds) {
+            sendError_(header, bridgeStatusMalformed);
+            break;
+        }
+
+        /* The calibration takes a few seconds per sensor, hostLinkPoll() runs it and answers once it is done */
+        if(header->opcode == bridgeOpCalibrateSpeed) {
+            calibration_ = speed;
+            calibrating_ = true;
+            busSpeedCalibrateStart(speed.address);
+            break;
+        }
+
+        busSpeedSet(speed.address, speed.speed);
+
+        speed.sclHz = twiMasterSpeedHz(busSegmentOf(speed.address), speed.speed);
+        sendMessage_(&speed, sizeof(speed));
+        break;
+    }
+
+    case bridgeOpTransaction:
+    {
+        struct BridgeTransaction const * const transaction = (struct BridgeTransaction const *)request_;
+
+        if(length != sizeof(*transaction) || transaction->address == TELEMETRY_GENERAL_CALL_ADDRESS ||
+           transaction->address >= TELEMETRY_PROBE_ADDRESS) {
+            sendError_(header, bridgeStatusMalformed);
+            break;
+        }
+
+        struct Slot * const slot = &slots_[(oldest_ + busySlots_()) % BRIDGE_PIPELINE_DEPTH];
+
+        slot->result.header = transaction->header;
+        slot->result.address = transaction->address;
+        slot->busy = true;
+        sensorRequestStart(&slot->request, transaction->address, &transaction->command);
+        break;
+    }
+
+    case bridgeOpEnumerate:
+    {
+        struct BridgeEnumerate const * const enumerate = (struct BridgeEnumerate const *)request_;
+        struct EnumerationStatistics statistics;
+
+        if(length != sizeof(*enumerate) || enumerate->firstAddress == 0 ||
+           enumerate->firstAddress >= TELEMETRY_PROBE_ADDRESS) {
+            sendError_(header, bridgeStatusMalformed);
+            break;
+        }
+
+        sequence_ = header->sequence;
+        enumerationBusRun(enumerate->firstAddress, enumerate->slots, enumerate->all, enumerationAssigned_, &statistics);
+
+        struct BridgeEnumerateResult const result = {
+            { bridgeOpEnumerate, header->sequence },
+            statistics.assigned, statistics.rounds, statistics.slots, statistics.collisions
+        };
+        sendMessage_(&result, sizeof(result));
+        break;
+    }
+
+    default:
+        sendError_(header, bridgeStatusUnknown);
+        break;
+    }
+}
+
+void hostLinkInit( void )
+{
+    for(uint8_t i = 0; i<BRIDGE_PIPELINE_DEPTH; ++i) {
+        slots_[i].busy = false;
+    }
+    oldest_ = 0;
+    staged_ = false;
+    calibrating_ = false;
+    schedulerInit();
+    reportFilterInit();
+    alertLineInit();
+#ifdef BRIDGE_TRACE
+    traceInit();
+#endif
+    hdlcDecoderInit(&decoder_, request_, sizeof(request_));
+}
+
+void hostLinkPoll( void )
+{
+    /* Answers are only produced when they fit into the transmit buffer, so the loop never waits for the UART */
+    if(rs232TxSpace() < BRIDGE_MAX_FRAME) {
+        return;
+    }
+
+    /* All slots are polled to get their retries going, only the oldest one may answer */
+    for(uint8_t i = 0; i<BRIDGE_PIPELINE_DEPTH; ++i) {
+        struct Slot * const slot = &slots_[i];
+
+        if(slot->busy && sensorRequestDone(&slot->request) && i == oldest_) {
+            /* The request states below 0x80 are the bridge states of the protocol */
+            slot->result.status = slot->request.status;
+            slot->result.reply = slot->request.reply;
+            sendMessage_(&slot->result, sizeof(slot->result));
+            slot->busy = false;
+            oldest_ = (oldest_ + 1) % BRIDGE_PIPELINE_DEPTH;
+        }
+    }
+
+    /* The pings of a calibration and the scheduled transactions take turns, so neither reads the other's reply */
+    if(calibrating_) {
+        uint8_t const progress = busSpeedCalibratePoll(schedulerIdle() && !alertBusBusy(), &calibration_.speed);
+
+        if(progress == busSpeedFailed) {
+            sendError_(&calibration_.header, bridgeStatusNoSpeed);
+        } else if(progress == busSpeedPassed) {
+            calibration_.sclHz = twiMasterSpeedHz(busSegmentOf(calibration_.address), calibration_.speed);
+            sendMessage_(&calibration_, sizeof(calibration_));
+        }
+
+        calibrating_ = progress == busSpeedCalibrating;
+    }
+
+    /* Host requests and scheduled transactions take turns, so the host is never locked out by a busy schedule.
+     * A staged request lets the scheduled transactions of all segments finish without starting new ones. */
+    if(busySlots_() == 0 && (!staged_ || !schedulerIdle())) {
+        struct SchedulerSample sample;
+
+        if(schedulerPoll(&sample, !staged_ && busSpeedCalibrateIdle() && !alertBusBusy()) &&
+           reportFilterPass(sample.address, sample.status == sensorRequestOk, &sample.reply)) {
+            struct BridgeSample const message = {
+                { bridgeOpSample, sampleSequence_++ }, sample.address, sample.status, sample.reply, sample.timestamp
+            };
+            sendMessage_(&message, sizeof(message));
+        }
+    }
+
+    /* The alert search starts when nothing else wants the bus and keeps it for a few queries per node */
+    if(alertBusBusy() || (busySlots_() == 0 && !staged_ && !calibrating_ && schedulerIdle())) {
+        struct AlertStatistics statistics;
+
+        alertBusPoll(alerted_, &statistics);
+    }
+
+    /* The next request is decoded while the bus works on the previous ones, it waits in request_ for a slot */
+    while(rs232TxSpace() >= BRIDGE_MAX_FRAME) {
+        if(staged_) {
+            if(!schedulerIdle() || !canDispatch_()) {
+                break;
+            }
+
+            staged_ = false;
+            dispatch_(stagedLength_);
+        } else if(rs232ByteAvailable()) {
+            if(hdlcDecodeChar(&decoder_, rs232ReadByte()) == hdlcFrameOk) {
+                staged_ = true; //Broken frames are dropped, the host times out and repeats
+                stagedLength_ = decoder_.length;
+            }
+        } else {
+            break;
+        }
+    }
+}
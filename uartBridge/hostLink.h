@@ -0,0 +1,18 @@
+#ifndef HOST_LINK_H
+#define HOST_LINK_H
+
+/**
+ * Binary, HDLC framed protocol to the host, see bridgeProtocol.h.
+ */
+
+/**
+ * @brief hostLinkInit resets the frame decoder
+ */
+void hostLinkInit( void );
+
+/**
+ * @brief hostLinkPoll decodes the host requests and sends the answers of finished ones, call it from the main loop
+ */
+void hostLinkPoll( void );
+
+#endif
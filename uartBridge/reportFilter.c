@@ -0,0 +1,111 @@
+#include "reportFilter.h"
+
+#include <stddef.h>
+
+enum {
+    unreported = 0xff //held of a filter that has not reported a value yet
+};
+
+/* 8 bytes each, a free filter has address 0 */
+struct Filter {
+    uint8_t address;
+    uint8_t command;
+    uint8_t heartbeat;
+    uint8_t held;       //Readings held back since the last report, saturates below unreported
+    uint16_t deadband;  //A whole percent of humidity is 100
+    uint16_t value;     //Last reported
+};
+
+static struct Filter filters_[REPORT_FILTERS];
+static struct ReportSummary summary_;
+
+static struct Filter * find_(uint8_t const address, uint8_t const command)
+{
+    for(uint8_t i = 0; i<REPORT_FILTERS; ++i) {
+        if(filters_[i].address == address && filters_[i].command == command) {
+            return &filters_[i];
+        }
+    }
+
+    return NULL;
+}
+
+void reportFilterInit( void )
+{
+    for(uint8_t i = 0; i<REPORT_FILTERS; ++i) {
+        filters_[i].address = TELEMETRY_GENERAL_CALL_ADDRESS;
+    }
+
+    summary_.forwarded = 0;
+    summary_.held = 0;
+    summary_.heartbeats = 0;
+}
+
+bool reportFilterSet(uint8_t const address, uint8_t const command, uint16_t const deadband, uint8_t const heartbeat)
+{
+    if(address == TELEMETRY_GENERAL_CALL_ADDRESS || address >= TELEMETRY_PROBE_ADDRESS) {
+        return false;
+    }
+
+    struct Filter * filter = find_(address, command);
+
+    if(heartbeat == 1) {
+        if(filter) {
+            filter->address = TELEMETRY_GENERAL_CALL_ADDRESS;
+        }
+        return true;
+    }
+
+    for(uint8_t i = 0; i<REPORT_FILTERS && !filter; ++i) {
+        if(filters_[i].address == TELEMETRY_GENERAL_CALL_ADDRESS) {
+            filter = &filters_[i];
+        }
+    }
+
+    if(!filter) {
+        return false;
+    }
+
+    filter->address = address;
+    filter->command = command;
+    filter->deadband = deadband;
+    filter->heartbeat = heartbeat;
+    filter->held = unreported;
+
+    return true;
+}
+
+bool reportFilterPass(uint8_t const address, bool const ok, struct TelemetryCommand const * const reply)
+{
+    struct Filter * const filter = ok ? find_(address, reply->cmdId) : NULL;
+
+    if(filter && filter->held != unreported) {
+        /* Signed, so the step over zero of a calibrated temperature is as short as any other */
+        int16_t const change = (int16_t)(reply->parameter - filter->value);
+        uint16_t const distance = change < 0 ? -(uint16_t)change : (uint16_t)change;
+        bool const beat = filter->heartbeat && filter->held + 1 >= filter->heartbeat;
+
+        if(distance <= filter->deadband && !beat) {
+            if(filter->held < unreported - 1) {
+                ++filter->held;
+            }
+            ++summary_.held;
+            return false;
+        }
+
+        summary_.heartbeats += distance <= filter->deadband;
+    }
+
+    if(filter) {
+        filter->held = 0;
+        filter->value = reply->parameter;
+    }
+
+    ++summary_.forwarded;
+    return true;
+}
+
+void reportFilterSummary(struct ReportSummary * const summary)
+{
+    *summary = summary_;
+}
@@ -0,0 +1,49 @@
+#ifndef REPORT_FILTER_H
+#define REPORT_FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../protocol.h"
+
+/**
+ * Report by exception for the scheduled samples. A filter holds the value last reported for one command of one
+ * sensor and holds back the readings within its deadband of it, unless heartbeat readings in a row were held back.
+ * Samples without a filter and failed ones always pass. There is room for REPORT_FILTERS filters, they are kept in
+ * RAM only: the EEPROM of the ATmega16 is taken by the schedule and the bus speeds, the host sets them again after
+ * a reset of the bridge.
+ */
+enum {
+    REPORT_FILTERS = 16
+};
+
+/* Counts since the bridge started, they wrap */
+struct ReportSummary {
+    uint16_t forwarded;  //Samples passed, including the ones without a filter
+    uint16_t held;       //Readings held back within the deadband
+    uint16_t heartbeats; //Readings within the deadband passed for the heartbeat
+};
+
+/**
+ * @brief reportFilterInit removes all filters and clears the counts
+ */
+void reportFilterInit( void );
+
+/**
+ * @brief reportFilterSet adds or changes the filter of command on address, the next reading passes in any case
+ * @param deadband Largest change held back, in units of the reading
+ * @param heartbeat A reading passes after heartbeat - 1 held back ones, 0 never sends an unchanged reading and 1
+ * sends every one, which removes the filter
+ * @return false if the address is invalid or there is no room for another filter
+ */
+bool reportFilterSet(uint8_t address, uint8_t command, uint16_t deadband, uint8_t heartbeat);
+
+/**
+ * @brief reportFilterPass decides whether a sample goes to the host and keeps the value it reports
+ * @param ok The transaction succeeded and reply holds a reading
+ */
+bool reportFilterPass(uint8_t address, bool ok, struct TelemetryCommand const * reply);
+
+void reportFilterSummary(struct ReportSummary * summary);
+
+#endif
@@ -0,0 +1,162 @@
+#include "core/ringBuffer.hpp"
+
+extern "C" {
+#include "rs232.h"
+}
+
+#include <avr/io.h>
+#include <avr/iom16.h>
+#include <avr/interrupt.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef BAUD
+    #define BAUD 38400
+#endif
+
+#define BAUD_TOL 2
+#include <util/setbaud.h>
+
+/* setbaud.h only warns, a link that is off by more than the tolerance doesn't work at all */
+#if USE_2X
+    #define RS232_ACTUAL_BAUD (F_CPU / (8UL * (UBRR_VALUE + 1UL)))
+#else
+    #define RS232_ACTUAL_BAUD (F_CPU / (16UL * (UBRR_VALUE + 1UL)))
+#endif
+
+#if 100UL * RS232_ACTUAL_BAUD > (100UL + BAUD_TOL) * BAUD || 100UL * RS232_ACTUAL_BAUD < (100UL - BAUD_TOL) * BAUD
+    #error Baud rate can not be reached with this F_CPU, pick another BAUD
+#endif
+
+enum{
+  maxBufferSize = 64,   //Power of two, the indices wrap with a mask
+  maxTxBufferSize = 128
+};
+
+/* The receive interrupt writes rxBuffer_, the transmit interrupt reads txBuffer_, the main loop the other sides */
+static core::RingBuffer<maxBufferSize> rxBuffer_;
+static core::RingBuffer<maxTxBufferSize> txBuffer_;
+static volatile struct Rs232Statistics statistics_;
+
+void rs232Init( void )
+{
+    rxBuffer_.clear();
+    txBuffer_.clear();
+    memset((void*)&statistics_, 0, sizeof(statistics_));
+
+    DDRB  = 0xff;
+#if USE_2X
+    UCSRA = (1<<U2X); //Enable double clock, the divisor is too coarse without it
+#else
+    UCSRA = 0x0; //Disable Multiprocessor and 2x Speed
+#endif
+    UBRRH = UBRRH_VALUE;
+    UBRRL = UBRRL_VALUE; //BAUD from F_CPU, see util/setbaud.h
+    UCSRC = (1<<URSEL) | (1<<UCSZ1) | (1<<UCSZ0); // no parity, 1 stop, 8 data
+    UCSRB = (1<<RXEN) | (1<<TXEN) | (1 << RXCIE); //Enable RX, TX, RX interrupt. UDRIE is set while there is data to send
+}
+
+void debugNumber(unsigned const number, unsigned const number2)
+{
+    char buffer[sizeof("DBG: 65535 -> 65535\r\n")]; //Widest with the 16 bit unsigned of the AVR
+    snprintf(buffer, sizeof(buffer), "DBG: %u -> %u\r\n", number, number2);
+    rs232SendString(buffer);
+}
+
+bool rs232ByteAvailable( void )
+{
+    return !rxBuffer_.empty();
+}
+
+uint8_t rs232ReadByte( void )
+{
+    uint8_t result = 0;
+    rxBuffer_.pop(result);
+
+    return result;
+}
+
+uint8_t rs232TxSpace( void )
+{
+    return txBuffer_.space();
+}
+
+bool rs232WriteByte(const uint8_t data)
+{
+    if(!txBuffer_.push(data)) {
+        return false; //Full, the caller decides whether to wait
+    }
+
+    UCSRB |= (1<<UDRIE); //Single instruction, the ISR clears it again when the buffer ran empty
+
+    return true;
+}
+
+/* Waits for room in the buffer, the UDRE interrupt keeps draining it meanwhile */
+static void putByte(uint8_t const data)
+{
+    while(!rs232WriteByte(data)) {}
+}
+
+void rs232SendString(const char *string)
+{
+    const char *tmp = string;
+
+    while((*tmp) != 0)
+    {
+        if(*tmp == '\n' ) {
+            putByte('\r');
+        }
+
+        putByte((*tmp));
+        tmp++;
+    }
+}
+
+void rs232SendHexByte(const uint8_t byte)
+{
+    const char hex[]={'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'};
+    putByte(hex[(byte>>4) & 0xF]);
+    putByte(hex[(byte & 0xF)]);
+}
+
+void rs232GetStatistics(struct Rs232Statistics * const statistics)
+{
+    uint8_t const sreg = SREG;
+    cli();
+    *statistics = const_cast<struct Rs232Statistics const &>(statistics_); //Consistent with the interrupt off
+    SREG = sreg;
+}
+
+ISR(USART_RXC_vect)
+{
+    PORTB = 0xff;
+    uint8_t const status = UCSRA; //The error flags are only valid before UDR is read
+    uint8_t const data = UDR;     //Always read it, otherwise the interrupt fires again right away
+
+    if(status & (1<<DOR)) {
+        ++statistics_.hardwareOverruns;
+    }
+
+    if(status & (1<<FE)) {
+        ++statistics_.framingErrors;
+    }
+
+    if(!rxBuffer_.push(data)) {
+        ++statistics_.bufferOverruns;
+    }
+    PORTB = 0x00;
+}
+
+ISR(USART_UDRE_vect)
+{
+    uint8_t data;
+
+    if(txBuffer_.pop(data)) {
+        UDR = data;
+    } else {
+        UCSRB &= ~(1<<UDRIE);
+    }
+}
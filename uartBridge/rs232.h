@@ -4,10 +4,36 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/**
+ * Receive errors counted by the UART interrupt since rs232Init()
+ */
+struct Rs232Statistics {
+    uint16_t hardwareOverruns; //UDR was not read in time, bytes are lost in the UART
+    uint16_t bufferOverruns;   //The receive buffer was full, the byte was dropped
+    uint16_t framingErrors;    //No stop bit, usually a baud rate mismatch
+};
+
 void rs232SendHexByte(const uint8_t byte);
+
+/**
+ * @brief rs232SendString queues the string, waits for room if the transmit buffer is full. Interrupts must be enabled.
+ */
 void rs232SendString(const char *string);
+
+/**
+ * @brief rs232WriteByte queues the byte for the transmit interrupt, never waits
+ * @return false if the transmit buffer is full
+ */
 bool rs232WriteByte(const uint8_t data);
+
+/**
+ * @brief rs232TxSpace returns how many bytes rs232WriteByte accepts right now
+ */
+uint8_t rs232TxSpace( void );
+
 uint8_t rs232ReadByte( void );
+bool rs232ByteAvailable( void );
+void rs232GetStatistics(struct Rs232Statistics * statistics);
 void rs232Init( void );
 
 #endif
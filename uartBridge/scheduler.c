@@ -0,0 +1,220 @@
+#include "scheduler.h"
+#include "busSpeed.h"
+#include "clock.h"
+#include "sensorRequest.h"
+
+#include <avr/eeprom.h>
+
+#include <stddef.h>
+
+enum {
+    SCHEDULE_VERSION = 1,
+    scheduleEntries = TELEMETRY_PROBE_ADDRESS //Indexed by the address, 0 is unused
+};
+
+struct ScheduleEntry {
+    uint8_t commands;
+    uint16_t interval;
+};
+
+struct ScheduleEeprom {
+    uint8_t version;
+    uint8_t running;
+    struct ScheduleEntry entries[scheduleEntries];
+};
+
+static struct ScheduleEeprom eepromSchedule EEMEM;
+
+/* Only the volatile part of the entries is held in RAM, 3 bytes per address */
+static uint16_t due_[scheduleEntries];     //Tick the entry is visited next, compared with wrap around
+static uint8_t backoff_[scheduleEntries];
+
+/* Every bus segment visits its own sensors, the segments run their transactions side by side */
+struct Segment {
+    struct SensorRequest request;
+    bool busy;          //request is on the bus
+    uint8_t cursor;     //Address visited last, the search for a due entry continues after it
+    uint8_t pending;    //Commands still to send in the current visit
+};
+
+static struct Segment segments_[twiBuses];
+static bool running_;
+static uint8_t tag_;
+static uint16_t tick_;         //Free running, wraps on its own 16 bit
+static uint32_t tickMillis_;   //clockMillis() at tick_
+
+/* clockMillis() / SCHEDULER_TICK_MS would jump back when the milliseconds wrap after 49.7 days, as 2^32 isn't a
+ * multiple of the tick. The ticks are counted from the 32 bit difference instead, that is right across the wrap. */
+static uint16_t now_( void )
+{
+    uint32_t const ticks = (clockMillis() - tickMillis_) / SCHEDULER_TICK_MS;
+
+    tick_ += (uint16_t)ticks;
+    tickMillis_ += ticks * SCHEDULER_TICK_MS;
+
+    return tick_;
+}
+
+static bool isDue_(uint16_t const due, uint16_t const now)
+{
+    return (int16_t)(now - due) >= 0;
+}
+
+/* A due tick left behind by more than half the 16 bit range reads as in the future, up to 55 minutes of it. While
+ * stopped nothing moves the ticks along, so every entry starts over from now. */
+static void rearm_( void )
+{
+    uint16_t const now = now_();
+
+    for(uint8_t address = 0; address < scheduleEntries; ++address) {
+        due_[address] = now;
+        backoff_[address] = 0;
+    }
+}
+
+void schedulerInit( void )
+{
+    if(eeprom_read_byte(&eepromSchedule.version) != SCHEDULE_VERSION) {
+        for(uint8_t address = 0; address < scheduleEntries; ++address) {
+            eeprom_update_byte(&eepromSchedule.entries[address].commands, 0);
+        }
+        eeprom_update_byte(&eepromSchedule.running, 0);
+        eeprom_update_byte(&eepromSchedule.version, SCHEDULE_VERSION);
+    }
+
+    tick_ = 0;
+    tickMillis_ = clockMillis();
+    rearm_();
+    running_ = eeprom_read_byte(&eepromSchedule.running) != 0;
+
+    for(uint8_t bus = 0; bus < twiBuses; ++bus) {
+        segments_[bus].busy = false;
+        segments_[bus].pending = 0;
+    }
+}
+
+bool schedulerSetEntry(uint8_t const address, uint8_t const commands, uint16_t const interval)
+{
+    if(address == TELEMETRY_GENERAL_CALL_ADDRESS || address >= scheduleEntries || (commands & ~SCHEDULER_COMMANDS)) {
+        return false;
+    }
+
+    struct ScheduleEntry const entry = { commands, interval };
+
+    /* Synchronous, a few ms per byte. Transactions on the bus continue from the interrupt meanwhile. */
+    eeprom_update_block(&entry, &eepromSchedule.entries[address], sizeof(entry));
+    due_[address] = now_(); //Visited right away, however long the entry was unused
+    backoff_[address] = 0;
+
+    return true;
+}
+
+void schedulerRun(bool const run)
+{
+    if(run) {
+        rearm_();
+    }
+
+    running_ = run;
+    eeprom_update_byte(&eepromSchedule.running, run);
+}
+
+bool schedulerIdle( void )
+{
+    for(uint8_t bus = 0; bus < twiBuses; ++bus) {
+        if(segments_[bus].busy) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Finds the next due entry of the segment after its cursor, round robin so a fast sensor can't starve the others */
+static bool nextDue_(uint8_t const bus, uint16_t const now)
+{
+    struct Segment * const segment = &segments_[bus];
+    uint8_t address = segment->cursor;
+
+    for(uint8_t i = 0; i < scheduleEntries; ++i) {
+        if(++address >= scheduleEntries) {
+            address = 1;
+        }
+
+        uint8_t const commands = eeprom_read_byte(&eepromSchedule.entries[address].commands);
+
+        if(commands && isDue_(due_[address], now) && busSegmentOf(address) == bus) {
+            uint16_t const interval = eeprom_read_word(&eepromSchedule.entries[address].interval);
+            uint8_t const backoff = backoff_[address];
+            uint32_t const wait = backoff ? (uint32_t)(interval ? interval : 1) << backoff : interval;
+
+            /* The next visit is timed from the start of this one, so the cadence does not drift */
+            due_[address] = now + (wait < 0x7fff ? wait : 0x7fff);
+            segment->cursor = address;
+            segment->pending = commands;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void startNext_(struct Segment * const segment)
+{
+    uint8_t id = 0;
+
+    while(!(segment->pending & (1<<id))) {
+        ++id;
+    }
+
+    struct TelemetryCommand const command = { id, ++tag_, 0 };
+
+    segment->pending &= ~(1<<id);
+    segment->busy = true;
+    sensorRequestStart(&segment->request, segment->cursor, &command);
+}
+
+static bool pollSegment_(uint8_t const bus, struct SchedulerSample * const sample, bool const start)
+{
+    struct Segment * const segment = &segments_[bus];
+
+    if(segment->busy) {
+        if(!sensorRequestDone(&segment->request)) {
+            return false;
+        }
+
+        segment->busy = false;
+
+        if(segment->request.status == sensorRequestBusError) {
+            segment->pending = 0; //Skip the rest of the visit, the sensor is gone or busy
+            if(backoff_[segment->cursor] < SCHEDULER_MAX_BACKOFF) {
+                ++backoff_[segment->cursor];
+            }
+        } else {
+            backoff_[segment->cursor] = 0;
+        }
+
+        sample->address = segment->cursor;
+        sample->status = segment->request.status;
+        sample->reply = segment->request.status == sensorRequestOk ? segment->request.reply : segment->request.command;
+        sample->timestamp = clockMillis();
+        return true;
+    }
+
+    if(start && (segment->pending || (running_ && nextDue_(bus, now_())))) {
+        startNext_(segment);
+    }
+
+    return false;
+}
+
+bool schedulerPoll(struct SchedulerSample * const sample, bool const start)
+{
+    for(uint8_t bus = 0; bus < twiBuses; ++bus) {
+        if(pollSegment_(bus, sample, start)) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,60 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../protocol.h"
+
+/**
+ * Autonomous poller. Every sensor address has an entry with the commands to send and the interval in which to
+ * send them, the entries live in the EEPROM so a schedule survives a reset of the bridge. Due sensors are visited
+ * round robin, one transaction at a time on every bus segment. A sensor that does not acknowledge is skipped for the rest of its
+ * visit and backs off, its interval doubles with every further miss up to SCHEDULER_MAX_BACKOFF.
+ */
+enum {
+    SCHEDULER_TICK_MS     = 100, //Unit of the intervals
+    SCHEDULER_MAX_BACKOFF = 5,
+    /* Commands that can be scheduled, as bit mask of enum TelemetryCommandId */
+    SCHEDULER_COMMANDS    = (1<<telemetryPing) | (1<<telemetryId) | (1<<telemetryHumidity) |
+                            (1<<telemetryTemperature) | (1<<telemetryRawHumidity) | (1<<telemetryRawTemperature)
+};
+
+struct SchedulerSample {
+    uint8_t address;
+    uint8_t status;     //enum SensorRequestStatus
+    struct TelemetryCommand reply;
+    uint32_t timestamp; //clockMillis() when the transaction completed
+};
+
+/**
+ * @brief schedulerInit restores the schedule from the EEPROM, an EEPROM of an older layout is cleared
+ */
+void schedulerInit( void );
+
+/**
+ * @brief schedulerSetEntry stores the entry for address, commands 0 removes the sensor from the schedule
+ * @param commands Bit mask of enum TelemetryCommandId, only SCHEDULER_COMMANDS are accepted
+ * @param interval In SCHEDULER_TICK_MS, 0 polls the sensor as often as the bus allows
+ * @return false if the address or the commands are invalid
+ */
+bool schedulerSetEntry(uint8_t address, uint8_t commands, uint16_t interval);
+
+/**
+ * @brief schedulerRun starts or stops the polling, the state is kept over a reset. Starting makes every entry due.
+ */
+void schedulerRun(bool run);
+
+/**
+ * @brief schedulerIdle returns true when the scheduler has no transaction on any bus
+ */
+bool schedulerIdle( void );
+
+/**
+ * @brief schedulerPoll starts the next due transactions and checks the running ones, call it from the main loop
+ * @param start false only completes the running transactions, so the bus segments drain
+ * @return True if a transaction completed, its result is in sample
+ */
+bool schedulerPoll(struct SchedulerSample * sample, bool start);
+
+#endif
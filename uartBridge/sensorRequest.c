@@ -0,0 +1,120 @@
+#include "sensorRequest.h"
+#include "busSpeed.h"
+#include "clock.h"
+#include "../hdlc.h"
+
+#include <stddef.h>
+
+enum {
+    maxNotReadyRetries = 8,
+    maxAttempts = 4,
+    firstBackoffMillis = 4  //Doubles with every attempt
+};
+
+/* A sensor that has not queued its reply yet shifts out zeros, so the flag only shows up in a real reply */
+static bool replyStarted_(struct SensorRequest const * const request)
+{
+    for(uint8_t i = 0; i<request->job.rxLength; ++i) {
+        if(request->rx[i] == 0x7e) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool decodeReply_(struct SensorRequest * const request)
+{
+    struct HdlcDecoder decoder;
+    enum HdlcResult result = hdlcPending;
+
+    hdlcDecoderInit(&decoder, &request->reply, sizeof(request->reply));
+
+    for(uint8_t i = 0; i<request->job.rxLength && result != hdlcFrameOk; ++i) {
+        result = hdlcDecodeChar(&decoder, request->rx[i]);
+    }
+
+    return result == hdlcFrameOk && decoder.length == sizeof(request->reply) &&
+           (!request->job.txBuffer || //A plain read can't tell which command the reply belongs to
+            (request->reply.cmdId == request->command.cmdId && request->reply.cmdTag == request->command.cmdTag));
+}
+
+/* Changing the address must not run twice, the second attempt would find the new address already set */
+static bool mayRepeat_(struct SensorRequest const * const request)
+{
+    return request->job.txBuffer && request->command.cmdId != telemetrySetAddress && request->attempts < maxAttempts;
+}
+
+static void submit_(struct SensorRequest * const request)
+{
+    request->job.txLength = request->job.txBuffer ?
+                hdlcEncodeBuffer(&request->command, sizeof(request->command), request->tx, sizeof(request->tx)) : 0;
+    request->notReady = 0;
+    request->status = sensorRequestPending;
+    ++request->attempts;
+
+    twiMasterSubmit(&request->job);
+}
+
+/* Runs in the TWI interrupt */
+static void jobCompleted_(struct TwiJob * const job)
+{
+    struct SensorRequest * const request = (struct SensorRequest *)job;
+
+    request->busStatus = job->status;
+
+    if(job->status != twiJobOk) {
+        request->status = sensorRequestBusError;
+    } else if(!replyStarted_(request)) {
+        if(request->notReady < maxNotReadyRetries) {
+            ++request->notReady;
+            job->txLength = 0; //The command arrived, only read again
+            twiMasterSubmit(job);
+        } else {
+            request->status = sensorRequestNotReady;
+        }
+    } else if(decodeReply_(request)) {
+        request->status = sensorRequestOk;
+    } else if(mayRepeat_(request)) {
+        request->retryAt = clockMillis() + (firstBackoffMillis << request->attempts);
+        request->status = sensorRequestRetryWait;
+    } else {
+        request->status = sensorRequestBadReply;
+    }
+}
+
+void sensorRequestStart(struct SensorRequest * const request, uint8_t const address,
+                        struct TelemetryCommand const * const command)
+{
+    sensorRequestStartAt(request, address, busSpeedOf(address), command);
+}
+
+void sensorRequestStartAt(struct SensorRequest * const request, uint8_t const address, uint8_t const speed,
+                          struct TelemetryCommand const * const command)
+{
+    request->job.address = address;
+    request->job.speed = speed;
+    request->job.bus = busSegmentOf(address);
+    request->job.txBuffer = command ? request->tx : NULL;
+    request->job.rxBuffer = request->rx;
+    request->job.rxLength = sizeof(request->rx);
+    request->job.completed = jobCompleted_;
+
+    if(command) {
+        request->command = *command;
+    }
+
+    request->attempts = 0;
+    request->busStatus = twiJobPending;
+
+    submit_(request);
+}
+
+bool sensorRequestDone(struct SensorRequest * const request)
+{
+    if(request->status == sensorRequestRetryWait && (int16_t)((uint16_t)clockMillis() - request->retryAt) >= 0) {
+        submit_(request);
+    }
+
+    return request->status < sensorRequestPending;
+}
@@ -0,0 +1,55 @@
+#ifndef SENSOR_REQUEST_H
+#define SENSOR_REQUEST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../protocol.h"
+#include "twiMaster.h"
+
+enum SensorRequestStatus {
+    sensorRequestOk        = 0,
+    sensorRequestBusError  = 1, //See busStatus for the TWI status
+    sensorRequestNotReady  = 2, //The sensor had no reply queued, even after the retries
+    sensorRequestBadReply  = 3, //CRC wrong or reply to a different command, even after the retries
+    sensorRequestPending   = 0x80,
+    sensorRequestRetryWait = 0x81  //Backing off before the command is sent again
+};
+
+/**
+ * One command sent to a sensor and its reply read back in a single write-then-read transaction. The reply is
+ * decoded and checked on the bridge, a broken one makes the bridge send the command again after a short backoff.
+ */
+struct SensorRequest {
+    struct TwiJob job; //Keep first, the completion callback gets a pointer to it
+    struct TelemetryCommand command;
+    struct TelemetryCommand reply;  //Valid once the status is sensorRequestOk
+    uint8_t tx[TELEMETRY_MAX_REPLY_FRAME];
+    uint8_t rx[TELEMETRY_MAX_REPLY_FRAME];
+    uint8_t notReady;           //Number of reads that found no reply
+    uint8_t attempts;           //Number of times the command was sent
+    uint8_t busStatus;          //enum TwiJobStatus of the last transaction
+    uint16_t retryAt;           //Low 16 bit of clockMillis() when the command is sent again
+    volatile uint8_t status;    //enum SensorRequestStatus
+};
+
+/**
+ * @brief sensorRequestStart encodes the command and queues the transaction, returns right away
+ * @param command to send, NULL only reads and decodes the reply the sensor has queued
+ * The transaction runs on the segment and at the bus speed stored for the address, see busSpeed.h.
+ */
+void sensorRequestStart(struct SensorRequest * request, uint8_t address, struct TelemetryCommand const * command);
+
+/**
+ * @brief sensorRequestStartAt does the same as sensorRequestStart at the given enum TwiSpeed
+ */
+void sensorRequestStartAt(struct SensorRequest * request, uint8_t address, uint8_t speed,
+                          struct TelemetryCommand const * command);
+
+/**
+ * @brief sensorRequestDone checks if the request completed, needs to be polled to get the retries going
+ * @return True once the status is final
+ */
+bool sensorRequestDone(struct SensorRequest * request);
+
+#endif
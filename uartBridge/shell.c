@@ -0,0 +1,267 @@
+#include "shell.h"
+#include "rs232.h"
+#include "enumerationBus.h"
+#include "sensorRequest.h"
+#include "twiMaster.h"
+#include "../hdlc.h"
+#include "../protocol.h"
+
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <stdio.h>
+
+static char line[32];       //Command line, the next one comes in while the bus works on the last
+static char report[40];     //Report formatting, separate so it can't clobber a half received line
+static uint8_t frame[32];   //TWI payload, the bus works on it while the next command line comes in
+static struct TelemetryCommand cmd;
+
+static uint8_t lineIndex;
+static bool lineReady;
+static struct TwiJob shellJob;
+static struct SensorRequest shellRequest;
+static char pendingCommand;  //Shell command waiting for shellJob or shellRequest, 0 if none
+
+/* Collects the command line from whatever arrived so far, returns true once it is complete */
+static bool readCommand( void )
+{
+    uint8_t byte = rs232ReadByte();
+
+    while(byte != 0)
+    {
+        if(byte == '\r') {
+            rs232SendString("\n");
+
+            bool const complete = lineIndex < sizeof(line);
+            if(complete) {
+                line[lineIndex] = 0;
+            } else {
+                rs232SendString("Command too long!\n");
+            }
+
+            lineIndex = 0;
+            return complete;
+        }
+
+        if(lineIndex < sizeof(line)) {
+            while(!rs232WriteByte(byte)) {}
+            line[lineIndex++] = byte;
+        } //else saturated at sizeof(line), the line is dropped at its CR however long it gets
+
+        byte = rs232ReadByte();
+    }
+
+    return false;
+}
+
+static char* nextParameter(char* buff)
+{
+    while((*buff)!=0 && isspace(*buff)) ++buff;
+
+    return buff;
+}
+
+
+static void startShellJob(char const command, unsigned const address, uint8_t const txLength)
+{
+    shellJob.address = address;
+    shellJob.txBuffer = frame;
+    shellJob.txLength = txLength;
+    shellJob.rxBuffer = NULL;
+    shellJob.rxLength = 0;
+    shellJob.completed = NULL;
+
+    pendingCommand = command;
+    twiMasterSubmit(&shellJob);
+}
+
+static void startShellRequest(char const command, unsigned const address, struct TelemetryCommand const * const telemetry)
+{
+    pendingCommand = command;
+    sensorRequestStart(&shellRequest, address, telemetry);
+}
+
+static bool shellBusy( void )
+{
+    return pendingCommand == 'c' ? shellJob.status == twiJobPending : !sensorRequestDone(&shellRequest);
+}
+
+/* Only decoded replies with a correct CRC are forwarded, the raw bytes stay on the bridge */
+static void reportShellRequest( void )
+{
+    if(shellRequest.status == sensorRequestOk) {
+        sprintf(report,"Reply: %d %d %u\n", shellRequest.reply.cmdId, shellRequest.reply.cmdTag,
+                shellRequest.reply.parameter);
+        rs232SendString(report);
+    }
+
+    sprintf(report,"Result: %d %d\n", shellRequest.status, shellRequest.busStatus);
+    rs232SendString(report);
+    sprintf(report,"Attempts: %d %d\n", shellRequest.attempts, shellRequest.notReady);
+    rs232SendString(report);
+}
+
+/* Prints the outcome of the shell command once its bus job is done */
+static void reportShellJob( void )
+{
+    if(pendingCommand != 'c') {
+        reportShellRequest();
+        pendingCommand = 0;
+        return;
+    }
+
+    for(size_t i = 0; i<shellJob.txLength; ++i)
+    {
+        rs232SendHexByte(frame[i]);
+        while(!rs232WriteByte(' ')) {}
+    }
+
+    sprintf(report,"\nResult: %d\n", shellJob.status);
+    rs232SendString(report);
+
+    pendingCommand = 0;
+}
+
+static void enumerationAssigned(uint8_t address, uint32_t id)
+{
+    sprintf(report,"%02x <- %06lx\n", address, (unsigned long)id);
+    rs232SendString(report);
+}
+
+static void parseCommand( void )
+{
+    char *buff = line;
+    char *next;
+
+    buff = nextParameter(buff);
+    next = nextParameter(buff+1);
+
+    switch (*buff) {
+        case 'r': //Read and decode the reply the sensor has queued
+    {
+        unsigned address;
+        if(sscanf(next,"%x", &address) == 1)
+        {
+            startShellRequest('r', address, NULL);
+        }else {
+            rs232SendString("Not enougth parameter for command.\n");
+        }
+        break;
+    }
+    case 'c':
+    {
+        unsigned address;
+        unsigned id;
+        unsigned tag;
+        unsigned parameter;
+
+        if(sscanf(next,"%x %u %u %u", &address, &id, &tag, &parameter) == 4)
+        {
+            cmd.cmdId = id;
+            cmd.cmdTag = tag;
+            cmd.parameter = parameter;
+            startShellJob('c', address, hdlcEncodeBuffer(&cmd, sizeof(cmd), frame, sizeof(frame)));
+
+        }else {
+            rs232SendString("Not enougth parameter for command.\n");
+        }
+
+        break;
+    }
+
+    case 't': //Command and reply in one transaction
+    {
+        unsigned address;
+        unsigned id;
+        unsigned tag;
+        unsigned parameter;
+
+        if(sscanf(next,"%x %u %u %u", &address, &id, &tag, &parameter) == 4)
+        {
+            cmd.cmdId = id;
+            cmd.cmdTag = tag;
+            cmd.parameter = parameter;
+            startShellRequest('t', address, &cmd);
+        }else {
+            rs232SendString("Not enougth parameter for command.\n");
+        }
+
+        break;
+    }
+
+    case 'e':
+    {
+        unsigned address;
+        unsigned slots = 16;
+        unsigned all = 0;
+
+        if(sscanf(next,"%x %u %u", &address, &slots, &all) >= 1 && address > 0 && address < TELEMETRY_PROBE_ADDRESS)
+        {
+            struct EnumerationStatistics statistics;
+
+            enumerationBusRun(address, slots, all != 0, enumerationAssigned, &statistics);
+
+            sprintf(report,"Assigned: %d\n", statistics.assigned);
+            rs232SendString(report);
+            sprintf(report,"Rounds: %d Slots: %d\n", statistics.rounds, statistics.slots);
+            rs232SendString(report);
+        }else {
+            rs232SendString("Not enougth parameter for command.\n");
+        }
+
+        break;
+    }
+
+        case 'w':
+    {
+
+        break;
+    }
+        case 's': //Receive error counters of the serial link
+    {
+        struct Rs232Statistics statistics;
+
+        rs232GetStatistics(&statistics);
+        sprintf(report,"Overruns: %u %u\n", statistics.hardwareOverruns, statistics.bufferOverruns);
+        rs232SendString(report);
+        sprintf(report,"Framing: %u\n", statistics.framingErrors);
+        rs232SendString(report);
+        break;
+    }
+    }
+
+
+
+
+}
+
+
+
+
+void shellInit( void )
+{
+    rs232SendString("RS232 - TWI Bridge\n");
+    rs232SendString("\n>> ");
+}
+
+void shellPoll( void )
+{
+    /* The next command line is collected while the bus still works on the previous one */
+    if(!lineReady) {
+        lineReady = readCommand();
+    }
+
+    if(pendingCommand && !shellBusy()) {
+        reportShellJob();
+        rs232SendString("\n>> ");
+    }
+
+    if(lineReady && !pendingCommand) {
+        lineReady = false;
+        parseCommand();
+
+        if(!pendingCommand) {
+            rs232SendString("\n>> ");
+        }
+    }
+}
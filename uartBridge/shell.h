@@ -0,0 +1,19 @@
+#ifndef SHELL_H
+#define SHELL_H
+
+/**
+ * Interactive text shell on the serial line, only built with BRIDGE_DEBUG_SHELL. Meant for bring up and
+ * debugging, the host software talks the binary protocol of hostLink.h.
+ */
+
+/**
+ * @brief shellInit prints the banner and the first prompt
+ */
+void shellInit( void );
+
+/**
+ * @brief shellPoll processes the serial input and reports finished commands, call it from the main loop
+ */
+void shellPoll( void );
+
+#endif
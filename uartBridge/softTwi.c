@@ -0,0 +1,328 @@
+#include "softTwi.h"
+#ifdef BRIDGE_TRACE
+    #include "clock.h"
+    #include "trace.h"
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <stddef.h>
+
+/* Open drain: PORTA keeps both bits 0, a line is pulled low by switching its pin to output */
+#define SOFT_SCL PA0
+#define SOFT_SDA PA1
+
+/* One tick per half SCL period, F_CPU / prescaler / (OCR2 + 1) ticks per second */
+#define SOFT_TWI_OCR(hz, prescaler) (F_CPU / (prescaler) / (2 * (hz)) - 1)
+
+struct SoftBitRate {
+    uint8_t ocr;
+    uint8_t clockSelect; //Prescaler bits of TCCR2
+    uint16_t divider;
+};
+
+static const __flash struct SoftBitRate bitRates[SOFT_TWI_MAX_SPEED + 1] = {
+    { SOFT_TWI_OCR(245, 1024), (1<<CS22) | (1<<CS21) | (1<<CS20), 1024 }, //twiSpeedDefault, the slowest
+    { SOFT_TWI_OCR(245, 1024), (1<<CS22) | (1<<CS21) | (1<<CS20), 1024 },
+    { SOFT_TWI_OCR(1000, 32), (1<<CS21) | (1<<CS20), 32 },
+    { SOFT_TWI_OCR(4000, 8), (1<<CS21), 8 },
+    { SOFT_TWI_OCR(10000, 8), (1<<CS21), 8 },
+    { SOFT_TWI_OCR(25000, 1), (1<<CS20), 1 }
+};
+
+enum SoftState {
+    softIdle,
+    softStart,          //Both lines released, SDA goes low for the START
+    softBitLow,         //SCL goes low, the next bit onto SDA
+    softBitHigh,        //SCL is released
+    softBitSample,      //SCL high once the slave stopped stretching, SDA is sampled
+    softRestartHigh,    //SDA released with SCL low, SCL is released next
+    softRestartStart,   //SDA goes low for the repeated START once SCL is high
+    softStopHigh,       //Both lines low, SCL is released next
+    softStopRelease     //SDA is released for the STOP once SCL is high
+};
+
+static struct TwiJob * volatile head_; //Job on the bus, the queue follows through next
+static struct TwiJob * tail_;
+static uint8_t state_;                 //enum SoftState
+static uint8_t byte_;                  //Shifted out MSB first, the sampled bits are shifted in
+static uint8_t bit_;                   //Of byte_, 8 is the acknowledge
+static uint8_t index_;                 //Byte of the current phase
+static uint8_t stretch_;               //Ticks SCL was held low by the slave
+static uint8_t status_;                //enum TwiJobStatus, reported once the STOP is on the bus
+static bool reading_;                  //Current phase of the head job
+static bool addressing_;               //byte_ is the address
+
+static void sclLow_( void ) { DDRA |= (1<<SOFT_SCL); }
+static void sclRelease_( void ) { DDRA &= ~(1<<SOFT_SCL); }
+static void sdaLow_( void ) { DDRA |= (1<<SOFT_SDA); }
+static void sdaRelease_( void ) { DDRA &= ~(1<<SOFT_SDA); }
+
+void softTwiInit( void )
+{
+    head_ = NULL;
+    tail_ = NULL;
+    state_ = softIdle;
+
+    TCCR2 = 0;
+    PORTA &= ~((1<<SOFT_SCL) | (1<<SOFT_SDA));
+    DDRA &= ~((1<<SOFT_SCL) | (1<<SOFT_SDA));
+    TIMSK |= (1<<OCIE2);
+}
+
+static uint8_t speedOf_(struct TwiJob const * const job)
+{
+    return job->speed <= SOFT_TWI_MAX_SPEED ? job->speed : SOFT_TWI_MAX_SPEED;
+}
+
+static void setRate_(uint8_t const speed)
+{
+    OCR2 = bitRates[speed].ocr;
+    TCNT2 = 0;
+    TCCR2 = (1<<WGM21) | bitRates[speed].clockSelect; //CTC, the compare interrupt is the tick
+}
+
+static void start_( void )
+{
+    state_ = softStart;
+    setRate_(speedOf_(head_));
+}
+
+static void clockLow_( void )
+{
+    struct TwiJob const * const job = head_;
+    bool const receiving = reading_ && !addressing_;
+    bool low;
+
+    sclLow_();
+
+    if(bit_ < 8) {
+        low = !receiving && !(byte_ & 0x80);
+    } else {
+        low = receiving && index_ + 1 < job->rxLength; //NACK the last byte
+    }
+
+    if(low) {
+        sdaLow_();
+    } else {
+        sdaRelease_();
+    }
+
+    state_ = softBitHigh;
+}
+
+static void nextByte_(uint8_t const byte)
+{
+    byte_ = byte;
+    bit_ = 0;
+    clockLow_();
+}
+
+static void stop_(uint8_t const status)
+{
+    status_ = status;
+    sclLow_();
+    sdaLow_();
+    state_ = softStopHigh;
+}
+
+static void restart_( void )
+{
+    sclLow_();
+    sdaRelease_();
+    state_ = softRestartHigh;
+}
+
+/* Reports the head job and goes on with the next one, the completion may already submit another */
+static void finishJob_(uint8_t const status)
+{
+    struct TwiJob * const job = head_;
+
+    head_ = job->next;
+    if(head_) {
+        state_ = softStart;
+    } else {
+        tail_ = NULL;
+        state_ = softIdle;
+        TCCR2 = 0;
+    }
+
+    job->status = status;
+#ifdef BRIDGE_TRACE
+    traceJob(job, clockMillis());
+#endif
+    if(job->completed) {
+        job->completed(job);
+    }
+}
+
+static void startJob_( void )
+{
+    struct TwiJob const * const job = head_;
+
+    if((PINA & ((1<<SOFT_SCL) | (1<<SOFT_SDA))) != ((1<<SOFT_SCL) | (1<<SOFT_SDA))) {
+        finishJob_(twiJobNoStart); //A slave still holds the bus
+        return;
+    }
+
+    setRate_(speedOf_(job));
+    sdaLow_();
+    index_ = 0;
+    stretch_ = 0;
+    reading_ = job->txLength == 0 && job->rxLength != 0; //Without any data it just probes the address
+    addressing_ = true;
+    byte_ = (job->address << 1) | (reading_ ? 1 : 0);
+    bit_ = 0;
+    state_ = softBitLow;
+}
+
+/* The acknowledge of byte_ was sampled, decides how the job goes on */
+static void byteDone_(bool const acknowledged)
+{
+    struct TwiJob * const job = head_;
+
+    if(addressing_) {
+        addressing_ = false;
+
+        if(!acknowledged) {
+            stop_(twiJobAddressNack);
+        } else if(reading_) {
+            nextByte_(0xff);
+        } else if(index_ < job->txLength) {
+            nextByte_(job->txBuffer[index_++]);
+        } else {
+            stop_(twiJobOk);
+        }
+    } else if(reading_) {
+        job->rxBuffer[index_++] = byte_;
+
+        if(index_ < job->rxLength) {
+            nextByte_(0xff);
+        } else {
+            stop_(twiJobOk);
+        }
+    } else if(!acknowledged) {
+        stop_(twiJobDataNack);
+    } else if(index_ < job->txLength) {
+        nextByte_(job->txBuffer[index_++]);
+    } else if(job->rxLength) {
+        restart_(); //Nobody else gets the bus between command and reply
+    } else {
+        stop_(twiJobOk);
+    }
+}
+
+/* False while the slave stretches the clock, fails the job once it did so for too long */
+static bool sclHigh_( void )
+{
+    if(PINA & (1<<SOFT_SCL)) {
+        stretch_ = 0;
+        return true;
+    }
+
+    if(++stretch_ >= SOFT_TWI_STRETCH_TICKS) {
+        stretch_ = 0;
+        sdaRelease_();
+        finishJob_(twiJobBusError); //Nothing to send a STOP with, the next START checks the lines
+    }
+
+    return false;
+}
+
+void softTwiSubmit(struct TwiJob * const job)
+{
+    job->status = twiJobPending;
+    job->next = NULL;
+
+    uint8_t const sreg = SREG;
+    cli();
+
+    if(tail_) {
+        tail_->next = job;
+        tail_ = job;
+    } else {
+        head_ = job;
+        tail_ = job;
+        start_();
+    }
+
+    SREG = sreg;
+}
+
+uint32_t softTwiSpeedHz(uint8_t const speed)
+{
+    struct SoftBitRate const rate = bitRates[speed <= SOFT_TWI_MAX_SPEED ? speed : SOFT_TWI_MAX_SPEED];
+
+    return F_CPU / ((uint32_t)rate.divider * (rate.ocr + 1) * 2);
+}
+
+bool softTwiIdle( void )
+{
+    return head_ == NULL;
+}
+
+ISR(TIMER2_COMP_vect)
+{
+    switch(state_) {
+    case softStart:
+        startJob_();
+        break;
+
+    case softBitLow:
+        clockLow_();
+        break;
+
+    case softBitHigh:
+        sclRelease_();
+        state_ = softBitSample;
+        break;
+
+    case softBitSample:
+        if(sclHigh_()) {
+            bool const sda = (PINA & (1<<SOFT_SDA)) != 0;
+
+            if(bit_ < 8) {
+                byte_ = (byte_ << 1) | sda;
+                ++bit_;
+                clockLow_();
+            } else {
+                byteDone_(!sda);
+            }
+        }
+        break;
+
+    case softRestartHigh:
+        sclRelease_();
+        state_ = softRestartStart;
+        break;
+
+    case softRestartStart:
+        if(sclHigh_()) {
+            sdaLow_();
+            index_ = 0;
+            reading_ = true;
+            addressing_ = true;
+            byte_ = (head_->address << 1) | 1;
+            bit_ = 0;
+            state_ = softBitLow;
+        }
+        break;
+
+    case softStopHigh:
+        sclRelease_();
+        state_ = softStopRelease;
+        break;
+
+    case softStopRelease:
+        if(sclHigh_()) {
+            sdaRelease_();
+            finishJob_(status_);
+        }
+        break;
+
+    default:
+        TCCR2 = 0;
+        break;
+    }
+}
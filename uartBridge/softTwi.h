@@ -0,0 +1,34 @@
+#ifndef SOFT_TWI_H
+#define SOFT_TWI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "twiMaster.h"
+
+/**
+ * Second sensor bus, bit-banged on PA0 (SCL) and PA1 (SDA) with external pull ups. Timer2 ticks twice per SCL
+ * period, every tick moves the bus one step on from the compare interrupt. It runs the jobs of twiBusSoftware,
+ * twiMaster.c hands them over, so callers only see the interface of twiMaster.h. At the fastest speed the
+ * interrupt takes up to half of the bridge's CPU, faster speeds run at SOFT_TWI_MAX_SPEED.
+ */
+enum {
+    SOFT_TWI_MAX_SPEED = twiSpeed25kHz,
+    SOFT_TWI_STRETCH_TICKS = 255 //A slave holding SCL low longer than this fails the job with twiJobBusError
+};
+
+/**
+ * @brief softTwiInit releases both lines and sets up Timer2, call with interrupts disabled
+ */
+void softTwiInit( void );
+
+void softTwiSubmit(struct TwiJob * job);
+
+/**
+ * @brief softTwiSpeedHz returns the SCL frequency the speed runs at, without the slave stretching the clock
+ */
+uint32_t softTwiSpeedHz(uint8_t speed);
+
+bool softTwiIdle( void );
+
+#endif
@@ -0,0 +1,105 @@
+#include "trace.h"
+
+#include <stddef.h>
+
+static uint8_t ring_[TRACE_SIZE];
+static uint16_t start_;   //Oldest byte not read yet
+static uint16_t used_;
+static uint8_t partial_;  //Bytes left of the record the host is reading, it is never dropped
+static uint8_t lost_;
+
+static void put_(uint16_t * const position, uint8_t const byte)
+{
+    ring_[*position] = byte;
+    *position = *position + 1 < TRACE_SIZE ? *position + 1 : 0;
+}
+
+static void dropped_( void )
+{
+    if(lost_ < 0xff) {
+        ++lost_;
+    }
+}
+
+void traceInit( void )
+{
+    start_ = 0;
+    used_ = 0;
+    partial_ = 0;
+    lost_ = 0;
+}
+
+void traceJob(struct TwiJob const * const job, uint16_t const millis)
+{
+    uint8_t txLength = job->txLength;                              //What the job tried to send, even if it failed
+    uint8_t rxLength = job->status == twiJobOk ? job->rxLength : 0; //A failed read leaves the buffer undefined
+
+    while(rxLength > 0 && job->rxBuffer[rxLength - 1] == 0) {
+        --rxLength;
+    }
+
+    uint16_t length = TRACE_RECORD_HEADER + txLength + rxLength;
+
+    if(length > TRACE_SIZE || length > 0xff) {
+        length = TRACE_SIZE < 0xff ? TRACE_SIZE : 0xff;
+
+        if(TRACE_RECORD_HEADER + txLength > length) {
+            txLength = length - TRACE_RECORD_HEADER;
+        }
+        rxLength = length - TRACE_RECORD_HEADER - txLength;
+    }
+
+    /* The oldest records make room, the one being read stays whole */
+    while(TRACE_SIZE - used_ < length) {
+        if(partial_) {
+            dropped_();
+            return;
+        }
+
+        uint8_t const oldest = ring_[start_];
+
+        start_ = (start_ + oldest) % TRACE_SIZE;
+        used_ -= oldest;
+        dropped_();
+    }
+
+    uint16_t position = (start_ + used_) % TRACE_SIZE;
+
+    put_(&position, length);
+    put_(&position, job->address | (job->bus == twiBusHardware ? 0 : TRACE_BUS_FLAG));
+    put_(&position, job->status);
+    put_(&position, txLength);
+    put_(&position, millis & 0xff);
+    put_(&position, millis >> 8);
+
+    for(uint8_t i = 0; i<txLength; ++i) {
+        put_(&position, job->txBuffer[i]);
+    }
+
+    for(uint8_t i = 0; i<rxLength; ++i) {
+        put_(&position, job->rxBuffer[i]);
+    }
+
+    used_ += length;
+}
+
+uint8_t traceRead(uint8_t * const buffer, uint8_t const size, uint8_t * const lost)
+{
+    uint8_t count = 0;
+
+    while(count < size && used_ > 0) {
+        if(!partial_) {
+            partial_ = ring_[start_];
+        }
+
+        buffer[count++] = ring_[start_];
+        start_ = start_ + 1 < TRACE_SIZE ? start_ + 1 : 0;
+        --used_;
+        --partial_;
+    }
+
+    *lost = lost_;
+    lost_ = 0;
+
+    return count;
+}
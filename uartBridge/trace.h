@@ -0,0 +1,52 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#include "twiMaster.h"
+
+/**
+ * Capture of the sensor bus traffic, the bytes every TWI job wrote and read as they went over the wire. The records
+ * go into a ring of TRACE_SIZE bytes, a new record drops the oldest unread ones when the ring is full. The host
+ * reads the ring as a byte stream over the link, see bridgeOpTrace, and host/traceReplay feeds it to the decoders.
+ * Built into the bridge with BRIDGE_TRACE, the ring takes RAM the scheduler would miss on a full bus.
+ */
+#ifndef TRACE_SIZE
+    #define TRACE_SIZE 128
+#endif
+
+enum {
+    TRACE_RECORD_HEADER = 6,
+    TRACE_BUS_FLAG      = 0x80 //In address, the job ran on twiBusSoftware
+};
+
+/**
+ * A record is its header followed by the txLength bytes written and the bytes read, trailing zeros of a read are
+ * left out: a sensor without a reply shifts out zeros. A record longer than the ring leaves out the end of the read.
+ */
+struct TraceRecordHeader {
+    uint8_t length;     //Of the whole record, header included
+    uint8_t address;    //7 bit address of the job, TRACE_BUS_FLAG for the software bus
+    uint8_t status;     //enum TwiJobStatus
+    uint8_t txLength;
+    uint16_t millis;    //Low 16 bit of clockMillis() when the job completed, little endian
+};
+
+/**
+ * @brief traceInit empties the ring
+ */
+void traceInit( void );
+
+/**
+ * @brief traceJob appends the record of a completed job, called from the interrupt completing it
+ */
+void traceJob(struct TwiJob const * job, uint16_t millis);
+
+/**
+ * @brief traceRead takes the oldest bytes of the record stream from the ring, call it with interrupts disabled
+ * @param lost is set to the records dropped since the last read, saturated at 255
+ * @return Number of bytes copied, 0 if the ring is empty
+ */
+uint8_t traceRead(uint8_t * buffer, uint8_t size, uint8_t * lost);
+
+#endif
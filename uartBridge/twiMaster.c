@@ -0,0 +1,261 @@
+#include "twiMaster.h"
+#ifdef BRIDGE_SOFT_TWI
+    #include "softTwi.h"
+#endif
+#ifdef BRIDGE_TRACE
+    #include "clock.h"
+    #include "trace.h"
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+#include <stddef.h>
+
+/* SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS), the datasheet wants TWBR >= 10 in master mode */
+#define TWI_TWBR(hz, prescaler) ((F_CPU / (hz) - 16) / (2 * (prescaler)))
+
+struct TwiBitRate {
+    uint8_t twbr;
+    uint8_t twps;
+};
+
+static const __flash struct TwiBitRate bitRates[twiSpeeds] = {
+    { 255, 3 },                     //twiSpeedDefault, the slowest
+    { 255, 3 },                     //Clock / 64
+    { 255, 2 },
+    { 255, 1 },
+    { TWI_TWBR(10000, 4), 1 },
+    { TWI_TWBR(25000, 1), 0 },
+    { TWI_TWBR(50000, 1), 0 },
+    { TWI_TWBR(100000, 1), 0 },
+    { TWI_TWBR(200000, 1), 0 }
+};
+
+#define TWI_START     (1<<TWEN) | (1<<TWIE) | (1<<TWINT) | (1<<TWSTA)
+#define TWI_RESTART   (1<<TWEN) | (1<<TWIE) | (1<<TWINT) | (1<<TWSTO) | (1<<TWSTA)
+#define TWI_REPEAT    (1<<TWEN) | (1<<TWIE) | (1<<TWINT) | (1<<TWSTA)
+#define TWI_NEXT      (1<<TWEN) | (1<<TWIE) | (1<<TWINT)
+#define TWI_NEXT_ACK  (1<<TWEN) | (1<<TWIE) | (1<<TWINT) | (1<<TWEA)
+#define TWI_STOP      (1<<TWEN) | (1<<TWINT) | (1<<TWSTO)
+
+static struct TwiJob * volatile head_; //Job on the bus, the queue follows through next
+static struct TwiJob * tail_;
+static uint8_t index_;                 //Byte of the current phase
+static bool reading_;                  //Current phase of the head job
+static bool starting_;                 //The head job waits for the STOP before it to go out
+
+void twiMasterInit( void )
+{
+    head_ = NULL;
+    tail_ = NULL;
+    starting_ = false;
+
+    PORTC = 0xff;
+    TWBR = bitRates[twiSpeedDefault].twbr;
+    TWSR = bitRates[twiSpeedDefault].twps;
+    TWCR = (1<<TWEN);
+
+#ifdef BRIDGE_SOFT_TWI
+    softTwiInit();
+#endif
+}
+
+static struct TwiBitRate rateOf_(struct TwiJob const * const job)
+{
+    return bitRates[job->speed < twiSpeeds ? job->speed : twiSpeedDefault];
+}
+
+/* Called with interrupts off, the STOP doesn't raise TWINT, so nothing else touches the bus meanwhile */
+static void startPending_( void )
+{
+    if(starting_ && !(TWCR & (1<<TWSTO))) {
+        struct TwiBitRate const rate = rateOf_(head_);
+
+        starting_ = false;
+        TWBR = rate.twbr;
+        TWSR = rate.twps;
+        TWCR = TWI_START;
+    }
+}
+
+/* Starts the head job. The bit rate only changes once the STOP of the previous job is off the bus, otherwise
+ * the STOP and the START go out in one step at the old rate. That takes half an SCL period at the old rate, up to
+ * 2 ms, so the START is left to twiMasterPoll() instead of waiting here with the interrupts off. */
+static void startJob_(bool const restart)
+{
+    struct TwiBitRate const rate = rateOf_(head_);
+
+    index_ = 0;
+    reading_ = head_->txLength == 0 && head_->rxLength != 0; //Without any data it just probes the address
+
+    if(restart && TWBR == rate.twbr && (TWSR & 0x03) == rate.twps) {
+        TWCR = TWI_RESTART;
+        return;
+    }
+
+    if(restart) {
+        TWCR = TWI_STOP;
+    }
+
+    starting_ = true;
+    startPending_();
+}
+
+/* Finishes the head job and starts the next one, a STOP is always sent before the next START */
+static void finishJob_(uint8_t const status)
+{
+    struct TwiJob * const job = head_;
+
+    head_ = job->next;
+    if(!head_) {
+        tail_ = NULL;
+    }
+
+    if(head_) {
+        startJob_(true);
+    } else {
+        TWCR = TWI_STOP;
+    }
+
+    job->status = status;
+#ifdef BRIDGE_TRACE
+    traceJob(job, clockMillis());
+#endif
+    if(job->completed) {
+        job->completed(job);
+    }
+}
+
+void twiMasterSubmit(struct TwiJob * const job)
+{
+#ifdef BRIDGE_SOFT_TWI
+    if(job->bus == twiBusSoftware) {
+        softTwiSubmit(job);
+        return;
+    }
+#endif
+
+    job->status = twiJobPending;
+    job->next = NULL;
+
+    uint8_t const sreg = SREG;
+    cli();
+
+    if(tail_) {
+        tail_->next = job;
+        tail_ = job;
+    } else {
+        head_ = job;
+        tail_ = job;
+        startJob_(false);
+    }
+
+    SREG = sreg;
+}
+
+uint8_t twiMasterTransfer(struct TwiJob * const job)
+{
+    twiMasterSubmit(job);
+    while(job->status == twiJobPending) {
+        twiMasterPoll();
+    }
+
+    return job->status;
+}
+
+void twiMasterPoll( void )
+{
+    uint8_t const sreg = SREG;
+    cli();
+    startPending_();
+    SREG = sreg;
+}
+
+uint32_t twiMasterSpeedHz(uint8_t const bus, uint8_t const speed)
+{
+#ifdef BRIDGE_SOFT_TWI
+    if(bus == twiBusSoftware) {
+        return softTwiSpeedHz(speed);
+    }
+#endif
+
+    struct TwiBitRate const rate = bitRates[speed < twiSpeeds ? speed : twiSpeedDefault];
+
+    return F_CPU / (16 + 2UL * rate.twbr * (1 << (2 * rate.twps)));
+}
+
+bool twiMasterIdle( void )
+{
+#ifdef BRIDGE_SOFT_TWI
+    if(!softTwiIdle()) {
+        return false;
+    }
+#endif
+
+    return head_ == NULL;
+}
+
+ISR(TWI_vect)
+{
+    struct TwiJob * const job = head_;
+
+    if(!job) {
+        TWCR = TWI_STOP;
+        return;
+    }
+
+    switch(TW_STATUS) {
+    case TW_START:
+    case TW_REP_START:
+        TWDR = (job->address << 1) | (reading_ ? 1 : 0);
+        TWCR = TWI_NEXT;
+        break;
+
+    case TW_MT_SLA_ACK:
+    case TW_MT_DATA_ACK:
+        if(index_ < job->txLength) {
+            TWDR = job->txBuffer[index_++];
+            TWCR = TWI_NEXT;
+        } else if(job->rxLength) {
+            index_ = 0;
+            reading_ = true;
+            TWCR = TWI_REPEAT; //Repeated START, nobody else gets the bus between command and reply
+        } else {
+            finishJob_(twiJobOk);
+        }
+        break;
+
+    case TW_MR_SLA_ACK:
+        TWCR = job->rxLength > 1 ? TWI_NEXT_ACK : TWI_NEXT; //NACK the last byte
+        break;
+
+    case TW_MR_DATA_ACK:
+        job->rxBuffer[index_++] = TWDR;
+        TWCR = (index_ + 1) < job->rxLength ? TWI_NEXT_ACK : TWI_NEXT;
+        break;
+
+    case TW_MR_DATA_NACK:
+        job->rxBuffer[index_++] = TWDR;
+        finishJob_(twiJobOk);
+        break;
+
+    case TW_MT_SLA_NACK:
+    case TW_MR_SLA_NACK:
+        finishJob_(twiJobAddressNack);
+        break;
+
+    case TW_MT_DATA_NACK:
+        finishJob_(twiJobDataNack);
+        break;
+
+    case TW_MT_ARB_LOST: //Same code for the receiver
+        finishJob_(twiJobArbitrationLost);
+        break;
+
+    default: //Bus error or an unexpected state
+        finishJob_(twiJobBusError);
+        break;
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef TWI_MASTER_H
+#define TWI_MASTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum TwiJobStatus {
+    twiJobOk              = 0,
+    twiJobNoStart         = 1,
+    twiJobAddressNack     = 2,
+    twiJobDataNack        = 3,
+    twiJobArbitrationLost = 4,
+    twiJobBusError        = 5,
+    twiJobPending         = 0x80  //Queued or running
+};
+
+/**
+ * SCL rates a job can run at. The slow ones are what every sensor copes with, the fast ones need short cables.
+ * The rates from twiSpeed245Hz up are in ascending order.
+ */
+enum TwiSpeed {
+    twiSpeedDefault = 0, //Default of a zeroed job, runs at the slowest rate, what an uncalibrated sensor copes with
+    twiSpeed245Hz  = 1,
+    twiSpeed1kHz   = 2,
+    twiSpeed4kHz   = 3,
+    twiSpeed10kHz  = 4,
+    twiSpeed25kHz  = 5,
+    twiSpeed50kHz  = 6,
+    twiSpeed100kHz = 7,
+    twiSpeed200kHz = 8,
+    twiSpeeds
+};
+
+/**
+ * Sensor bus segments. The software bus of softTwi.c is only built with BRIDGE_SOFT_TWI, it takes the same jobs.
+ */
+enum TwiBus {
+    twiBusHardware = 0, //TWI unit on PC0/PC1, default of a zeroed job
+    twiBusSoftware = 1  //Bit-banged on PA0/PA1
+};
+
+#ifdef BRIDGE_SOFT_TWI
+enum { twiBuses = 2 };
+#else
+enum { twiBuses = 1 };
+#endif
+
+struct TwiJob;
+typedef void (*TwiJobCallback)(struct TwiJob *);
+
+/**
+ * One bus transaction. With only txLength set it is a write, with only rxLength a read and with both the data
+ * is written first and the reply read after a repeated START. The job is owned by the caller and must stay valid until its
+ * status is no longer twiJobPending.
+ */
+struct TwiJob {
+    uint8_t address;
+    uint8_t const * txBuffer;
+    uint8_t txLength;
+    uint8_t * rxBuffer;
+    uint8_t rxLength;
+    uint8_t speed;                //enum TwiSpeed, the bit rate is switched before the START
+    uint8_t bus;                  //enum TwiBus the job runs on
+    volatile uint8_t status;      //enum TwiJobStatus
+    TwiJobCallback completed;     //Called from the TWI interrupt once done, may be NULL
+    struct TwiJob * next;         //Queue link, owned by the driver
+};
+
+/**
+ * @brief twiMasterInit sets up the TWI hardware and the software bus, call with interrupts disabled
+ */
+void twiMasterInit( void );
+
+/**
+ * @brief twiMasterSubmit appends the job to the queue of its bus and returns right away
+ */
+void twiMasterSubmit(struct TwiJob * job);
+
+/**
+ * @brief twiMasterTransfer submits the job and waits for its completion
+ * @return the final status of the job
+ */
+uint8_t twiMasterTransfer(struct TwiJob * job);
+
+/**
+ * @brief twiMasterPoll starts the next job once the STOP before its change of the bit rate is off the bus. Call it
+ * from the main loop, twiMasterTransfer() does while it waits.
+ */
+void twiMasterPoll( void );
+
+/**
+ * @brief twiMasterSpeedHz returns the SCL frequency of the speed on the bus, without the slave stretching the clock
+ */
+uint32_t twiMasterSpeedHz(uint8_t bus, uint8_t speed);
+
+/**
+ * @brief twiMasterIdle returns true if no job is queued or running on any bus
+ */
+bool twiMasterIdle( void );
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * hdlc.cpp is shared with the sensor, which streams its frames through the TWI interface. The bridge and the host
+ * tools only use the buffer based codec, these stand-ins satisfy the linker.
+ */
+#include "../twiInterface.h"
+
+bool twiSendChar(char c)
+{
+    return false;
+}
+
+bool twiCharAvailable( void )
+{
+    return false;
+}
+
+char twiReceiveChar( void )
+{
+    return 0;
+}
+
+void twiSleep( void )
+{
+}